@@ -1,40 +1,229 @@
-#include <driver/compil_driver.hpp>
+#include <driver/compile_server.hpp>
+
+#include <vm/assembler.hpp>
+#include <vm/machine.hpp>
+
+#include <log/log.hpp>
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <getopt.h>
 
-void ParseOptions(CompilationDriver& driver, int argc, char** argv) {
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Where to serve requests from, if at all (see compile_server.hpp)
+struct ServeMode {
+  bool stdio = false;
+  const char* socket = nullptr;
+};
+
+// Where the phase report goes (see phase_report.hpp)
+struct ReportMode {
+  bool table = false;
+  const char* trace = nullptr;
+};
+
+// `etc run`: execute the program in the bytecode interpreter
+//   instead of printing its IR (see vm/machine.hpp)
+struct RunMode {
+  bool enabled = false;
+  bool tests = false;
+  const char* module = "main";
+};
+
+void ParseOptions(CompileServer& driver, ServeMode& serve, ReportMode& report,
+                  RunMode& run, int argc, char** argv) {
   auto opt = '\0';
-  while ((opt = getopt(argc, argv, "tm:")) != -1) {
+  auto verbosity = (int)logging::Level::WARN;
+
+  while ((opt = getopt(argc, argv, "tm:c:su:rj:v")) != -1) {
     switch (opt) {
       case 't':
         driver.SetTestBuild();
+        run.tests = true;
         break;
       case 'm':
         driver.SetMainModule(optarg);
+        run.module = optarg;
+        break;
+      case 'c':
+        driver.SetCacheDir(optarg);
+        break;
+      case 's':
+        serve.stdio = true;
+        break;
+      case 'u':
+        serve.socket = optarg;
+        break;
+      case 'r':
+        report.table = true;
+        driver.EnableReport();
+        break;
+      case 'j':
+        report.trace = optarg;
+        driver.EnableReport();
+        break;
+      case 'v':
+        verbosity += 1;
         break;
       default: /* '?' */
-        fprintf(stderr, "Usage: %s [-m] module [-t] \n", argv[0]);
+        fprintf(stderr,
+                "Usage: %s [run] [-m] module [-t] [-c cache-dir] "
+                "[-s | -u socket] [-r] [-j trace.json] [-v...] "
+                "[-- program args...]\n",
+                argv[0]);
         exit(EXIT_FAILURE);
     }
   }
+
+  // -v for info, -vv for debug, -vvv for everything
+  verbosity = std::min(verbosity, (int)logging::Level::TRACE);
+  logging::SetVerbosity(logging::Level{verbosity});
+}
+
+// `etc run -t`: every @test function in a forked process of its own,
+//   reported like stdlib/runtime/test_main.c does
+int RunTests(vm::Program& program) {
+  auto tests = reinterpret_cast<const vm::Function* const*>(
+      program.symbols.at("et_test_array"));
+  auto names = reinterpret_cast<const char* const*>(
+      program.symbols.at("et_test_names"));
+
+  size_t total = 0;
+  size_t failed = 0;
+
+  for (; tests[total]; total++) {
+    auto start = std::chrono::steady_clock::now();
+    std::string error;
+
+#if !defined(_WIN32)
+    fflush(stdout);
+
+    if (auto pid = fork(); pid == 0) {
+      try {
+        vm::Machine{program}.Call(tests[total]);
+      } catch (const vm::VmError& e) {
+        fmt::print(stderr, "etc run: {}\n", e.what());
+        _exit(EXIT_FAILURE);
+      }
+      fflush(stdout);
+      _exit(EXIT_SUCCESS);
+    } else {
+      int status = 0;
+      waitpid(pid, &status, 0);
+
+      if (WIFSIGNALED(status)) {
+        error = strsignal(WTERMSIG(status));
+      } else if (WEXITSTATUS(status)) {
+        error = fmt::format("exit code {}", WEXITSTATUS(status));
+      }
+    }
+#else
+    // The first failed assert ends the run
+    vm::Machine{program}.Call(tests[total]);
+#endif
+
+    auto ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+
+    fmt::print("[{}] {:<50} {:>10.3f} ms  {}\n",
+               error.empty() ? "PASS" : "FAIL", names[total], ms, error);
+    failed += !error.empty();
+  }
+
+  fmt::print("{} of {} tests passed\n", total - failed, total);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 int main(int argc, char** argv) {
-  CompilationDriver driver;
+  CompileServer driver;
+  ServeMode serve;
+  ReportMode report;
+  RunMode run;
+
+  if (argc > 1 && std::string{argv[1]} == "run") {
+    run.enabled = true;
+    argv[1] = argv[0];
+    argc -= 1;
+    argv += 1;
+  }
+
+  ParseOptions(driver, serve, report, run, argc, argv);
 
-  ParseOptions(driver, argc, argv);
+  if (serve.stdio) {
+    driver.Serve(stdin, stdout);
+    return 0;
+  }
+
+#if !defined(_WIN32)
+  if (serve.socket) {
+    driver.Listen(serve.socket);
+    return 0;
+  }
+#endif
+
+  auto print_report = [&]() {
+    if (report.table) {
+      driver.GetReport()->PrintTable(stderr);
+    }
+
+    if (report.trace) {
+      if (auto file = fopen(report.trace, "w")) {
+        driver.GetReport()->WriteTrace(file);
+        fclose(file);
+      } else {
+        fprintf(stderr, "Could not open %s\n", report.trace);
+      }
+    }
+  };
+
+  std::string ir;
 
   try {
-    driver.Compile();
+    ir = driver.Compile();
   } catch (const ErrorAtLocation& error) {
     fmt::println(stderr, "{}: {}", error.where().Format(), error.what());
+    print_report();
     return 1;
   }
+
+  if (run.enabled) {
+    print_report();
+
+    // The program sees the module as its name, then what follows the options
+    std::vector<char*> args{const_cast<char*>(run.module)};
+    args.insert(args.end(), argv + optind, argv + argc);
+    args.push_back(nullptr);
+
+    try {
+      auto program = vm::Assemble(ir);
+
+      if (run.tests) {
+        return RunTests(program);
+      }
+
+      vm::Machine machine{program};
+      return machine.RunMain(static_cast<int>(args.size() - 1), args.data());
+    } catch (const vm::VmError& error) {
+      fmt::println(stderr, "etc run: {}", error.what());
+      return 1;
+    }
+  }
+
+  fmt::print("{}", ir);
+
+  print_report();
   // Ошибки общие, без местоположения, обрабатываются как раньше. Такие остались
   //   в CompilationDriver, когда не удалось открыть файл или не нашлась
   //   стандартная библиотека.
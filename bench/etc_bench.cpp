@@ -0,0 +1,244 @@
+#include "program_generator.hpp"
+
+#include <driver/compil_driver.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <getopt.h>
+
+// Compiles generated programs of growing size and prints the
+//   time of every phase (see driver/phase_report.hpp).
+//
+//   etc_bench [-n modules] [-f functions] [-d depth] [-k variants]
+//             [-r repeats] [-s steps] [-g n|f|d|k] [-o dir]
+//
+// Each of the `steps` doubles the dimension picked by -g. The
+//   `x prev` column is the growth of the median since the
+//   previous step: about 2 is linear, 4 and more is quadratic.
+
+//////////////////////////////////////////////////////////////////////
+
+// Reads the generated modules instead of the disk
+class GeneratedDriver : public CompilationDriver {
+ public:
+  GeneratedDriver(const std::map<std::string, std::string>& program)
+      : program_{program} {
+  }
+
+  virtual lex::InputFile OpenFile(std::string_view name) override {
+    auto it = program_.find(std::string{name});
+
+    if (it == program_.end()) {
+      return CompilationDriver::OpenFile(name);
+    }
+
+    auto abs_path = std::filesystem::absolute(std::string{name} + ".et");
+    return lex::InputFile{std::stringstream{it->second}, std::move(abs_path)};
+  }
+
+ private:
+  const std::map<std::string, std::string>& program_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+struct Options {
+  ProgramShape shape;
+
+  size_t repeats = 5;
+  size_t steps = 1;
+  char grow = 'f';
+
+  const char* output = nullptr;
+};
+
+void ParseOptions(Options& options, int argc, char** argv) {
+  auto opt = '\0';
+  while ((opt = getopt(argc, argv, "n:f:d:k:r:s:g:o:")) != -1) {
+    switch (opt) {
+      case 'n':
+        options.shape.modules = std::stoul(optarg);
+        break;
+      case 'f':
+        options.shape.functions = std::stoul(optarg);
+        break;
+      case 'd':
+        options.shape.depth = std::stoul(optarg);
+        break;
+      case 'k':
+        options.shape.variants = std::stoul(optarg);
+        break;
+      case 'r':
+        options.repeats = std::stoul(optarg);
+        break;
+      case 's':
+        options.steps = std::stoul(optarg);
+        break;
+      case 'g':
+        options.grow = optarg[0];
+        break;
+      case 'o':
+        options.output = optarg;
+        break;
+      default: /* '?' */
+        fprintf(stderr,
+                "Usage: %s [-n modules] [-f functions] [-d depth] "
+                "[-k variants] [-r repeats] [-s steps] [-g n|f|d|k] "
+                "[-o dir] \n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  auto& shape = options.shape;
+
+  if (!shape.modules || !shape.functions || !shape.depth ||
+      !shape.variants || !options.repeats ||
+      std::string_view{"nfdk"}.find(options.grow) == std::string_view::npos) {
+    fprintf(stderr, "Sizes should be positive, -g one of n, f, d, k\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+struct Stats {
+  double median = 0;
+  double mean = 0;
+  double stddev = 0;
+  double min = 0;
+};
+
+Stats Summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+
+  Stats stats;
+
+  auto n = samples.size();
+  stats.min = samples.front();
+  stats.median = n % 2 ? samples[n / 2]
+                       : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+  for (auto s : samples) {
+    stats.mean += s / n;
+  }
+
+  for (auto s : samples) {
+    stats.stddev += (s - stats.mean) * (s - stats.mean) / n;
+  }
+  stats.stddev = std::sqrt(stats.stddev);
+
+  return stats;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Milliseconds of wall time per phase, summed over the modules
+using PhaseTimes = std::map<std::string, double>;
+
+PhaseTimes CompileOnce(const std::map<std::string, std::string>& program) {
+  GeneratedDriver driver{program};
+  driver.EnableReport();
+  driver.Compile();
+
+  PhaseTimes times;
+
+  for (auto& phase : driver.GetReport()->Phases()) {
+    times[phase.name] += phase.wall / 1000;
+    times["total"] += phase.wall / 1000;
+  }
+
+  return times;
+}
+
+void WriteProgram(const std::map<std::string, std::string>& program,
+                  std::filesystem::path dir) {
+  std::filesystem::create_directories(dir);
+
+  for (auto& [name, text] : program) {
+    std::ofstream{dir / (name + ".et")} << text;
+  }
+}
+
+size_t& Dimension(ProgramShape& shape, char grow) {
+  switch (grow) {
+    case 'n':
+      return shape.modules;
+    case 'd':
+      return shape.depth;
+    case 'k':
+      return shape.variants;
+    default:
+      return shape.functions;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  Options options;
+  ParseOptions(options, argc, argv);
+
+  if (options.output) {
+    WriteProgram(ProgramGenerator{options.shape}.Generate(), options.output);
+    return 0;
+  }
+
+  // In the order of the pipeline
+  const char* phases[] = {"parse", "context", "intrinsics", "infer",
+                          "instantiate", "emit",    "total"};
+
+  std::map<std::string, double> previous;
+
+  for (size_t step = 0; step < options.steps; step++) {
+    auto& shape = options.shape;
+    auto program = ProgramGenerator{shape}.Generate();
+
+    size_t bytes = 0;
+    for (auto& [_, text] : program) {
+      bytes += text.size();
+    }
+
+    fmt::print("\nmodules {} functions {} depth {} variants {} ({} KiB)\n",
+               shape.modules, shape.functions, shape.depth, shape.variants,
+               bytes / 1024);
+
+    std::map<std::string, std::vector<double>> samples;
+
+    CompileOnce(program);  // Warm up
+
+    for (size_t r = 0; r < options.repeats; r++) {
+      for (auto& [phase, ms] : CompileOnce(program)) {
+        samples[phase].push_back(ms);
+      }
+    }
+
+    fmt::print("{:<12} {:>10} {:>10} {:>10} {:>10} {:>8}\n", "phase",
+               "median ms", "mean ms", "stddev", "min ms", "x prev");
+
+    for (auto phase : phases) {
+      auto stats = Summarize(samples[phase]);
+
+      auto growth = previous.contains(phase) && previous[phase] > 0
+                        ? fmt::format("{:.2f}", stats.median / previous[phase])
+                        : std::string{"-"};
+
+      fmt::print("{:<12} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>8}\n",
+                 phase, stats.median, stats.mean, stats.stddev, stats.min,
+                 growth);
+
+      previous[phase] = stats.median;
+    }
+
+    Dimension(shape, options.grow) *= 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+// Writes an Etude program of the given shape, for the benchmark:
+//
+//   mod_0 <- mod_1 <- ... <- mod_{N-1} <- main
+//
+// Every module declares a sum type with K variants, a generic
+//   struct, a K-arm match over integers and a K-arm match over
+//   the variants, and M functions calling each other in a chain.
+//   Function j also boxes its argument 1 + j % D times, which
+//   instantiates the generic struct at D nested types.
+
+struct ProgramShape {
+  size_t modules = 8;
+  size_t functions = 16;
+  size_t depth = 4;
+  size_t variants = 8;
+};
+
+class ProgramGenerator {
+ public:
+  explicit ProgramGenerator(ProgramShape shape) : shape_{shape} {
+  }
+
+  // Module name -> source text, the root module is "main"
+  std::map<std::string, std::string> Generate() {
+    std::map<std::string, std::string> program;
+
+    for (size_t k = 0; k < shape_.modules; k++) {
+      program.insert({fmt::format("mod_{}", k), Module(k)});
+    }
+
+    program.insert({"main", Main()});
+
+    return program;
+  }
+
+ private:
+  std::string Module(size_t k) {
+    std::string out;
+
+    if (k > 0) {
+      out += fmt::format("mod_{};\n\n", k - 1);
+    }
+
+    out += fmt::format(
+        "export {{\n"
+        "    of Int -> Int fun run_{} x;\n"
+        "}}\n\n",
+        k);
+
+    // Types
+
+    out += fmt::format("type Shape_{} = sum {{\n", k);
+    for (size_t v = 0; v < shape_.variants; v++) {
+      out += fmt::format("    | v{}: Int\n", v);
+    }
+    out += "};\n\n";
+
+    out += fmt::format(
+        "type Box_{0} a = struct {{\n"
+        "    inner: a,\n"
+        "    tag: Int,\n"
+        "}};\n\n"
+        "of a -> Box_{0}(a)\n"
+        "fun box_{0} x = {{ .inner = x, .tag = {0} }};\n\n",
+        k);
+
+    // Matches
+
+    out += fmt::format("of Int -> Shape_{0}\nfun pick_{0} x = match x {{\n", k);
+    for (size_t v = 0; v + 1 < shape_.variants; v++) {
+      out += fmt::format("    | {0}: .v{0} x\n", v);
+    }
+    out += fmt::format("    | otherwise: .v{} x\n    }};\n\n",
+                       shape_.variants - 1);
+
+    out += fmt::format("of Shape_{0} -> Int\nfun classify_{0} s = match s {{\n",
+                       k);
+    for (size_t v = 0; v < shape_.variants; v++) {
+      out += fmt::format("    | .v{0} n: n + {0}\n", v);
+    }
+    out += "    };\n\n";
+
+    // Functions
+
+    for (size_t j = 0; j < shape_.functions; j++) {
+      auto depth = 1 + j % shape_.depth;
+
+      auto boxed = std::string{"x"};
+      auto unboxed = std::string{};
+
+      for (size_t d = 0; d < depth; d++) {
+        boxed = fmt::format("box_{}({})", k, boxed);
+        unboxed += ".inner";
+      }
+
+      auto next = j > 0   ? fmt::format("f_{}_{}(x - 1)", k, j - 1)
+                  : k > 0 ? fmt::format("run_{}(x - 1)", k - 1)
+                          : std::string{"0"};
+
+      out += fmt::format(
+          "of Int -> Int\n"
+          "fun f_{0}_{1} x = if x <= 0 {{ 0 }} else {{\n"
+          "    classify_{0}(pick_{0}(x + {1})) + {2}{3} + {4}\n"
+          "}};\n\n",
+          k, j, boxed, unboxed, next);
+    }
+
+    out += fmt::format("fun run_{} x = f_{}_{}(x);\n", k, k,
+                       shape_.functions - 1);
+
+    return out;
+  }
+
+  std::string Main() {
+    return fmt::format(
+        "mod_{};\n\n"
+        "export {{\n"
+        "    of Int -> *String -> Int\n"
+        "    @nomangle fun main argc argv;\n"
+        "}}\n\n"
+        "fun main argc argv = run_{}(argc);\n",
+        shape_.modules - 1, shape_.modules - 1);
+  }
+
+ private:
+  ProgramShape shape_;
+};
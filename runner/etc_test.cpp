@@ -0,0 +1,449 @@
+#include "test_report.hpp"
+
+#include <driver/compil_driver.hpp>
+
+#include <vm/assembler.hpp>
+#include <vm/machine.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Compiles and runs the `*-test-*.et` programs, one forked process
+//   per test and up to -j of them at once.
+//
+//   etc_test [-j jobs] [-b vm|native] [-t cpu-ms] [-c compile-s]
+//            [-o report.json] [-x report.xml] [dir...]
+//
+// The test compiles in its process (there is no etc to spawn) and
+//   runs in the bytecode interpreter, or, with -b native, through
+//   qbe, as and cc. The run is limited in CPU time rather than in
+//   wall time, so that a loaded machine does not fail the tests.
+//
+// `NN-test-shouldfail-KIND` must fail: by timing out for KIND
+//   `timeout`, at compile time for `compile...`, at run time
+//   (a non-zero exit or a signal) otherwise.
+
+//////////////////////////////////////////////////////////////////////
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string backend = "vm";
+
+  long run_ms = 500;       // CPU time of the program
+  long compile_s = 20;     // CPU time of the whole test process
+
+  const char* json = nullptr;
+  const char* junit = nullptr;
+
+  std::vector<std::filesystem::path> dirs;
+};
+
+void ParseOptions(Options& options, int argc, char** argv) {
+  auto opt = '\0';
+  while ((opt = getopt(argc, argv, "j:b:t:c:o:x:")) != -1) {
+    switch (opt) {
+      case 'j':
+        options.jobs = std::stoul(optarg);
+        break;
+      case 'b':
+        options.backend = optarg;
+        break;
+      case 't':
+        options.run_ms = std::stol(optarg);
+        break;
+      case 'c':
+        options.compile_s = std::stol(optarg);
+        break;
+      case 'o':
+        options.json = optarg;
+        break;
+      case 'x':
+        options.junit = optarg;
+        break;
+      default: /* '?' */
+        fprintf(stderr,
+                "Usage: %s [-j jobs] [-b vm|native] [-t cpu-ms] "
+                "[-c compile-s] [-o report.json] [-x report.xml] "
+                "[dir...] \n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!options.jobs || options.run_ms <= 0 || options.compile_s <= 0 ||
+      (options.backend != "vm" && options.backend != "native")) {
+    fprintf(stderr, "Limits should be positive, -b one of vm, native\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = optind; i < argc; i++) {
+    options.dirs.emplace_back(argv[i]);
+  }
+
+  if (options.dirs.empty()) {
+    options.dirs.emplace_back("examples/test");
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+std::vector<TestCase> Discover(const Options& options) {
+  static const std::regex kTest{".*-test-.*\\.et"};
+
+  std::vector<TestCase> tests;
+
+  for (auto& dir : options.dirs) {
+    for (auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+      auto file = entry.path().filename().string();
+
+      if (!entry.is_regular_file() || !std::regex_match(file, kTest)) {
+        continue;
+      }
+
+      TestCase test;
+      test.path = std::filesystem::absolute(entry.path());
+      test.name = entry.path().stem().string();
+
+      if (auto at = test.name.find("-shouldfail-"); at != std::string::npos) {
+        auto kind = test.name.substr(at + strlen("-shouldfail-"));
+
+        test.expected = kind.starts_with("timeout")   ? Outcome::TIMEOUT
+                        : kind.starts_with("compile") ? Outcome::COMPILE_ERROR
+                                                      : Outcome::FAILED;
+      }
+
+      tests.push_back(std::move(test));
+    }
+  }
+
+  std::sort(tests.begin(), tests.end(), [](auto& a, auto& b) {
+    return a.path < b.path;
+  });
+
+  return tests;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// The test process tells how far it got through a pipe:
+//   `compiled <us>` once the program is ready to run,
+//   `error <message>` if it did not compile
+
+void Tell(int fd, const std::string& line) {
+  auto message = line + "\n";
+  [[maybe_unused]] auto written = write(fd, message.data(), message.size());
+}
+
+// SIGPROF kills the process once it has spent `ms` of CPU time
+//   from now on; the timer survives exec
+void LimitCpu(long ms) {
+  itimerval timer{};
+  timer.it_value.tv_sec = ms / 1000;
+  timer.it_value.tv_usec = ms % 1000 * 1000;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+std::filesystem::path ScratchDir(pid_t pid) {
+  return std::filesystem::temp_directory_path() /
+         fmt::format("etc_test.{}", pid);
+}
+
+[[noreturn]] void RunTest(const Options& options, const TestCase& test,
+                          int status, int output) {
+  dup2(output, STDOUT_FILENO);
+  dup2(output, STDERR_FILENO);
+
+  rlimit limit{};
+  limit.rlim_cur = limit.rlim_max = options.compile_s;
+  setrlimit(RLIMIT_CPU, &limit);
+
+  // Modules are looked up next to the test
+  std::filesystem::current_path(test.path.parent_path());
+
+  auto start = Clock::now();
+  std::string ir;
+
+  try {
+    CompilationDriver driver;
+    driver.SetMainModule(test.name.c_str());
+    ir = driver.Compile();
+  } catch (const ErrorAtLocation& error) {
+    Tell(status, fmt::format("error {}: {}", error.where().Format(),
+                             error.what()));
+    _exit(EXIT_FAILURE);
+  } catch (const std::exception& error) {
+    Tell(status, fmt::format("error {}", error.what()));
+    _exit(EXIT_FAILURE);
+  }
+
+  auto compiled = [&]() {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+    Tell(status, fmt::format("compiled {}", us.count()));
+  };
+
+  if (options.backend == "native") {
+    auto dir = ScratchDir(getpid());
+    std::filesystem::create_directories(dir);
+    std::ofstream{dir / "out.ssa"} << ir;
+
+    auto stdlib = std::getenv("ETUDE_STDLIB");
+    auto alloc = std::getenv("ETUDE_ALLOC");
+    auto runtime = fmt::format("{}/runtime/alloc_{}.c", stdlib ? stdlib : ".",
+                               alloc ? alloc : "malloc");
+
+    auto command = fmt::format(
+        "cd {} && qbe -o out.s out.ssa && as -o out.o out.s && "
+        "cc -o a.out out.o {}",
+        dir.string(), runtime);
+
+    if (std::system(command.c_str()) != 0) {
+      Tell(status, fmt::format("error `{}` failed", command));
+      _exit(EXIT_FAILURE);
+    }
+
+    compiled();
+    close(status);
+
+    LimitCpu(options.run_ms);
+    auto binary = (dir / "a.out").string();
+    execl(binary.c_str(), binary.c_str(), nullptr);
+    _exit(127);
+  }
+
+  try {
+    auto program = vm::Assemble(ir);
+    vm::Machine machine{program};
+
+    compiled();
+    close(status);
+
+    char* args[] = {const_cast<char*>(test.name.c_str()), nullptr};
+
+    LimitCpu(options.run_ms);
+    auto result = machine.RunMain(1, args);
+
+    fflush(stdout);
+    _exit(result);
+  } catch (const vm::VmError& error) {
+    fmt::print(stderr, "etc run: {}\n", error.what());
+    fflush(stdout);
+    _exit(EXIT_FAILURE);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+struct Running {
+  TestCase* test;
+  pid_t pid;
+  int status;
+  FILE* output;
+  Clock::time_point start;
+  bool killed = false;
+};
+
+Running Start(const Options& options, TestCase& test) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    exit(EXIT_FAILURE);
+  }
+
+  auto output = tmpfile();
+  auto start = Clock::now();
+
+  fflush(stdout);
+  fflush(stderr);
+
+  auto pid = fork();
+
+  if (pid < 0) {
+    perror("fork");
+    exit(EXIT_FAILURE);
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    RunTest(options, test, fds[1], fileno(output));
+  }
+
+  close(fds[1]);
+  return Running{&test, pid, fds[0], output, start};
+}
+
+std::string ReadAll(FILE* file, size_t limit) {
+  std::string result(limit, '\0');
+  rewind(file);
+  result.resize(fread(result.data(), 1, limit, file));
+  return result;
+}
+
+void Finish(const Options& options, Running& run, int wstatus) {
+  auto& test = *run.test;
+  auto total = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                         run.start);
+
+  auto status = fdopen(run.status, "r");
+  auto told = ReadAll(status, 1 << 16);
+  fclose(status);
+
+  test.output = ReadAll(run.output, 1 << 14);
+  fclose(run.output);
+
+  std::filesystem::remove_all(ScratchDir(run.pid));
+
+  auto signal = WIFSIGNALED(wstatus) ? WTERMSIG(wstatus) : 0;
+  auto timeout = run.killed || signal == SIGPROF || signal == SIGXCPU;
+
+  if (told.starts_with("error ")) {
+    test.outcome = Outcome::COMPILE_ERROR;
+    test.detail = told.substr(strlen("error "));
+    test.compile_ms = total.count();
+    return;
+  }
+
+  if (!told.starts_with("compiled ")) {
+    test.outcome = timeout ? Outcome::TIMEOUT : Outcome::COMPILE_ERROR;
+    test.detail = signal ? fmt::format("compiler: {}", strsignal(signal))
+                         : "compiler exited";
+    test.compile_ms = total.count();
+    return;
+  }
+
+  test.compile_ms = std::stod(told.substr(strlen("compiled "))) / 1000;
+  test.run_ms = std::max(0.0, total.count() - test.compile_ms);
+
+  if (timeout) {
+    test.outcome = Outcome::TIMEOUT;
+    test.detail = run.killed ? "over the wall time limit"
+                             : fmt::format("over {} ms of CPU time",
+                                           options.run_ms);
+  } else if (signal) {
+    test.outcome = Outcome::CRASHED;
+    test.detail = strsignal(signal);
+  } else if (auto code = WEXITSTATUS(wstatus)) {
+    test.outcome = Outcome::FAILED;
+    test.detail = fmt::format("exit code {}", code);
+  } else {
+    test.outcome = Outcome::PASSED;
+  }
+}
+
+void PrintResult(const TestCase& test) {
+  fmt::print("[!] Running test {:<40} ... {:<5} ({:>8.2f} ms compile, "
+             "{:>8.2f} ms run)",
+             test.name, test.Ok() ? "PASS!" : "FAIL!", test.compile_ms,
+             test.run_ms);
+
+  if (!test.Ok()) {
+    fmt::print(" expected {}, got {}: {}", FormatOutcome(test.expected),
+               FormatOutcome(test.outcome), test.detail);
+  }
+
+  fmt::print("\n");
+  fflush(stdout);
+}
+
+void RunAll(const Options& options, std::vector<TestCase>& tests) {
+  // A process that sleeps instead of spinning is killed after this
+  auto wall = std::chrono::seconds{options.compile_s} +
+              std::chrono::milliseconds{options.run_ms * 10};
+
+  std::vector<Running> running;
+  size_t next = 0;
+
+  while (next < tests.size() || !running.empty()) {
+    while (running.size() < options.jobs && next < tests.size()) {
+      running.push_back(Start(options, tests[next++]));
+    }
+
+    int wstatus = 0;
+    auto pid = waitpid(-1, &wstatus, WNOHANG);
+
+    if (pid <= 0) {
+      for (auto& run : running) {
+        if (!run.killed && Clock::now() - run.start > wall) {
+          kill(run.pid, SIGKILL);
+          run.killed = true;
+        }
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      continue;
+    }
+
+    auto it = std::find_if(running.begin(), running.end(), [&](auto& run) {
+      return run.pid == pid;
+    });
+
+    Finish(options, *it, wstatus);
+    PrintResult(*it->test);
+    running.erase(it);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  Options options;
+  ParseOptions(options, argc, argv);
+
+  // The tests run in their own directories
+  if (auto stdlib = std::getenv("ETUDE_STDLIB")) {
+    auto path = std::filesystem::absolute(stdlib).string();
+    setenv("ETUDE_STDLIB", path.c_str(), 1);
+  }
+
+  auto tests = Discover(options);
+
+  auto start = Clock::now();
+  RunAll(options, tests);
+  auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+  auto write_report = [&](const char* path, auto writer) {
+    if (auto file = fopen(path, "w")) {
+      writer(file, tests, options.backend);
+      fclose(file);
+    } else {
+      fprintf(stderr, "Could not open %s\n", path);
+    }
+  };
+
+  if (options.json) {
+    write_report(options.json, WriteJson);
+  }
+
+  if (options.junit) {
+    write_report(options.junit, WriteJunit);
+  }
+
+  auto failed = std::count_if(tests.begin(), tests.end(), [](auto& test) {
+    return !test.Ok();
+  });
+
+  fmt::print("-----------------------------------------------------------\n");
+  fmt::print("{} of {} tests passed in {:.2f} s ({} jobs)\n",
+             tests.size() - failed, tests.size(), elapsed.count(),
+             options.jobs);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
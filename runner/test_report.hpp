@@ -0,0 +1,187 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+#define TEST_OUTCOME_LIST(code)       \
+  code(PASSED, "passed")              \
+  code(COMPILE_ERROR, "compile error") \
+  code(FAILED, "failed")              \
+  code(CRASHED, "crashed")            \
+  code(TIMEOUT, "timeout")
+
+enum class Outcome {
+#define ENUM_VALUE(name, text) name,
+  TEST_OUTCOME_LIST(ENUM_VALUE)
+#undef ENUM_VALUE
+};
+
+inline const char* FormatOutcome(Outcome outcome) {
+  switch (outcome) {
+#define CASE(name, text) \
+  case Outcome::name:    \
+    return text;
+    TEST_OUTCOME_LIST(CASE)
+#undef CASE
+  }
+  return "?";
+}
+
+//////////////////////////////////////////////////////////////////////
+
+struct TestCase {
+  std::filesystem::path path;
+  std::string name;
+
+  // FAILED stands for any failure at run time (a non-zero exit or a
+  //   signal, as `assert` aborts)
+  Outcome expected = Outcome::PASSED;
+
+  Outcome outcome = Outcome::PASSED;
+  std::string detail;  // The compile error, the exit code or the signal
+  std::string output;  // What the compiler and the program printed
+
+  double compile_ms = 0;
+  double run_ms = 0;
+
+  bool Ok() const {
+    return outcome == expected ||
+           (expected == Outcome::FAILED && outcome == Outcome::CRASHED);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline std::string EscapeJson(std::string_view str) {
+  std::string result;
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (c == '\n') {
+      result += "\\n";
+    } else if (c < 0x20) {
+      result += fmt::format("\\u{:04x}", c);
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+inline std::string EscapeXml(std::string_view str) {
+  std::string result;
+  for (unsigned char c : str) {
+    switch (c) {
+      case '<':
+        result += "&lt;";
+        break;
+      case '>':
+        result += "&gt;";
+        break;
+      case '&':
+        result += "&amp;";
+        break;
+      case '"':
+        result += "&quot;";
+        break;
+      default:
+        // Not allowed in XML 1.0 at all
+        if (c < 0x20 && c != '\n' && c != '\t' && c != '\r') {
+          result.push_back('?');
+        } else {
+          result.push_back(c);
+        }
+    }
+  }
+  return result;
+}
+
+}  // namespace detail
+
+//////////////////////////////////////////////////////////////////////
+
+inline void WriteJson(FILE* out, const std::vector<TestCase>& tests,
+                      std::string_view backend) {
+  size_t failed = 0;
+  for (auto& t : tests) {
+    failed += !t.Ok();
+  }
+
+  fmt::print(out,
+             "{{\"backend\": \"{}\", \"passed\": {}, \"failed\": {}, "
+             "\"tests\": [",
+             backend, tests.size() - failed, failed);
+
+  for (size_t i = 0; i < tests.size(); i++) {
+    auto& t = tests[i];
+
+    fmt::print(out,
+               "{}\n  {{\"name\": \"{}\", \"path\": \"{}\", \"ok\": {}, "
+               "\"expected\": \"{}\", \"outcome\": \"{}\", "
+               "\"compile_ms\": {:.3f}, \"run_ms\": {:.3f}, "
+               "\"detail\": \"{}\", \"output\": \"{}\"}}",
+               i ? "," : "", detail::EscapeJson(t.name),
+               detail::EscapeJson(t.path.string()), t.Ok(),
+               FormatOutcome(t.expected), FormatOutcome(t.outcome),
+               t.compile_ms, t.run_ms, detail::EscapeJson(t.detail),
+               detail::EscapeJson(t.output));
+  }
+
+  fmt::print(out, "\n]}}\n");
+}
+
+inline void WriteJunit(FILE* out, const std::vector<TestCase>& tests,
+                       std::string_view backend) {
+  size_t failed = 0;
+  double seconds = 0;
+  for (auto& t : tests) {
+    failed += !t.Ok();
+    seconds += (t.compile_ms + t.run_ms) / 1000;
+  }
+
+  fmt::print(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  fmt::print(out,
+             "<testsuite name=\"etude.{}\" tests=\"{}\" failures=\"{}\" "
+             "time=\"{:.3f}\">\n",
+             backend, tests.size(), failed, seconds);
+
+  for (auto& t : tests) {
+    fmt::print(out,
+               "  <testcase name=\"{}\" classname=\"etude.{}\" "
+               "time=\"{:.3f}\">\n",
+               detail::EscapeXml(t.name), backend,
+               (t.compile_ms + t.run_ms) / 1000);
+
+    if (!t.Ok()) {
+      fmt::print(out,
+                 "    <failure message=\"expected {}, got {}\">{}"
+                 "</failure>\n",
+                 FormatOutcome(t.expected), FormatOutcome(t.outcome),
+                 detail::EscapeXml(t.detail));
+    }
+
+    fmt::print(out,
+               "    <properties>\n"
+               "      <property name=\"compile_ms\" value=\"{:.3f}\"/>\n"
+               "      <property name=\"run_ms\" value=\"{:.3f}\"/>\n"
+               "    </properties>\n",
+               t.compile_ms, t.run_ms);
+
+    if (!t.output.empty()) {
+      fmt::print(out, "    <system-out>{}</system-out>\n",
+                 detail::EscapeXml(t.output));
+    }
+
+    fmt::print(out, "  </testcase>\n");
+  }
+
+  fmt::print(out, "</testsuite>\n");
+}
@@ -5,6 +5,7 @@
 #include <lex/token.hpp>
 
 #include <vector>
+#include <string>
 
 //////////////////////////////////////////////////////////////////////
 
@@ -125,6 +126,8 @@ class TypeDeclStatement : public Declaration {
   types::Type* type_;
 
   types::Type* body_;
+
+  Attribute* attributes = nullptr;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -210,6 +213,21 @@ class FunDeclStatement : public Declaration {
   Expression* body_;
 
   ast::scope::Context* layer_ = nullptr;
+
+  // Has a `yield` in the body (set by the ContextBuilder)
+  bool generator_ = false;
+
+  // Set by the instantiator when the IR cache is enabled
+  std::string cache_key_;
+
+  // Probably a hit of the IR cache: the body is still polymorphic,
+  //   only the calls in it are instantiated. It is instantiated when
+  //   needed after all (see IrEmitter::LookUpCache)
+  bool deferred_ = false;
+  std::vector<FnCallExpression*> deferred_calls_;
+
+  // The IR comes from the cache
+  bool cached_ = false;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -124,6 +124,13 @@ void MarkIntrinsics::VisitIf(IfExpression* node) {
   return_value = node;
 }
 
+void MarkIntrinsics::VisitFor(ForExpression* node) {
+  node->condition_ = Eval(node->condition_)->as<Expression>();
+  node->body_ = Eval(node->body_)->as<Expression>();
+
+  return_value = node;
+}
+
 void MarkIntrinsics::VisitMatch(MatchExpression* node) {
   node->against_ = Eval(node->against_)->as<Expression>();
 
@@ -31,6 +31,7 @@ class MarkIntrinsics : public ReturnVisitor<TreeNode*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitFor(ForExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -9,6 +9,7 @@
 
 #include <lex/token.hpp>
 
+#include <optional>
 #include <vector>
 
 //////////////////////////////////////////////////////////////////////
@@ -82,6 +83,9 @@ class BinaryExpression : public Expression {
   types::Type* type_ = nullptr;
 
   bool is_pointer_arithmetic_ = false;
+
+  // `a[i]`, see Parser::ParseIndexingExpression
+  bool indexing_ = false;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -145,10 +149,6 @@ class AddressofExpression : public Expression {
  public:
   AddressofExpression(lex::Token ampersand, LvalueExpression* operand)
       : ampersand_{ampersand}, operand_{operand} {
-    // Transform &*unit -> unit (it works like that in C)
-    if (auto op = dynamic_cast<DereferenceExpression*>(operand_)) {
-      operand_ = op->operand_;
-    }
   }
 
   virtual void Accept(Visitor* visitor) override {
@@ -284,10 +284,18 @@ class CompoundInitializerExpr : public Expression {
     return curly_.location;
   }
 
+  size_t ArrayLength() const {
+    return repeat_.value_or(initializers_.size());
+  }
+
   lex::Token curly_;
 
   std::vector<Member> initializers_;
 
+  // `[a, b, c]` or `[v; N]`: members without field names
+  bool array_ = false;
+  std::optional<size_t> repeat_;  // `N`, zero included
+
   types::Type* type_ = nullptr;
 
   ast::scope::Context* layer_ = nullptr;
@@ -395,6 +403,33 @@ class IfExpression : public Expression {
 
 //////////////////////////////////////////////////////////////////////
 
+// `for condition body`, a while loop of type Unit
+class ForExpression : public Expression {
+ public:
+  ForExpression(lex::Token for_token, Expression* condition, Expression* body)
+      : for_token_{for_token}, condition_{condition}, body_{body} {
+  }
+
+  virtual void Accept(Visitor* visitor) override {
+    visitor->VisitFor(this);
+  }
+
+  virtual types::Type* GetType() override {
+    return &types::builtin_unit;
+  };
+
+  virtual lex::Location GetLocation() override {
+    return for_token_.location;
+  }
+
+  lex::Token for_token_;
+
+  Expression* condition_;
+  Expression* body_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
 class MatchExpression : public Expression {
  public:
   using Bind = std::pair<Pattern*, Expression*>;
@@ -582,8 +617,9 @@ class YieldStatement : public Expression {
     visitor->VisitYield(this);
   }
 
+  // The generator goes on from here when it is resumed
   virtual types::Type* GetType() override {
-    return &types::builtin_never;
+    return &types::builtin_unit;
   }
 
   virtual lex::Location GetLocation() override {
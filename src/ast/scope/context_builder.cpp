@@ -147,10 +147,13 @@ void ContextBuilder::VisitFunDecl(FunDeclStatement* node) {
 
     {
       auto fn = current_fn_;  // For return
+      auto def = current_def_;
       current_fn_ = node->GetName();
+      current_def_ = node;
 
       node->body_->Accept(this);
       current_fn_ = fn;
+      current_def_ = def;
     }
 
     PopScopeLayer();
@@ -237,6 +240,7 @@ void ContextBuilder::VisitImplDecl(ImplDeclaration* node) {
 //////////////////////////////////////////////////////////////////////
 
 void ContextBuilder::VisitYield(YieldStatement* node) {
+  current_def_->generator_ = true;
   node->yield_value_->Accept(this);
 }
 
@@ -318,6 +322,11 @@ void ContextBuilder::VisitIf(IfExpression* node) {
   node->false_branch_->Accept(this);
 }
 
+void ContextBuilder::VisitFor(ForExpression* node) {
+  node->condition_->Accept(this);
+  node->body_->Accept(this);
+}
+
 void ContextBuilder::VisitMatch(MatchExpression* node) {
   node->against_->Accept(this);
 
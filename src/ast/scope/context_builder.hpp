@@ -34,6 +34,7 @@ class ContextBuilder : public AbortVisitor {
   virtual void VisitDeref(DereferenceExpression* node) override;
   virtual void VisitAddressof(AddressofExpression* node) override;
   virtual void VisitIf(IfExpression* node) override;
+  virtual void VisitFor(ForExpression* node) override;
   virtual void VisitMatch(MatchExpression* node) override;
   virtual void VisitNew(NewExpression* node) override;
   virtual void VisitBlock(BlockExpression* node) override;
@@ -56,6 +57,7 @@ class ContextBuilder : public AbortVisitor {
   Module& unit_;
 
   std::string_view current_fn_;
+  FunDeclStatement* current_def_ = nullptr;
 
  public:
   // For dumping all symbols in the program
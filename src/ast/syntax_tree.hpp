@@ -8,17 +8,37 @@
 
 struct Attribute {
   std::string_view value;
+  std::string_view argument{};  // `C` in `@repr(C)`
   Attribute* next = nullptr;
 
   bool FindAttr(std::string_view attr) {
     return attr == value || (next && next->FindAttr(attr));
   }
+
+  bool FindAttr(std::string_view attr, std::string_view arg) {
+    return (attr == value && arg == argument) ||
+           (next && next->FindAttr(attr, arg));
+  }
 };
 
 //////////////////////////////////////////////////////////////////////
 
 class TreeNode {
  public:
+  TreeNode() {
+    allocated_ += 1;
+  }
+
+  // Instantiation clones the nodes, count those too
+  TreeNode(const TreeNode&) {
+    allocated_ += 1;
+  }
+
+  // Nodes created so far, for the phase report
+  static size_t AllocatedCount() {
+    return allocated_;
+  }
+
   virtual void Accept(Visitor* visitor) = 0;
 
   virtual lex::Location GetLocation() = 0;
@@ -29,6 +49,9 @@ class TreeNode {
   T* as() {
     return dynamic_cast<T*>(this);
   }
+
+ private:
+  inline static size_t allocated_ = 0;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -89,6 +89,10 @@ class AbortVisitor : public Visitor {
     std::abort();
   }
 
+  virtual void VisitFor(ForExpression*) override {
+    std::abort();
+  }
+
   virtual void VisitMatch(MatchExpression*) override {
     std::abort();
   }
@@ -1,98 +1,179 @@
 #pragma once
 
 #include <ast/visitors/visitor.hpp>
+
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
 #include <cstdlib>
 
+// Visits every child of a node and does nothing else.
+//   Analyses that only care about a handful of node kinds
+//   override those and call the base method to keep walking.
+
 class JustWalk : public Visitor {
  public:
-  virtual void VisitYield(YieldStatement*) {
-    std::abort();
+  // Statements
+
+  virtual void VisitYield(YieldStatement* node) override {
+    node->yield_value_->Accept(this);
   }
 
-  virtual void VisitReturn(ReturnStatement*) {
-    std::abort();
+  virtual void VisitReturn(ReturnStatement* node) override {
+    node->return_value_->Accept(this);
   }
 
-  virtual void VisitTypeDecl(TypeDeclStatement*) {
-    std::abort();
+  virtual void VisitAssignment(AssignmentStatement* node) override {
+    node->target_->Accept(this);
+    node->value_->Accept(this);
   }
 
-  virtual void VisitVarDecl(VarDeclStatement*) {
-    std::abort();
+  virtual void VisitExprStatement(ExprStatement* node) override {
+    node->expr_->Accept(this);
   }
 
-  virtual void VisitFunDecl(FunDeclStatement*) {
-    std::abort();
+  // Declarations
+
+  virtual void VisitTypeDecl(TypeDeclStatement*) override {
   }
 
-  virtual void VisitAssignment(AssignmentStatement*) {
-    std::abort();
+  virtual void VisitVarDecl(VarDeclStatement* node) override {
+    node->value_->Accept(this);
   }
 
-  virtual void VisitExprStatement(ExprStatement*) {
+  virtual void VisitFunDecl(FunDeclStatement* node) override {
+    if (node->body_) {
+      node->body_->Accept(this);
+    }
+  }
+
+  virtual void VisitTraitDecl(TraitDeclaration* node) override {
+    for (auto method : node->methods_) {
+      method->Accept(this);
+    }
+  }
+
+  virtual void VisitImplDecl(ImplDeclaration* node) override {
+    for (auto method : node->trait_methods_) {
+      method->Accept(this);
+    }
+  }
+
+  // Patterns
+
+  virtual void VisitBindingPat(BindingPattern*) override {
+  }
+
+  virtual void VisitDiscardingPat(DiscardingPattern*) override {
+  }
+
+  virtual void VisitLiteralPat(LiteralPattern* node) override {
+    node->pat_->Accept(this);
+  }
+
+  virtual void VisitStructPat(StructPattern*) override {
     std::abort();
   }
 
+  virtual void VisitVariantPat(VariantPattern* node) override {
+    if (node->inner_pat_) {
+      node->inner_pat_->Accept(this);
+    }
+  }
+
   // Expressions
 
-  virtual void VisitComparison(ComparisonExpression*) {
-    std::abort();
+  virtual void VisitComparison(ComparisonExpression* node) override {
+    node->left_->Accept(this);
+    node->right_->Accept(this);
   }
 
-  virtual void VisitBinary(BinaryExpression*) {
-    std::abort();
+  virtual void VisitBinary(BinaryExpression* node) override {
+    node->left_->Accept(this);
+    node->right_->Accept(this);
   }
 
-  virtual void VisitUnary(UnaryExpression*) {
-    std::abort();
+  virtual void VisitUnary(UnaryExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitDeref(DereferenceExpression*) {
-    std::abort();
+  virtual void VisitDeref(DereferenceExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitAddressof(AddressofExpression*) {
-    std::abort();
+  virtual void VisitAddressof(AddressofExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitIf(IfExpression*) {
-    std::abort();
+  virtual void VisitIf(IfExpression* node) override {
+    node->condition_->Accept(this);
+    node->true_branch_->Accept(this);
+    node->false_branch_->Accept(this);
   }
 
-  virtual void VisitNew(NewExpression*) {
-    std::abort();
+  virtual void VisitFor(ForExpression* node) override {
+    node->condition_->Accept(this);
+    node->body_->Accept(this);
   }
 
-  virtual void VisitBlock(BlockExpression*) {
-    std::abort();
+  virtual void VisitMatch(MatchExpression* node) override {
+    node->against_->Accept(this);
+    for (auto& [pat, expr] : node->patterns_) {
+      pat->Accept(this);
+      expr->Accept(this);
+    }
   }
 
-  virtual void VisitFnCall(FnCallExpression*) {
-    std::abort();
+  virtual void VisitNew(NewExpression* node) override {
+    if (node->allocation_size_) {
+      node->allocation_size_->Accept(this);
+    }
+    if (node->initial_value_) {
+      node->initial_value_->Accept(this);
+    }
   }
 
-  virtual void VisitInstrinsic(IntrinsicCall*) {
-    std::abort();
+  virtual void VisitBlock(BlockExpression* node) override {
+    for (auto stmt : node->stmts_) {
+      stmt->Accept(this);
+    }
+    if (node->final_) {
+      node->final_->Accept(this);
+    }
   }
 
-  virtual void VisitCompoundInitalizer(CompoundInitializerExpr*) {
-    std::abort();
+  virtual void VisitFnCall(FnCallExpression* node) override {
+    for (auto arg : node->arguments_) {
+      arg->Accept(this);
+    }
   }
 
-  virtual void VisitFieldAccess(FieldAccessExpression*) {
-    std::abort();
+  virtual void VisitIntrinsic(IntrinsicCall* node) override {
+    for (auto arg : node->arguments_) {
+      arg->Accept(this);
+    }
   }
 
-  virtual void VisitVarAccess(VarAccessExpression*) {
-    std::abort();
+  virtual void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+    for (auto& mem : node->initializers_) {
+      if (mem.init) {
+        mem.init->Accept(this);
+      }
+    }
   }
 
-  virtual void VisitLiteral(LiteralExpression*) {
-    std::abort();
+  virtual void VisitFieldAccess(FieldAccessExpression* node) override {
+    node->struct_expression_->Accept(this);
   }
 
-  virtual void VisitTypecast(TypecastExpression*) {
-    std::abort();
+  virtual void VisitVarAccess(VarAccessExpression*) override {
+  }
+
+  virtual void VisitLiteral(LiteralExpression*) override {
+  }
+
+  virtual void VisitTypecast(TypecastExpression* node) override {
+    node->expr_->Accept(this);
   }
 };
 
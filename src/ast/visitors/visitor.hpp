@@ -9,6 +9,7 @@ class UnaryExpression;
 class DereferenceExpression;
 class AddressofExpression;
 class IfExpression;
+class ForExpression;
 class MatchExpression;
 class NewExpression;
 class BlockExpression;
@@ -98,6 +99,8 @@ class Visitor {
 
   virtual void VisitIf(IfExpression* node) = 0;
 
+  virtual void VisitFor(ForExpression* node) = 0;
+
   virtual void VisitMatch(MatchExpression* node) = 0;
 
   virtual void VisitNew(NewExpression* node) = 0;
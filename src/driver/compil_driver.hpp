@@ -1,6 +1,7 @@
 #pragma once
 
 #include <driver/driver_errors.hpp>
+#include <driver/phase_report.hpp>
 
 #include <types/constraints/generate/algorithm_w.hpp>
 #include <types/instantiate/instantiator.hpp>
@@ -13,12 +14,14 @@
 #include <parse/parser.hpp>
 
 #include <qbe/ir_emitter.hpp>
+#include <qbe/ir_cache.hpp>
 
 #include <fmt/color.h>
 
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <optional>
 #include <sstream>
 #include <set>
 
@@ -72,12 +75,20 @@ class CompilationDriver {
     auto source = OpenFile(name);
     auto lexer = lex::Lexer{std::move(source)};
 
-    auto mod = Parser{lexer}.ParseModule();
-    mod->SetName(name);
+    auto mod = ParseWith(name, lexer);
 
     return {std::move(mod), std::move(lexer)};
   }
 
+  // The module keeps pointing into the lexer's buffer
+  std::unique_ptr<Module> ParseWith(std::string_view name, lex::Lexer& lexer) {
+    PhaseReport::Scope phase{GetReport(), "parse", name};
+
+    auto mod = Parser{lexer}.ParseModule();
+    mod->SetName(name);
+    return mod;
+  }
+
   auto ParseAllModules() {
     auto [main, lex] = ParseOneModule(main_module_);
     std::unordered_map<std::string_view, walk_status> visited;
@@ -87,16 +98,20 @@ class CompilationDriver {
 
   auto RegisterSymbols() {
     for (auto& m : modules_) {
-      for (auto& exported_sym : m->exported_) {
-        auto did_insert = module_of_.insert({exported_sym, m.get()}).second;
+      RegisterSymbols(m.get());
+    }
+  }
 
-        // THINK: Is module import transitive?
+  void RegisterSymbols(Module* m) {
+    for (auto& exported_sym : m->exported_) {
+      auto did_insert = module_of_.insert({exported_sym, m}).second;
 
-        if (!did_insert) {
-          // Be conservative for now
-          throw std::runtime_error{
-              fmt::format("Conflicting exported symbols {}", exported_sym)};
-        }
+      // THINK: Is module import transitive?
+
+      if (!did_insert) {
+        // Be conservative for now
+        throw std::runtime_error{
+            fmt::format("Conflicting exported symbols {}", exported_sym)};
       }
     }
   }
@@ -133,19 +148,43 @@ class CompilationDriver {
 
   // All its dependencies have already been completed
   void ProcessModule(Module* one) {
-    one->BuildContext(this);
+    {
+      PhaseReport::Scope phase{GetReport(), "context", one->GetName()};
+      one->BuildContext(this);
+    }
+
+    PhaseReport::Scope phase{GetReport(), "intrinsics", one->GetName()};
     one->MarkIntrinsics();
   }
 
-  void SetTestBuild() {
-    test_build = true;
+  void InferTypes(Module* one) {
+    PhaseReport::Scope phase{GetReport(), "infer", one->GetName()};
+
+    auto solved = solver_.SolvedCount();
+    one->InferTypes(solver_);
+    phase.AddConstraints(solver_.SolvedCount() - solved);
+  }
+
+  void SetTestBuild(bool enable = true) {
+    test_build = enable;
   }
 
   void SetMainModule(const char* mod) {
     main_module_ = mod;
   }
 
-  void Compile() {
+  // Reuse the IR of unchanged instantiations from the previous builds
+  void SetCacheDir(std::filesystem::path dir) {
+    ir_cache_.emplace(std::move(dir));
+  }
+
+  // Measure the phases (see PhaseReport)
+  void EnableReport() {
+    report_.emplace();
+  }
+
+  // Returns the QBE IR of the whole program
+  std::string Compile() {
     ParseAllModules();
     RegisterSymbols();
 
@@ -155,20 +194,48 @@ class CompilationDriver {
     }
 
     for (auto& m : modules_) {
-      m->InferTypes(solver_);
+      InferTypes(m.get());
+    }
+
+    std::vector<Module*> program;
+    for (auto& m : modules_) {
+      program.push_back(m.get());
     }
 
+    return Instantiate(program);
+  }
+
+  // All the modules are checked, the main one is the last of them
+  std::string Instantiate(const std::vector<Module*>& program) {
+    auto main_module = program.back();
+
     if (test_build) {
-      FMT_ASSERT(modules_.back()->GetName() == main_module_,
+      FMT_ASSERT(main_module->GetName() == main_module_,
                  "Last module should be the main one");
-      modules_.back()->Compile(nullptr);  // CompileTests
-      return;
+
+      // The tests of every module, instantiated and emitted at once
+      std::vector<FunDeclStatement*> tests;
+      for (auto m : program) {
+        tests.insert(tests.end(), m->GetTests().begin(), m->GetTests().end());
+      }
+
+      return main_module->Compile(nullptr, std::move(tests), GetIrCache(),
+                                  GetReport());
     }
 
     auto inst_root = module_of_.at("main");
     auto main_sym = inst_root->GetExportedSymbol("main");
 
-    inst_root->Compile(main_sym->GetFunctionDefinition());
+    return inst_root->Compile(main_sym->GetFunctionDefinition(), {},
+                              GetIrCache(), GetReport());
+  }
+
+  qbe::IrCache* GetIrCache() {
+    return ir_cache_ ? &*ir_cache_ : nullptr;
+  }
+
+  PhaseReport* GetReport() {
+    return report_ ? &*report_ : nullptr;
   }
 
   Module* GetModuleOf(std::string_view symbol) {
@@ -187,4 +254,8 @@ class CompilationDriver {
   bool test_build = false;
 
   types::constraints::ConstraintSolver solver_;
+
+  std::optional<qbe::IrCache> ir_cache_;
+
+  std::optional<PhaseReport> report_;
 };
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <driver/compil_driver.hpp>
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <unordered_set>
+#include <cstdio>
+#include <memory>
+#include <map>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// Long-lived driver that keeps the checked modules between
+//   requests. A module is parsed and checked again only if
+//   its source changed or one of its imports was rebuilt.
+//
+// Requests are lines, responses are `ok <size>` or `error <size>`
+//   followed by a newline and that many bytes:
+//
+//   file <module> <size>\n<size bytes>   unsaved contents of a module
+//   drop <module>                        forget the unsaved contents
+//   check <module>                       parse and infer types
+//   compile <module>                     emit QBE IR of the program
+//   test <module>                        emit QBE IR of the tests
+//   quit                                 stop the server
+
+class CompileServer : public CompilationDriver {
+ public:
+  // Start over once this many types are allocated: the types of
+  //   the replaced modules are never freed otherwise
+  static constexpr size_t kMaxTypes = 1 << 22;
+
+  CompileServer(std::string_view main_mod = "main")
+      : CompilationDriver{main_mod} {
+  }
+
+  virtual lex::InputFile OpenFile(std::string_view name) override {
+    if (auto it = overlay_.find(name); it != overlay_.end()) {
+      auto abs_path = std::filesystem::absolute(std::string{name} + ".et");
+      return lex::InputFile{std::stringstream{it->second}, std::move(abs_path)};
+    }
+
+    return CompilationDriver::OpenFile(name);
+  }
+
+  // Returns false after `quit`, true when the input is over
+  bool Serve(FILE* in, FILE* out) {
+    std::string line;
+
+    while (ReadLine(in, line)) {
+      auto [command, args] = Split(line);
+
+      if (command == "quit") {
+        Respond(out, "ok", "");
+        return false;
+      }
+
+      try {
+        Respond(out, "ok", Execute(command, args, in));
+      } catch (const ErrorAtLocation& error) {
+        Respond(out, "error",
+                fmt::format("{}: {}", error.where().Format(), error.what()));
+      } catch (const std::exception& error) {
+        Respond(out, "error", error.what());
+      }
+    }
+
+    return true;
+  }
+
+#if !defined(_WIN32)
+  // Serves the clients one after another
+  void Listen(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error{fmt::format("Socket path {} is too long", path)};
+    }
+
+    std::strcpy(addr.sun_path, path.c_str());
+
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 1) < 0) {
+      throw std::runtime_error{fmt::format("Could not listen on {}: {}", path,
+                                           std::strerror(errno))};
+    }
+
+    for (bool running = true; running;) {
+      auto conn = accept(fd, nullptr, nullptr);
+
+      if (conn < 0) {
+        continue;
+      }
+
+      auto in = fdopen(conn, "r");
+      auto out = fdopen(dup(conn), "w");
+
+      running = Serve(in, out);
+
+      std::fclose(out);
+      std::fclose(in);
+    }
+
+    close(fd);
+    unlink(path.c_str());
+  }
+#endif
+
+ private:
+  struct Unit {
+    std::string source;
+
+    // The module points into the buffer of its lexer
+    std::unique_ptr<lex::Lexer> lexer;
+    std::unique_ptr<Module> module;
+
+    // Went through type inference
+    bool checked = false;
+
+    // When it was last parsed, and what was the latest parse when
+    //   it was checked: an import parsed after that was rebuilt
+    //   under this one, which still points into the old one
+    uint64_t generation = 0;
+    uint64_t checked_at = 0;
+  };
+
+  using Visited = std::unordered_map<std::string_view, walk_status>;
+
+  //////////////////////////////////////////////////////////////////////
+
+  std::string Execute(std::string_view command, std::string_view args,
+                      FILE* in) {
+    if (command == "file") {
+      auto [name, size] = Split(args);
+      auto& contents = overlay_[std::string{name}];
+      contents.resize(std::stoul(std::string{size}));
+
+      if (std::fread(contents.data(), 1, contents.size(), in) !=
+          contents.size()) {
+        throw std::runtime_error{"Unexpected end of input"};
+      }
+
+      return "";
+    }
+
+    if (command == "drop") {
+      if (auto it = overlay_.find(args); it != overlay_.end()) {
+        overlay_.erase(it);
+      }
+      return "";
+    }
+
+    if (command == "check") {
+      Check(args);
+      return "";
+    }
+
+    if (command == "compile" || command == "test") {
+      SetTestBuild(command == "test");
+      Check(args);
+      return Instantiate(program_);
+    }
+
+    throw std::runtime_error{fmt::format("Unknown request '{}'", command)};
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  // Brings the program rooted at `main` up to date,
+  //   returns the main module
+  Module* Check(std::string_view main) {
+    if (types::TypeStorageSize() > kMaxTypes) {
+      units_.clear();
+      types::ClearTypeStorage();
+    }
+
+    // Types of the replaced modules point to freed contexts
+    types::MarkTypesChecked();
+
+    module_of_.clear();
+    solver_ = types::constraints::ConstraintSolver{};
+
+    std::vector<Unit*> order;
+    Visited visited;
+
+    try {
+      auto root = Visit(main, order, visited);
+      main_module_ = root->module->GetName();
+
+      for (auto unit : order) {
+        RegisterSymbols(unit->module.get());
+      }
+
+      // Dependencies first, as in Compile()
+      for (auto unit : order) {
+        if (!unit->checked) {
+          ProcessModule(unit->module.get());
+        }
+      }
+
+      for (auto unit : order) {
+        if (!unit->checked) {
+          InferTypes(unit->module.get());
+        }
+      }
+
+      program_.clear();
+
+      for (auto unit : order) {
+        if (!unit->checked) {
+          unit->checked = true;
+          unit->checked_at = generation_;
+        }
+
+        program_.push_back(unit->module.get());
+      }
+
+      return root->module.get();
+    } catch (...) {
+      // Half-checked modules are of no use, start them over next time
+      for (auto& [_, unit] : units_) {
+        if (!unit.checked) {
+          Forget(unit);
+        }
+      }
+      throw;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  // Like TopSort(...), but reuses the checked modules
+  Unit* Visit(std::string_view name, std::vector<Unit*>& order,
+              Visited& visited) {
+    auto [it, _] = units_.try_emplace(std::string{name});
+    auto& unit = it->second;
+
+    // Module names point here, it outlives the module
+    name = it->first;
+
+    visited.insert_or_assign(name, IN_PROGRESS);
+
+    auto text = OpenFile(name).stream.str();
+
+    if (unit.module && unit.source != text) {
+      Forget(unit);
+    }
+
+    if (!unit.module) {
+      Parse(unit, name, std::move(text));
+    }
+
+    auto stale = !unit.checked;
+
+    for (auto& m : unit.module->imports_) {
+      if (visited.contains(m.GetName())) {
+        if (visited[m.GetName()] == IN_PROGRESS) {
+          throw ErrorAtLocation(m.location, "Cycle in import higherarchy");
+        }
+      } else {
+        try {
+          Visit(m.GetName(), order, visited);
+        } catch (const std::exception& exc) {
+          throw ErrorAtLocation(m.location, std::string(exc.what()));
+        }
+      }
+
+      auto& import = units_.find(m.GetName())->second;
+      stale |= !import.checked || import.generation > unit.checked_at;
+    }
+
+    // An import changed, the symbols and types of this one may be off
+    if (stale && unit.checked) {
+      auto source = std::move(unit.source);
+      Forget(unit);
+      Parse(unit, name, std::move(source));
+    }
+
+    visited.insert_or_assign(name, FINISHED);
+    order.push_back(&unit);
+
+    return &unit;
+  }
+
+  void Parse(Unit& unit, std::string_view name, std::string text) {
+    auto source =
+        lex::InputFile{std::stringstream{text},
+                       std::filesystem::absolute(std::string{name} + ".et")};
+
+    unit.source = std::move(text);
+    unit.lexer = std::make_unique<lex::Lexer>(std::move(source));
+    unit.module = ParseWith(name, *unit.lexer);
+    unit.generation = generation_ += 1;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  // Finds the trait declarations and impls among the items
+  struct TraitsAndImpls : JustWalk {
+    void VisitFunDecl(FunDeclStatement*) override {
+    }
+
+    void VisitVarDecl(VarDeclStatement*) override {
+    }
+
+    void VisitTraitDecl(TraitDeclaration* node) override {
+      traits.push_back(node);
+    }
+
+    void VisitImplDecl(ImplDeclaration* node) override {
+      impls.insert(node);
+    }
+
+    std::vector<TraitDeclaration*> traits;
+    std::unordered_set<ImplDeclaration*> impls;
+  };
+
+  // Impls register themselves in the traits of other modules,
+  //   those have to forget them before the module goes away
+  void Forget(Unit& unit) {
+    if (unit.module) {
+      TraitsAndImpls gone;
+      unit.module->RunTooling(&gone);
+
+      for (auto& [_, other] : units_) {
+        if (&other == &unit || !other.module) {
+          continue;
+        }
+
+        TraitsAndImpls kept;
+        other.module->RunTooling(&kept);
+
+        for (auto trait : kept.traits) {
+          std::erase_if(trait->impls_, [&](ImplDeclaration* impl) {
+            return gone.impls.contains(impl);
+          });
+        }
+      }
+    }
+
+    unit.module.reset();
+    unit.lexer.reset();
+    unit.checked = false;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  static bool ReadLine(FILE* in, std::string& line) {
+    line.clear();
+
+    for (int c; (c = std::fgetc(in)) != EOF;) {
+      if (c == '\n') {
+        return true;
+      }
+      line.push_back((char)c);
+    }
+
+    return !line.empty();
+  }
+
+  static auto Split(std::string_view line)
+      -> std::pair<std::string_view, std::string_view> {
+    auto space = line.find(' ');
+
+    if (space == line.npos) {
+      return {line, {}};
+    }
+
+    return {line.substr(0, space), line.substr(space + 1)};
+  }
+
+  static void Respond(FILE* out, std::string_view status,
+                      std::string_view payload) {
+    fmt::print(out, "{} {}\n{}", status, payload.size(), payload);
+    std::fflush(out);
+  }
+
+ private:
+  // Unsaved contents of files, take priority over the disk
+  std::map<std::string, std::string, std::less<>> overlay_;
+
+  std::map<std::string, Unit, std::less<>> units_;
+
+  // Modules of the last checked program, the root last
+  std::vector<Module*> program_;
+
+  uint64_t generation_ = 0;
+};
@@ -10,12 +10,15 @@
 #include <ast/visitors/visitor.hpp>
 #include <ast/declarations.hpp>
 
+#include <driver/phase_report.hpp>
+
 #include <qbe/ir_emitter.hpp>
 
 #include <lex/location.hpp>
 
 #include <cassert>
 #include <filesystem>
+#include <optional>
 
 //////////////////////////////////////////////////////////////////////
 
@@ -63,25 +66,45 @@ class Module {
     solver.CollectAndSolve(items_);
   }
 
-  auto CompileMain(Declaration* main) {
-    types::instantiate::TemplateInstantiator inst(main);
-    return inst.Flush();
-  }
+  // Instantiates from `main` or, in a test build (`main` is null),
+  //   from `tests`, collected from all the modules
+  std::string Compile(Declaration* main,
+                      std::vector<FunDeclStatement*> tests = {},
+                      qbe::IrCache* cache = nullptr,
+                      PhaseReport* report = nullptr) {
+    PhaseReport::Scope instantiate{report, "instantiate", name_};
+
+    // Stays around for the bodies the emitter asks for later
+    std::optional<types::instantiate::TemplateInstantiator> inst;
+
+    if (main) {
+      inst.emplace(main, cache);
+    } else {
+      inst.emplace(tests, cache);
+    }
 
-  auto CompileTests() {
-    types::instantiate::TemplateInstantiator inst(tests_);
-    return inst.Flush();
-  }
+    auto [funs, gen_ty_list] = inst->Flush();
 
-  void Compile(Declaration* main) {
-    auto [funs, gen_ty_list] = [&]() {
-      return main ? CompileMain(main) : CompileTests();
-    }();
+    instantiate.AddInstantiations(funs.size());
+    instantiate.Finish();
 
-    qbe::IrEmitter ir;
+    PhaseReport::Scope emit{report, "emit", name_};
+
+    qbe::IrEmitter ir{cache};
     ir.EmitTypes(std::move(gen_ty_list));
+    ir.LookUpCache(funs, [&inst](FunDeclStatement* f) {
+      inst->InstantiateBody(f);
+    });
+    // Calls are evaluated before the inliner takes them apart,
+    //   what it exposes is folded after
+    ir.FoldConstants(funs);
+    ir.InlineCalls(funs);
+    ir.FoldConstants(funs);
+    ir.AnalyzeEscapes(funs);
 
     for (auto f : funs) f->Accept(&ir);
+
+    return ir.Finish();
   }
 
   std::string_view GetName() const {
@@ -105,6 +128,10 @@ class Module {
     return abs_path_;
   }
 
+  const std::vector<FunDeclStatement*>& GetTests() const {
+    return tests_;
+  }
+
 private:
   // Only accessible for CompilationDriver to set the name
   //   after the module was parsed.
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <types/type.hpp>
+
+#include <ast/syntax_tree.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+// Where the compile time and memory go: one entry per phase
+//   per module, printed as a table (`etc -r`) or written as
+//   Chrome trace JSON (`etc -j trace.json`, open it in
+//   chrome://tracing or ui.perfetto.dev).
+
+class PhaseReport {
+ public:
+  struct Phase {
+    std::string name;
+    std::string module;
+
+    // Microseconds, `start` is since the report was created
+    double start = 0;
+    double wall = 0;
+    double cpu = 0;
+
+    // Kilobytes, the peak of the whole process so far
+    long peak_rss = 0;
+
+    // Created during the phase
+    size_t types = 0;
+    size_t nodes = 0;
+    size_t constraints = 0;
+    size_t instantiations = 0;
+  };
+
+  // Measures from construction to `Finish()` or destruction,
+  //   does nothing without a report
+  class Scope {
+   public:
+    Scope(PhaseReport* report, std::string_view name, std::string_view module)
+        : report_{report} {
+      if (!report_) {
+        return;
+      }
+
+      phase_.name = name;
+      phase_.module = module;
+      phase_.start = report_->SinceStart();
+
+      cpu_ = CpuTime();
+      types_ = types::TypeStorageSize();
+      nodes_ = TreeNode::AllocatedCount();
+    }
+
+    Scope(const Scope&) = delete;
+
+    ~Scope() {
+      Finish();
+    }
+
+    void AddConstraints(size_t count) {
+      phase_.constraints += count;
+    }
+
+    void AddInstantiations(size_t count) {
+      phase_.instantiations += count;
+    }
+
+    void Finish() {
+      if (!report_) {
+        return;
+      }
+
+      phase_.wall = report_->SinceStart() - phase_.start;
+      phase_.cpu = CpuTime() - cpu_;
+      phase_.peak_rss = PeakRss();
+
+      // The storage may have been cleared meanwhile (compile server)
+      auto types = types::TypeStorageSize();
+      phase_.types = types > types_ ? types - types_ : 0;
+      phase_.nodes = TreeNode::AllocatedCount() - nodes_;
+
+      report_->phases_.push_back(std::move(phase_));
+      report_ = nullptr;
+    }
+
+   private:
+    PhaseReport* report_;
+    Phase phase_;
+
+    double cpu_ = 0;
+    size_t types_ = 0;
+    size_t nodes_ = 0;
+  };
+
+  //////////////////////////////////////////////////////////////////////
+
+  PhaseReport() : start_{std::chrono::steady_clock::now()} {
+  }
+
+  const std::vector<Phase>& Phases() const {
+    return phases_;
+  }
+
+  void PrintTable(FILE* out) const {
+    fmt::print(out,
+               "{:<12} {:<24} {:>10} {:>10} {:>10} {:>8} {:>8} {:>8} {:>8}\n",
+               "phase", "module", "wall ms", "cpu ms", "rss KiB", "types",
+               "nodes", "constr", "inst");
+
+    Phase total;
+    total.name = "total";
+
+    for (auto& p : phases_) {
+      PrintRow(out, p);
+
+      total.wall += p.wall;
+      total.cpu += p.cpu;
+      total.peak_rss = std::max(total.peak_rss, p.peak_rss);
+      total.types += p.types;
+      total.nodes += p.nodes;
+      total.constraints += p.constraints;
+      total.instantiations += p.instantiations;
+    }
+
+    PrintRow(out, total);
+  }
+
+  void WriteTrace(FILE* out) const {
+    fmt::print(out, "{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+    for (size_t i = 0; i < phases_.size(); i++) {
+      auto& p = phases_[i];
+
+      fmt::print(out,
+                 "{}\n  {{\"name\": \"{}\", \"cat\": \"etc\", \"ph\": \"X\", "
+                 "\"pid\": 1, \"tid\": 1, \"ts\": {:.3f}, \"dur\": {:.3f}, "
+                 "\"args\": {{\"module\": \"{}\", \"cpu_us\": {:.3f}, "
+                 "\"peak_rss_kb\": {}, \"types\": {}, \"nodes\": {}, "
+                 "\"constraints\": {}, \"instantiations\": {}}}}}",
+                 i ? "," : "", Escape(p.name), p.start, p.wall, Escape(p.module),
+                 p.cpu, p.peak_rss, p.types, p.nodes, p.constraints,
+                 p.instantiations);
+    }
+
+    fmt::print(out, "\n]}}\n");
+  }
+
+ private:
+  static void PrintRow(FILE* out, const Phase& p) {
+    fmt::print(out,
+               "{:<12} {:<24} {:>10.3f} {:>10.3f} {:>10} {:>8} {:>8} {:>8} "
+               "{:>8}\n",
+               p.name, p.module, p.wall / 1000, p.cpu / 1000, p.peak_rss,
+               p.types, p.nodes, p.constraints, p.instantiations);
+  }
+
+  // Like `EscapeJson` of the test runner
+  static std::string Escape(std::string_view str) {
+    std::string result;
+    for (unsigned char c : str) {
+      if (c == '"' || c == '\\') {
+        result.push_back('\\');
+        result.push_back(c);
+      } else if (c < 0x20) {
+        result += fmt::format("\\u{:04x}", c);
+      } else {
+        result.push_back(c);
+      }
+    }
+    return result;
+  }
+
+  double SinceStart() const {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+  }
+
+  // Microseconds of user and system time
+  static double CpuTime() {
+#if !defined(_WIN32)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+    return std::clock() * (1e6 / CLOCKS_PER_SEC);
+#endif
+  }
+
+  static long PeakRss() {
+#if defined(__APPLE__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;  // Bytes there
+#elif !defined(_WIN32)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+
+  std::vector<Phase> phases_;
+};
@@ -32,6 +32,12 @@ class IdentTable {
     map_.insert({"Char", TokenType::TY_CHAR});
     map_.insert({"Unit", TokenType::TY_UNIT});
     map_.insert({"Int", TokenType::TY_INT});
+    map_.insert({"I64", TokenType::TY_I64});
+    map_.insert({"U8", TokenType::TY_U8});
+    map_.insert({"U32", TokenType::TY_U32});
+    map_.insert({"U64", TokenType::TY_U64});
+    map_.insert({"F32", TokenType::TY_F32});
+    map_.insert({"F64", TokenType::TY_F64});
 
     map_.insert({"return", TokenType::RETURN});
     map_.insert({"struct", TokenType::STRUCT});
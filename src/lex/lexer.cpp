@@ -1,5 +1,7 @@
 #include <lex/lexer.hpp>
 
+#include <ast/error_at_location.hpp>
+
 namespace lex {
 
 Lexer::Lexer(lex::InputFile source) : scanner_{std::move(source)} {
@@ -271,24 +273,42 @@ std::optional<Token> Lexer::MatchCharLiteral() {
   // Consume enclosing '
   scanner_.MoveRight();
 
-  return Token{TokenType::CHAR, scanner_.GetLocation(), {value}};
+  return Token{TokenType::CHAR, scanner_.GetLocation(),
+               {uint64_t{static_cast<unsigned char>(value)}}};
 }
 
 ////////////////////////////////////////////////////////////////////
 
+auto Digit(char ch) -> bool {
+  return isdigit(ch);
+}
+
 std::optional<Token> Lexer::MatchNumericLiteral() {
-  int result = 0, match_span = 0;
+  if (!Digit(scanner_.CurrentSymbol())) {
+    return std::nullopt;
+  }
 
-  while (isdigit(scanner_.CurrentSymbol())) {
-    result *= 10;
-    result += scanner_.CurrentSymbol() - '0';
+  auto digits = scanner_.ViewWhile<Digit>();
 
+  // 1.5 is kept as written, QBE takes it so (`d_1.5`)
+  if (scanner_.CurrentSymbol() == '.' && Digit(scanner_.PeekNextSymbol())) {
     scanner_.MoveRight();
-    match_span += 1;
+    auto fraction = scanner_.ViewWhile<Digit>();
+    auto text = std::string_view(digits.begin(), fraction.end());
+    return Token{TokenType::FLOAT, scanner_.GetLocation(), {text}};
   }
 
-  if (match_span == 0) {
-    return std::nullopt;
+  uint64_t result = 0;
+
+  for (auto digit : digits) {
+    uint64_t next = digit - '0';
+
+    if (result > (UINT64_MAX - next) / 10) {
+      throw ErrorAtLocation(scanner_.GetLocation(),
+                            "Integer literal does not fit into 64 bits");
+    }
+
+    result = result * 10 + next;
   }
 
   return Token{TokenType::NUMBER, scanner_.GetLocation(), {result}};
@@ -4,6 +4,7 @@
 
 #include <variant>
 #include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 namespace lex {
@@ -14,7 +15,7 @@ struct Token {
   using SemInfo = std::variant<  //
       std::monostate,            //
       std::string_view,          //
-      int                        //
+      uint64_t                   // Of the type it is given later
       >;
 
   Token(TokenType type, Location start, SemInfo sem_info = {})
@@ -65,7 +66,11 @@ struct Token {
         //   least) and that the number doesn't have leading zeroes.
         // If that doesn't hold, computed lengths is not the same
         //   that length in file. But we need length in file..
-        return std::to_string(std::get<int>(sem_info)).size();
+        return std::to_string(std::get<uint64_t>(sem_info)).size();
+      }
+      case TokenType::FLOAT: {
+        // 1.5, as written
+        return std::get<std::string_view>(sem_info).size();
       }
       case TokenType::CHAR: {
         // 'c'
@@ -156,6 +161,12 @@ struct Token {
       case TokenType::UNDERSCORE:   return "_"sv.size();
 
       case TokenType::TY_INT:       return "int"sv.size();
+      case TokenType::TY_I64:       return "I64"sv.size();
+      case TokenType::TY_U8:        return "U8"sv.size();
+      case TokenType::TY_U32:       return "U32"sv.size();
+      case TokenType::TY_U64:       return "U64"sv.size();
+      case TokenType::TY_F32:       return "F32"sv.size();
+      case TokenType::TY_F64:       return "F64"sv.size();
       case TokenType::TY_BOOL:      return "bool"sv.size();
       case TokenType::TY_CHAR:      return "char"sv.size();
       case TokenType::TY_UNIT:      return "()"sv.size();
@@ -9,6 +9,7 @@ namespace lex {
 // clang-format off
 #define AST_NODE_LIST(code) \
   code(NUMBER)              \
+  code(FLOAT)               \
   code(CHAR)                \
   code(STRING)              \
   code(IDENTIFIER)          \
@@ -55,6 +56,12 @@ namespace lex {
   code(IMPL)                \
   code(UNDERSCORE)          \
   code(TY_INT)              \
+  code(TY_I64)              \
+  code(TY_U8)               \
+  code(TY_U32)              \
+  code(TY_U64)              \
+  code(TY_F32)              \
+  code(TY_F64)              \
   code(TY_BOOL)             \
   code(TY_CHAR)             \
   code(TY_UNIT)             \
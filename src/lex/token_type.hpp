@@ -8,6 +8,7 @@ namespace lex {
 
 enum class TokenType {
   NUMBER,
+  FLOAT,
   CHAR,
   STRING,
   IDENTIFIER,
@@ -76,6 +77,12 @@ enum class TokenType {
 
 
   TY_INT,
+  TY_I64,
+  TY_U8,
+  TY_U32,
+  TY_U64,
+  TY_F32,
+  TY_F64,
   TY_BOOL,
   TY_CHAR,
   TY_UNIT,
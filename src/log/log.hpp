@@ -0,0 +1,66 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstdio>
+
+// Diagnostics of the compiler itself, not of the program.
+//
+//   ETC_LOG(DEBUG, "{} generalized type {}", name, ty->Format());
+//
+// Levels above ETC_MAX_LOG_LEVEL are compiled out together with
+//   their arguments (which tend to format huge types). The rest
+//   are printed to stderr if the verbosity allows (`etc -v`).
+
+namespace logging {
+
+enum class Level {
+  ERROR,
+  WARN,
+  INFO,
+  DEBUG,
+  TRACE,
+};
+
+#if !defined(ETC_MAX_LOG_LEVEL)
+#if defined(NDEBUG)
+#define ETC_MAX_LOG_LEVEL 2  // INFO
+#else
+#define ETC_MAX_LOG_LEVEL 4  // TRACE
+#endif
+#endif
+
+inline constexpr auto kMaxLevel = Level{ETC_MAX_LOG_LEVEL};
+
+// Only the warnings and errors by default
+inline Level verbosity = Level::WARN;
+
+inline void SetVerbosity(Level level) {
+  verbosity = level;
+}
+
+// Folds to false for the levels that are compiled out
+inline bool Enabled(Level level) {
+  return level <= kMaxLevel && level <= verbosity;
+}
+
+template <typename... Args>
+void Print(Level level, fmt::format_string<Args...> format, Args&&... args) {
+  static constexpr const char* kNames[] = {"error", "warn", "info", "debug",
+                                           "trace"};
+
+  fmt::print(stderr, "[{}] ", kNames[(int)level]);
+  fmt::print(stderr, format, std::forward<Args>(args)...);
+  fmt::print(stderr, "\n");
+}
+
+}  // namespace logging
+
+#define ETC_LOG(level, ...)                                        \
+  do {                                                             \
+    if constexpr (logging::Level::level <= logging::kMaxLevel) {   \
+      if (logging::Enabled(logging::Level::level)) {               \
+        logging::Print(logging::Level::level, __VA_ARGS__);        \
+      }                                                            \
+    }                                                              \
+  } while (false)
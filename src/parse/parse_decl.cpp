@@ -90,11 +90,21 @@ auto Parser::ParseModule() -> std::unique_ptr<Module> {
 
 Attribute* Parser::ParseAttributes() {
   Attribute* attr = nullptr;
+  Attribute** tail = &attr;
 
   while (Matches(lex::TokenType::ATTRIBUTE)) {
     Consume(lex::TokenType::IDENTIFIER);
     auto value = lexer_.GetPreviousToken();
-    attr ? attr->next : attr = new Attribute{value.GetName()};
+
+    *tail = new Attribute{value.GetName()};
+
+    if (Matches(lex::TokenType::LEFT_PAREN)) {
+      Consume(lex::TokenType::IDENTIFIER);
+      (*tail)->argument = lexer_.GetPreviousToken().GetName();
+      Consume(lex::TokenType::RIGHT_PAREN);
+    }
+
+    tail = &(*tail)->next;
   }
 
   return attr;
@@ -152,12 +162,15 @@ FunDeclStatement* Parser::ParseFunDeclarationStandalone() {
 ///////////////////////////////////////////////////////////////////
 
 Declaration* Parser::ParseDeclaration() {
+  // `@repr(C) type ...` or `@test fun ...`
+  auto attrs = ParseAttributes();
+
   types::Type* hint = nullptr;
   if (Matches(lex::TokenType::OF)) {
     hint = ParseFunctionType();
   }
 
-  if (auto type_declaration = ParseTypeDeclStatement()) {
+  if (auto type_declaration = ParseTypeDeclStatement(attrs)) {
     return type_declaration;
   }
 
@@ -173,7 +186,7 @@ Declaration* Parser::ParseDeclaration() {
     return impl_declaration;
   }
 
-  if (auto fun_declaration = ParseFunDeclStatement(hint)) {
+  if (auto fun_declaration = ParseFunDeclStatement(hint, attrs)) {
     return fun_declaration;
   }
 
@@ -182,8 +195,20 @@ Declaration* Parser::ParseDeclaration() {
 
 ///////////////////////////////////////////////////////////////////
 
-FunDeclStatement* Parser::ParseFunDeclStatement(types::Type* hint) {
-  auto attrs = ParseAttributes();
+FunDeclStatement* Parser::ParseFunDeclStatement(types::Type* hint,
+                                                Attribute* attrs) {
+  // `@test of T @inline fun ...` has both
+  auto after_hint = ParseAttributes();
+
+  if (!attrs) {
+    attrs = after_hint;
+  } else {
+    auto last = attrs;
+    while (last->next) {
+      last = last->next;
+    }
+    last->next = after_hint;
+  }
 
   auto proto = ParseFunPrototype(hint);
 
@@ -267,7 +292,7 @@ TraitDeclaration* Parser::ParseTraitDeclaration() {
 
 ///////////////////////////////////////////////////////////////////
 
-TypeDeclStatement* Parser::ParseTypeDeclStatement() {
+TypeDeclStatement* Parser::ParseTypeDeclStatement(Attribute* attrs) {
   if (!Matches(lex::TokenType::TYPE)) {
     return nullptr;
   }
@@ -291,7 +316,15 @@ TypeDeclStatement* Parser::ParseTypeDeclStatement() {
 
   Consume(lex::TokenType::SEMICOLON);
 
-  return new TypeDeclStatement{type_name, std::move(formals), body};
+  // Keep the declaration order of the fields
+  if (attrs && attrs->FindAttr("repr", "C") &&
+      body->tag == types::TypeTag::TY_STRUCT) {
+    body->as_struct.repr_c = true;
+  }
+
+  auto decl = new TypeDeclStatement{type_name, std::move(formals), body};
+  decl->attributes = attrs;
+  return decl;
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -26,6 +26,9 @@ using ParsePrimaryError   = LocationFormattedError<ParsePrimaryErrorFmt>;
 constexpr const char ParseTrueBlockErrorFmt[] = "Could not parse true block at location {}";
 using ParseTrueBlockError = LocationFormattedError<ParseTrueBlockErrorFmt>;
 
+constexpr const char ParseLoopBodyErrorFmt[]  = "Could not parse loop body at location {}";
+using ParseLoopBodyError  = LocationFormattedError<ParseLoopBodyErrorFmt>;
+
 constexpr const char ParseNonLvalueErrorFmt[] = "Expected lvalue at location {}";
 using ParseNonLvalueError = LocationFormattedError<ParseNonLvalueErrorFmt>;
 
@@ -30,6 +30,10 @@ Expression* Parser::ParseKeywordExpresssion() {
     return if_expr;
   }
 
+  if (auto for_expr = ParseForExpression()) {
+    return for_expr;
+  }
+
   if (auto match_expr = ParseMatchExpression()) {
     return match_expr;
   }
@@ -97,6 +101,27 @@ Expression* Parser::ParseIfExpression() {
 
 ////////////////////////////////////////////////////////////////////
 
+// for i < n { ... }
+
+Expression* Parser::ParseForExpression() {
+  if (!Matches(lex::TokenType::FOR)) {
+    return nullptr;
+  }
+
+  auto location_token = lexer_.GetPreviousToken();
+
+  auto condition = ParseExpression();
+  auto body = ParseExpression();
+
+  if (!condition || !body) {
+    throw parse::errors::ParseLoopBodyError(location_token.location);
+  }
+
+  return new ForExpression(location_token, condition, body);
+}
+
+////////////////////////////////////////////////////////////////////
+
 Expression* Parser::ParseMatchExpression() {
   if (!Matches(lex::TokenType::MATCH)) {
     return nullptr;
@@ -203,9 +228,23 @@ Expression* Parser::ParseComparison() {
 ////////////////////////////////////////////////////////////////////
 
 Expression* Parser::ParseBinary() {
-  Expression* first = ParseUnary();
+  Expression* first = ParseMultiplicative();
 
   while (Matches(lex::TokenType::PLUS) || Matches(lex::TokenType::MINUS)) {
+    auto token = lexer_.GetPreviousToken();
+    auto second = ParseMultiplicative();
+    first = new BinaryExpression(first, token, second);
+  }
+
+  return first;
+}
+
+////////////////////////////////////////////////////////////////////
+
+Expression* Parser::ParseMultiplicative() {
+  Expression* first = ParseUnary();
+
+  while (Matches(lex::TokenType::STAR) || Matches(lex::TokenType::DIV)) {
     auto token = lexer_.GetPreviousToken();
     auto second = ParseUnary();
     first = new BinaryExpression(first, token, second);
@@ -329,8 +368,10 @@ Expression* Parser::ParseIndexingExpression(Expression* expr) {
 
   Consume(lex::TokenType::RIGHT_SBRACE);
 
-  return new DereferenceExpression{loc_token,
-                                   new BinaryExpression{expr, plus, add}};
+  auto binary = new BinaryExpression{expr, plus, add};
+  binary->indexing_ = true;
+
+  return new DereferenceExpression{loc_token, binary};
 }
 ////////////////////////////////////////////////////////////////////
 
@@ -432,12 +473,17 @@ Expression* Parser::ParsePrimary() {
     return new LiteralExpression{lex::Token::UnitToken(loc)};
   }
 
+  if (Matches(lex::TokenType::LEFT_SBRACE)) {
+    return ParseArrayLiteral(lexer_.GetPreviousToken());
+  }
+
   // Then all the base cases
 
   auto token = lexer_.Peek();
 
   switch (token.type) {
     case lex::TokenType::NUMBER:
+    case lex::TokenType::FLOAT:
     case lex::TokenType::STRING:
     case lex::TokenType::FALSE:
     case lex::TokenType::CHAR:
@@ -484,6 +530,48 @@ Expression* Parser::ParseCompoundInitializer(lex::Token curly) {
   return new CompoundInitializerExpr{curly, std::move(initializers)};
 }
 
+// [1, 2, 3]  or  [0; 16]
+
+Expression* Parser::ParseArrayLiteral(lex::Token bracket) {
+  std::vector<CompoundInitializerExpr::Member> elements;
+
+  auto element = [&](Expression* init) {
+    elements.push_back({.field = {}, .init = init, .name = bracket});
+  };
+
+  if (!Matches(lex::TokenType::RIGHT_SBRACE)) {
+    element(ParseExpression());
+
+    if (Matches(lex::TokenType::SEMICOLON)) {
+      Consume(lex::TokenType::NUMBER);
+      auto length = std::get<uint64_t>(lexer_.GetPreviousToken().sem_info);
+      Consume(lex::TokenType::RIGHT_SBRACE);
+
+      auto literal = new CompoundInitializerExpr{bracket, std::move(elements)};
+      literal->array_ = true;
+      literal->repeat_ = length;
+      return literal;
+    }
+
+    // The trailing comma is optional
+    bool closed = false;
+
+    while (!closed && Matches(lex::TokenType::COMMA)) {
+      if (!(closed = Matches(lex::TokenType::RIGHT_SBRACE))) {
+        element(ParseExpression());
+      }
+    }
+
+    if (!closed) {
+      Consume(lex::TokenType::RIGHT_SBRACE);
+    }
+  }
+
+  auto literal = new CompoundInitializerExpr{bracket, std::move(elements)};
+  literal->array_ = true;
+  return literal;
+}
+
 // Short-hand notation: .<Tag> <Expr>
 // e.g: .some 5
 Expression* Parser::ParseSignleFieldCompound() {
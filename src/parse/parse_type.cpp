@@ -28,7 +28,7 @@ types::Type* Parser::ParseFunctionType() {
 
 types::Type* Parser::ParsePointerType() {
   if (!Matches(lex::TokenType::STAR)) {
-    return ParseStructType();
+    return ParseArrayType();
   }
 
   return types::MakeTypePtr(ParsePointerType());
@@ -36,6 +36,21 @@ types::Type* Parser::ParsePointerType() {
 
 ///////////////////////////////////////////////////////////////////
 
+// [16]Int, [4]*Char, [2][3]Bool
+types::Type* Parser::ParseArrayType() {
+  if (!Matches(lex::TokenType::LEFT_SBRACE)) {
+    return ParseStructType();
+  }
+
+  Consume(lex::TokenType::NUMBER);
+  auto length = std::get<uint64_t>(lexer_.GetPreviousToken().sem_info);
+  Consume(lex::TokenType::RIGHT_SBRACE);
+
+  return types::MakeArrayType(ParsePointerType(), length);
+}
+
+///////////////////////////////////////////////////////////////////
+
 types::Type* Parser::ParseStructType() {
   if (!Matches(lex::TokenType::STRUCT)) {
     return ParseSumType();
@@ -146,6 +161,24 @@ types::Type* Parser::ParsePrimitiveType() {
     case lex::TokenType::TY_INT:
       return &types::builtin_int;
 
+    case lex::TokenType::TY_I64:
+      return &types::builtin_i64;
+
+    case lex::TokenType::TY_U8:
+      return &types::builtin_u8;
+
+    case lex::TokenType::TY_U32:
+      return &types::builtin_u32;
+
+    case lex::TokenType::TY_U64:
+      return &types::builtin_u64;
+
+    case lex::TokenType::TY_F32:
+      return &types::builtin_f32;
+
+    case lex::TokenType::TY_F64:
+      return &types::builtin_f64;
+
     case lex::TokenType::TY_BOOL:
       return &types::builtin_bool;
 
@@ -38,8 +38,9 @@ class Parser {
 
   TraitDeclaration* ParseTraitDeclaration();
   ImplDeclaration* ParseImplDeclaration();
-  TypeDeclStatement* ParseTypeDeclStatement();
-  FunDeclStatement* ParseFunDeclStatement(types::Type* hint);
+  TypeDeclStatement* ParseTypeDeclStatement(Attribute* attrs = nullptr);
+  FunDeclStatement* ParseFunDeclStatement(types::Type* hint,
+                                          Attribute* attrs = nullptr);
   VarDeclStatement* ParseVarDeclStatement(types::Type* hint);
 
   ////////////////////////////////////////////////////////////////////
@@ -51,6 +52,7 @@ class Parser {
   Expression* ParseReturnStatement();
   Expression* ParseYieldStatement();
   Expression* ParseIfExpression();
+  Expression* ParseForExpression();
   Expression* ParseMatchExpression();
   Expression* ParseNewExpression();
 
@@ -58,6 +60,7 @@ class Parser {
 
   Expression* ParseComparison();
   Expression* ParseBinary();
+  Expression* ParseMultiplicative();
 
   Expression* ParseUnary();
   Expression* ParseDeref();
@@ -73,6 +76,7 @@ class Parser {
 
   Expression* ParseCompoundInitializer(lex::Token id);
   Expression* ParseSignleFieldCompound();
+  Expression* ParseArrayLiteral(lex::Token bracket);
   Expression* ParsePrimary();
 
   ////////////////////////////////////////////////////////////////////
@@ -80,6 +84,7 @@ class Parser {
   types::Type* ParseType();
   types::Type* ParseFunctionType();
   types::Type* ParsePointerType();
+  types::Type* ParseArrayType();
   types::Type* ParseStructType();
   types::Type* ParseSumType();
   types::Type* ParsePrimitiveType();
@@ -0,0 +1,765 @@
+#pragma once
+
+#include <qbe/const_fold.hpp>
+#include <qbe/measure.hpp>
+
+#include <ast/visitors/template_visitor.hpp>
+#include <ast/scope/context.hpp>
+
+#include <ast/expressions.hpp>
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
+#include <unordered_map>
+#include <functional>
+#include <optional>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qbe {
+
+// A value known at compile time
+struct Constant {
+  enum Kind {
+    UNDEF,      // Field left out of an initializer
+    SCALAR,     // Int, Bool, Char, Unit
+    POINTER,    // Into a string literal or to a local, null if neither
+    AGGREGATE,  // Fields of a struct, or the payload of a variant
+  } kind = UNDEF;
+
+  int scalar = 0;
+
+  std::shared_ptr<std::string> bytes;
+  std::shared_ptr<Constant> cell;
+  int offset = 0;
+
+  int variant = 0;
+  std::vector<Constant> fields;
+
+  static Constant Scalar(int value) {
+    Constant result;
+    result.kind = SCALAR;
+    result.scalar = value;
+    return result;
+  }
+
+  static Constant Pointer(std::shared_ptr<std::string> bytes,
+                          std::shared_ptr<Constant> cell) {
+    Constant result;
+    result.kind = POINTER;
+    result.bytes = std::move(bytes);
+    result.cell = std::move(cell);
+    return result;
+  }
+
+  static Constant Aggregate() {
+    Constant result;
+    result.kind = AGGREGATE;
+    return result;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Runs the monomorphised AST of pure functions on arguments known
+//   at compile time:
+//
+//   parse_num(mk_str("42"))  ~>  42
+//
+// Nothing is assumed about the functions beforehand: the evaluation
+//   gives up on the first thing that is not a pure computation over
+//   constants (locals of the caller, globals, `new`, `print`, C
+//   functions, calls through pointers, failing asserts) or when it
+//   runs out of steps. Functions marked `@const` get more steps.
+
+class ConstEvaluator : public ReturnVisitor<Constant> {
+ public:
+  static constexpr size_t kSteps = size_t{1} << 16;
+  static constexpr size_t kConstSteps = size_t{1} << 22;
+  static constexpr size_t kMaxDepth = 512;
+
+  // Mangled name of the callee, none for calls through pointers
+  using CalleeName =
+      std::function<std::optional<std::string>(FnCallExpression*)>;
+
+  // Called before the body of a callee is run, the emitter
+  //   instantiates the bodies of cached functions there
+  using Enter = std::function<void(FunDeclStatement*)>;
+
+  ConstEvaluator(CalleeName callee_name, Enter enter = {})
+      : callee_name_{callee_name}, enter_{enter} {
+  }
+
+  void Add(std::string name, FunDeclStatement* function) {
+    functions_.insert({std::move(name), function});
+  }
+
+  std::optional<Constant> Run(FnCallExpression* call) {
+    auto callee = Callee(call);
+    if (!callee) {
+      return std::nullopt;
+    }
+
+    auto symbol = callee->layer_->RetrieveSymbol(callee->GetName());
+    auto attrs = symbol->as_fn_sym.attrs;
+
+    steps_ = attrs && attrs->FindAttr("const") ? kConstSteps : kSteps;
+    depth_ = 0;
+    frame_.clear();
+    pinned_.clear();
+
+    try {
+      return Eval(call);
+    } catch (NotConstant&) {
+      return std::nullopt;
+    }
+  }
+
+  // Statements
+
+  void VisitYield(YieldStatement*) override {
+    throw NotConstant{};
+  }
+
+  void VisitReturn(ReturnStatement* node) override {
+    throw Returned{Compute(node->return_value_)};
+  }
+
+  void VisitAssignment(AssignmentStatement* node) override {
+    auto value = Compute(node->value_);
+    Place(node->target_) = std::move(value);
+    return_value = Unit();
+  }
+
+  void VisitExprStatement(ExprStatement* node) override {
+    Compute(node->expr_);
+    return_value = Unit();
+  }
+
+  void VisitVarDecl(VarDeclStatement* node) override {
+    frame_.insert_or_assign(node->GetName(),
+                            std::make_shared<Constant>(Compute(node->value_)));
+    return_value = Unit();
+  }
+
+  // Expressions
+
+  void VisitComparison(ComparisonExpression* node) override {
+    auto l = Compute(node->left_);
+    auto r = Compute(node->right_);
+
+    if (l.kind == Constant::POINTER && r.kind == Constant::POINTER) {
+      return_value = Constant::Scalar(ComparePointers(node, l, r));
+      return;
+    }
+
+    auto v = FoldComparison(node->operator_.type, Scalar(l), Scalar(r));
+    return_value = Constant::Scalar(Known(v));
+  }
+
+  void VisitBinary(BinaryExpression* node) override {
+    auto l = Compute(node->left_);
+    auto r = Scalar(Compute(node->right_));
+
+    if (l.kind == Constant::POINTER) {
+      if (!l.bytes && !l.cell) {
+        throw NotConstant{};
+      }
+
+      switch (node->operator_.type) {
+        case lex::TokenType::PLUS:
+          l.offset += r;
+          break;
+        case lex::TokenType::MINUS:
+          l.offset -= r;
+          break;
+        default:
+          throw NotConstant{};
+      }
+
+      return_value = std::move(l);
+      return;
+    }
+
+    auto v = FoldBinary(node->operator_.type, Scalar(l), r);
+    return_value = Constant::Scalar(Known(v));
+  }
+
+  void VisitUnary(UnaryExpression* node) override {
+    auto operand = Scalar(Compute(node->operand_));
+    auto v = FoldUnary(node->operator_.type, operand);
+    return_value = Constant::Scalar(Known(v));
+  }
+
+  void VisitDeref(DereferenceExpression* node) override {
+    auto ptr = Compute(node->operand_);
+
+    if (ptr.kind == Constant::POINTER && ptr.bytes) {
+      auto size = static_cast<int>(ptr.bytes->size());
+
+      if (ptr.offset < 0 || ptr.offset >= size ||
+          measure_.MeasureSize(node->GetType()) != 1 ||
+          !FoldsAsInt(node->GetType())) {
+        throw NotConstant{};
+      }
+
+      // Zero-extended, like `loadub`
+      return_value = Constant::Scalar(
+          static_cast<unsigned char>((*ptr.bytes)[ptr.offset]));
+      return;
+    }
+
+    return_value = Pointee(ptr);
+  }
+
+  void VisitAddressof(AddressofExpression* node) override {
+    auto var = node->operand_->as<VarAccessExpression>();
+    if (!var) {
+      throw NotConstant{};
+    }
+
+    return_value = Constant::Pointer(nullptr, Cell(var));
+  }
+
+  void VisitIf(IfExpression* node) override {
+    auto condition = Scalar(Compute(node->condition_));
+    return_value =
+        Compute(condition ? node->true_branch_ : node->false_branch_);
+  }
+
+  // Every iteration takes a step, so the budget ends endless loops
+  void VisitFor(ForExpression* node) override {
+    while (Scalar(Compute(node->condition_))) {
+      Compute(node->body_);
+    }
+    return_value = Unit();
+  }
+
+  void VisitMatch(MatchExpression* node) override {
+    auto against = Compute(node->against_);
+
+    for (auto& [pat, expr] : node->patterns_) {
+      if (Matches(pat, against)) {
+        return_value = Compute(expr);
+        return;
+      }
+    }
+
+    throw NotConstant{};
+  }
+
+  void VisitNew(NewExpression*) override {
+    throw NotConstant{};
+  }
+
+  void VisitBlock(BlockExpression* node) override {
+    for (auto stmt : node->stmts_) {
+      Compute(stmt);
+    }
+
+    return_value = node->final_ ? Compute(node->final_) : Unit();
+  }
+
+  void VisitFnCall(FnCallExpression* node) override {
+    auto callee = Callee(node);
+    if (!callee || (depth_ += 1) > kMaxDepth) {
+      throw NotConstant{};
+    }
+
+    std::unordered_map<std::string_view, std::shared_ptr<Constant>> frame;
+
+    for (size_t i = 0; i < node->arguments_.size(); i++) {
+      frame.insert_or_assign(
+          callee->formals_[i].GetName(),
+          std::make_shared<Constant>(Compute(node->arguments_[i])));
+    }
+
+    if (enter_) {
+      enter_(callee);
+    }
+
+    std::swap(frame, frame_);
+
+    try {
+      return_value = Compute(callee->body_);
+    } catch (Returned& returned) {
+      return_value = std::move(returned.value);
+    }
+
+    std::swap(frame, frame_);
+    depth_ -= 1;
+  }
+
+  void VisitIntrinsic(IntrinsicCall* node) override {
+    switch (node->intrinsic) {
+      // A failing assert is left to abort at run time
+      case ast::elaboration::Intrinsic::ASSERT:
+        if (!Scalar(Compute(node->arguments_[0]))) {
+          throw NotConstant{};
+        }
+        return_value = Unit();
+        return;
+
+      case ast::elaboration::Intrinsic::IS_NULL: {
+        auto ptr = Compute(node->arguments_[0]);
+        if (ptr.kind != Constant::POINTER) {
+          throw NotConstant{};
+        }
+        return_value = Constant::Scalar(!ptr.bytes && !ptr.cell);
+        return;
+      }
+
+      default:
+        throw NotConstant{};
+    }
+  }
+
+  void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+    auto storage = Storage(node->GetType());
+    auto result = Constant::Aggregate();
+
+    if (storage->tag == types::TypeTag::TY_SUM) {
+      auto& mem = node->initializers_.at(0);
+      result.variant = Index(storage->as_sum.first, mem.field);
+      if (mem.init) {
+        result.fields.push_back(Compute(mem.init));
+      }
+      return_value = std::move(result);
+      return;
+    }
+
+    if (storage->tag != types::TypeTag::TY_STRUCT) {
+      throw NotConstant{};
+    }
+
+    result.fields.resize(storage->as_struct.first.size());
+
+    for (auto& mem : node->initializers_) {
+      auto index = Index(storage->as_struct.first, mem.field);
+      if (mem.init) {
+        result.fields[index] = Compute(mem.init);
+      }
+    }
+
+    return_value = std::move(result);
+  }
+
+  void VisitFieldAccess(FieldAccessExpression* node) override {
+    auto aggregate = Compute(node->struct_expression_);
+    return_value = Field(node, aggregate);
+  }
+
+  void VisitVarAccess(VarAccessExpression* node) override {
+    return_value = *Cell(node);
+  }
+
+  void VisitLiteral(LiteralExpression* node) override {
+    auto& token = node->token_;
+
+    if (!FoldsAsInt(node->GetType())) {
+      throw NotConstant{};
+    }
+
+    switch (token.type) {
+      case lex::TokenType::NUMBER:
+      case lex::TokenType::CHAR:
+        return_value = Constant::Scalar(static_cast<int>(LiteralValue(node)));
+        return;
+
+      case lex::TokenType::TRUE:
+      case lex::TokenType::FALSE:
+        return_value = Constant::Scalar(token.type == lex::TokenType::TRUE);
+        return;
+
+      case lex::TokenType::UNIT:
+        return_value = Unit();
+        return;
+
+      case lex::TokenType::STRING:
+        return_value = Constant::Pointer(
+            Unescape(std::get<std::string_view>(token.sem_info)), nullptr);
+        return;
+
+      default:
+        throw NotConstant{};
+    }
+  }
+
+  void VisitTypecast(TypecastExpression* node) override {
+    auto original = node->expr_->GetType();
+    auto target = types::FindLeader(node->type_);
+
+    if (!FoldsAsInt(target)) {
+      throw NotConstant{};
+    }
+
+    auto value = Compute(node->expr_);
+
+    if (original->tag == types::TypeTag::TY_UNIT &&
+        target->tag == types::TypeTag::TY_PTR) {
+      return_value = Constant::Pointer(nullptr, nullptr);
+      return;
+    }
+
+    if (value.kind == Constant::POINTER &&
+        target->tag == types::TypeTag::TY_BOOL) {
+      return_value = Constant::Scalar(value.bytes || value.cell);
+      return;
+    }
+
+    if (original->tag == types::TypeTag::TY_CHAR &&
+        target->tag == types::TypeTag::TY_INT) {
+      return_value = Constant::Scalar(Scalar(value) & 0xFF);
+      return;
+    }
+
+    if (measure_.MeasureSize(original) != measure_.MeasureSize(target)) {
+      throw NotConstant{};
+    }
+
+    return_value = std::move(value);
+  }
+
+  // Patterns are matched by `Matches`
+
+  void VisitBindingPat(BindingPattern*) override {
+    throw NotConstant{};
+  }
+
+  void VisitDiscardingPat(DiscardingPattern*) override {
+    throw NotConstant{};
+  }
+
+  void VisitLiteralPat(LiteralPattern*) override {
+    throw NotConstant{};
+  }
+
+  void VisitStructPat(StructPattern*) override {
+    throw NotConstant{};
+  }
+
+  void VisitVariantPat(VariantPattern*) override {
+    throw NotConstant{};
+  }
+
+ private:
+  struct NotConstant {};
+
+  struct Returned {
+    Constant value;
+  };
+
+  Constant Compute(TreeNode* node) {
+    if (steps_ == 0) {
+      throw NotConstant{};
+    }
+    steps_ -= 1;
+
+    return Eval(node);
+  }
+
+  FunDeclStatement* Callee(FnCallExpression* call) {
+    auto name = callee_name_(call);
+    if (!name) {
+      return nullptr;
+    }
+
+    // A generator allocates its frame, it is never pure
+    auto it = functions_.find(*name);
+    return it == functions_.end() || it->second->generator_ ? nullptr
+                                                            : it->second;
+  }
+
+  static Constant Unit() {
+    return Constant::Scalar(0);
+  }
+
+  static int Scalar(const Constant& value) {
+    if (value.kind != Constant::SCALAR) {
+      throw NotConstant{};
+    }
+    return value.scalar;
+  }
+
+  static int Known(std::optional<int> value) {
+    if (!value) {
+      throw NotConstant{};
+    }
+    return *value;
+  }
+
+  static types::Type* Storage(types::Type* t) {
+    return types::TypeStorage(types::FindLeader(t));
+  }
+
+  static size_t Index(std::vector<types::Member>& members,
+                      std::string_view field) {
+    for (size_t i = 0; i < members.size(); i++) {
+      if (members[i].field == field) {
+        return i;
+      }
+    }
+    throw NotConstant{};
+  }
+
+  // Only pointers into the same object are ordered
+  static int ComparePointers(ComparisonExpression* node, const Constant& l,
+                             const Constant& r) {
+    auto same = l.bytes == r.bytes && l.cell == r.cell;
+    auto op = node->operator_.type;
+
+    if (!same && op != lex::TokenType::EQUALS &&
+        op != lex::TokenType::NOT_EQ) {
+      throw NotConstant{};
+    }
+
+    if (!same) {
+      return op == lex::TokenType::NOT_EQ;
+    }
+
+    return Known(FoldComparison(op, l.offset, r.offset));
+  }
+
+  std::shared_ptr<Constant>& Cell(VarAccessExpression* var) {
+    auto it = frame_.find(var->GetName());
+    if (it == frame_.end()) {
+      throw NotConstant{};
+    }
+    return it->second;
+  }
+
+  static Constant& Pointee(const Constant& ptr) {
+    if (ptr.kind != Constant::POINTER || !ptr.cell || ptr.offset != 0) {
+      throw NotConstant{};
+    }
+    return *ptr.cell;
+  }
+
+  Constant& Field(FieldAccessExpression* node, Constant& aggregate) {
+    auto storage = Storage(node->struct_expression_->GetType());
+    auto field = node->field_name_.GetName();
+
+    if (aggregate.kind != Constant::AGGREGATE) {
+      throw NotConstant{};
+    }
+
+    if (storage->tag == types::TypeTag::TY_SUM) {
+      if (Index(storage->as_sum.first, field) !=
+              static_cast<size_t>(aggregate.variant) ||
+          aggregate.fields.empty()) {
+        throw NotConstant{};
+      }
+      return aggregate.fields[0];
+    }
+
+    return aggregate.fields.at(Index(storage->as_struct.first, field));
+  }
+
+  // Where an assignment writes to; string literals are left alone
+  Constant& Place(Expression* lvalue) {
+    if (auto var = lvalue->as<VarAccessExpression>()) {
+      return *Cell(var);
+    }
+
+    if (auto field = lvalue->as<FieldAccessExpression>()) {
+      auto& aggregate = Place(field->struct_expression_);
+      if (Storage(field->struct_expression_->GetType())->tag !=
+          types::TypeTag::TY_STRUCT) {
+        throw NotConstant{};
+      }
+      return Field(field, aggregate);
+    }
+
+    // The pointer may be the last one to hold the cell
+    if (auto deref = lvalue->as<DereferenceExpression>()) {
+      auto ptr = Compute(deref->operand_);
+      Pointee(ptr);
+      return *pinned_.emplace_back(ptr.cell);
+    }
+
+    throw NotConstant{};
+  }
+
+  bool Matches(Pattern* pat, Constant& value) {
+    if (pat->as<DiscardingPattern>()) {
+      return true;
+    }
+
+    if (auto binding = pat->as<BindingPattern>()) {
+      frame_.insert_or_assign(binding->name_.GetName(),
+                              std::make_shared<Constant>(value));
+      return true;
+    }
+
+    if (auto literal = pat->as<LiteralPattern>()) {
+      auto expected = Compute(literal->pat_);
+      return Scalar(expected) == Scalar(value);
+    }
+
+    if (auto variant = pat->as<VariantPattern>()) {
+      auto storage = Storage(variant->GetType());
+      if (storage->tag != types::TypeTag::TY_SUM ||
+          value.kind != Constant::AGGREGATE) {
+        throw NotConstant{};
+      }
+
+      auto index = Index(storage->as_sum.first, variant->name_.GetName());
+      if (index != static_cast<size_t>(value.variant)) {
+        return false;
+      }
+
+      if (!variant->inner_pat_) {
+        return true;
+      }
+
+      if (value.fields.empty()) {
+        throw NotConstant{};
+      }
+
+      return Matches(variant->inner_pat_, value.fields[0]);
+    }
+
+    throw NotConstant{};
+  }
+
+  // The bytes QBE puts in the data section for the literal
+  static std::shared_ptr<std::string> Unescape(std::string_view raw) {
+    auto bytes = std::make_shared<std::string>();
+
+    for (size_t i = 0; i < raw.size(); i++) {
+      if (raw[i] != '\\') {
+        bytes->push_back(raw[i]);
+        continue;
+      }
+
+      if ((i += 1) == raw.size()) {
+        throw NotConstant{};
+      }
+
+      switch (raw[i]) {
+        case 'n':
+          bytes->push_back('\n');
+          break;
+        case 't':
+          bytes->push_back('\t');
+          break;
+        case 'r':
+          bytes->push_back('\r');
+          break;
+        case '0':
+          bytes->push_back('\0');
+          break;
+        case '\\':
+        case '"':
+          bytes->push_back(raw[i]);
+          break;
+        default:
+          throw NotConstant{};
+      }
+    }
+
+    bytes->push_back('\0');
+    return bytes;
+  }
+
+ private:
+  CalleeName callee_name_;
+  Enter enter_;
+  std::unordered_map<std::string, FunDeclStatement*> functions_;
+
+  std::unordered_map<std::string_view, std::shared_ptr<Constant>> frame_;
+  std::vector<std::shared_ptr<Constant>> pinned_;
+
+  size_t steps_ = 0;
+  size_t depth_ = 0;
+
+  detail::SizeMeasure measure_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Lays the constant out in memory the way the emitted code would,
+//   false if it holds pointers or uninitialized fields
+inline bool WriteConstant(detail::SizeMeasure& measure, types::Type* type,
+                          const Constant& value, std::string& image,
+                          size_t offset) {
+  auto t = types::TypeStorage(types::FindLeader(type));
+
+  if (measure.IsZST(t)) {
+    return true;
+  }
+
+  auto write = [&](uint32_t scalar, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+      image[offset + i] = static_cast<char>(scalar >> (8 * i));
+    }
+  };
+
+  switch (t->tag) {
+    case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_BOOL:
+    case types::TypeTag::TY_CHAR:
+      if (value.kind != Constant::SCALAR) {
+        return false;
+      }
+      write(value.scalar, measure.MeasureSize(t));
+      return true;
+
+    case types::TypeTag::TY_STRUCT: {
+      if (value.kind != Constant::AGGREGATE) {
+        return false;
+      }
+
+      auto& members = t->as_struct.first;
+
+      for (size_t i = 0; i < members.size(); i++) {
+        auto field_offset =
+            offset + measure.MeasureFieldOffset(t, members[i].field);
+        if (!WriteConstant(measure, members[i].ty, value.fields[i], image,
+                           field_offset)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case types::TypeTag::TY_SUM: {
+      if (value.kind != Constant::AGGREGATE) {
+        return false;
+      }
+
+      auto layout = measure.LayoutSum(t);
+
+      switch (layout.kind) {
+        case detail::SumLayout::SINGLE:
+          break;
+
+        case detail::SumLayout::TAGGED:
+          write(value.variant, layout.tag_size);
+          break;
+
+        case detail::SumLayout::NICHE:
+          if (value.variant == layout.niche_variant) {
+            write(2, 1);
+          }
+          break;
+      }
+
+      auto payload = t->as_sum.first[value.variant].ty;
+
+      if (!payload || value.fields.empty()) {
+        return true;
+      }
+
+      return WriteConstant(measure, payload, value.fields[0], image,
+                           offset + layout.payload_offset);
+    }
+
+    default:
+      return false;
+  }
+}
+
+}  // namespace qbe
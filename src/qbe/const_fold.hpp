@@ -0,0 +1,471 @@
+#pragma once
+
+#include <qbe/escape_analysis.hpp>
+#include <qbe/qbe_types.hpp>
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <ast/expressions.hpp>
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
+#include <unordered_map>
+#include <functional>
+#include <unordered_set>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+namespace qbe {
+
+// Int is 32 bits and wraps around, like `w` arithmetic in QBE
+
+inline std::optional<int> FoldBinary(lex::TokenType op, int l, int r) {
+  auto wrap = [](int64_t v) {
+    return static_cast<int>(static_cast<uint32_t>(v));
+  };
+
+  switch (op) {
+    case lex::TokenType::PLUS:
+      return wrap(int64_t{l} + r);
+    case lex::TokenType::MINUS:
+      return wrap(int64_t{l} - r);
+    case lex::TokenType::STAR:
+      return wrap(int64_t{l} * r);
+    case lex::TokenType::DIV:
+      // Left to trap at run time, as QBE `div` does
+      if (r == 0 || (l == INT32_MIN && r == -1)) {
+        return std::nullopt;
+      }
+      return l / r;
+    default:
+      return std::nullopt;
+  }
+}
+
+inline std::optional<int> FoldComparison(lex::TokenType op, int l, int r) {
+  switch (op) {
+    case lex::TokenType::EQUALS:
+      return l == r;
+    case lex::TokenType::NOT_EQ:
+      return l != r;
+    case lex::TokenType::LT:
+      return l < r;
+    case lex::TokenType::LE:
+      return l <= r;
+    case lex::TokenType::GT:
+      return l > r;
+    case lex::TokenType::GE:
+      return l >= r;
+    default:
+      return std::nullopt;
+  }
+}
+
+inline std::optional<int> FoldUnary(lex::TokenType op, int v) {
+  switch (op) {
+    case lex::TokenType::MINUS:
+      return static_cast<int>(0u - static_cast<uint32_t>(v));
+    case lex::TokenType::NOT:
+      return v == 0;
+    default:
+      return std::nullopt;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Int, Bool or Char literal, null for the other types
+inline LiteralExpression* MakeLiteral(int value, types::Type* type,
+                                      lex::Location location) {
+  // The bits of the Int
+  auto token = lex::Token{lex::TokenType::NUMBER, location,
+                          uint64_t{static_cast<uint32_t>(value)}};
+
+  switch (type->tag) {
+    case types::TypeTag::TY_BOOL:
+      token = lex::Token{value ? lex::TokenType::TRUE : lex::TokenType::FALSE,
+                         location};
+      break;
+
+    case types::TypeTag::TY_CHAR:
+      token = lex::Token{lex::TokenType::CHAR, location,
+                         uint64_t{static_cast<unsigned char>(value)}};
+      break;
+
+    case types::TypeTag::TY_INT:
+      break;
+
+    default:
+      return nullptr;
+  }
+
+  auto literal = new LiteralExpression{token};
+  literal->type_ = type;
+  return literal;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Folds Int, Bool and Char expressions of literals on the
+//   monomorphised AST, and replaces the locals initialized with
+//   a literal (declared once, never assigned, address never taken)
+//   with that literal. Then drops the branches of `if` and the arms
+//   of `match` that can not be taken:
+//
+//   var debug = false;  ...  if debug { ... } else { e }  ~>  e
+//
+// Arms after a catch-all or repeating a literal are dropped too.
+//   Calls are given to `evaluate` once their arguments are folded,
+//   which may return what to replace them with (see const_eval.hpp).
+
+class ConstantFolding : public JustWalk {
+ public:
+  using Evaluate = std::function<Expression*(FnCallExpression*)>;
+
+  ConstantFolding(Evaluate evaluate = nullptr) : evaluate_{evaluate} {
+  }
+
+  void Run(FunDeclStatement* function) {
+    constants_.clear();
+    in_scope_.clear();
+    candidates_ = Candidates(function).Result();
+
+    Fold(function->body_);
+  }
+
+  // Statements
+
+  void VisitYield(YieldStatement* node) override {
+    Fold(node->yield_value_);
+  }
+
+  void VisitReturn(ReturnStatement* node) override {
+    Fold(node->return_value_);
+  }
+
+  void VisitAssignment(AssignmentStatement* node) override {
+    Walk(node->target_);
+    Fold(node->value_);
+  }
+
+  void VisitExprStatement(ExprStatement* node) override {
+    Fold(node->expr_);
+  }
+
+  void VisitVarDecl(VarDeclStatement* node) override {
+    Fold(node->value_);
+
+    // Shadows whatever had the name before, up to the end of the block
+    in_scope_[node->GetName()] = node;
+
+    auto literal = node->value_->as<LiteralExpression>();
+
+    if (literal && Value(literal) && candidates_.contains(node)) {
+      constants_.insert({node, literal});
+    }
+  }
+
+  // Expressions
+
+  void VisitComparison(ComparisonExpression* node) override {
+    Fold(node->left_);
+    Fold(node->right_);
+
+    auto l = Value(node->left_);
+    auto r = Value(node->right_);
+
+    if (l && r) {
+      if (auto v = FoldComparison(node->operator_.type, *l, *r)) {
+        Replace(node, *v, node->GetType());
+      }
+    }
+  }
+
+  void VisitBinary(BinaryExpression* node) override {
+    Fold(node->left_);
+    Fold(node->right_);
+
+    auto l = Value(node->left_);
+    auto r = Value(node->right_);
+
+    if (l && r && node->GetType()->tag == types::TypeTag::TY_INT) {
+      if (auto v = FoldBinary(node->operator_.type, *l, *r)) {
+        Replace(node, *v, node->GetType());
+      }
+    }
+  }
+
+  void VisitUnary(UnaryExpression* node) override {
+    Fold(node->operand_);
+
+    if (auto operand = Value(node->operand_)) {
+      if (auto v = FoldUnary(node->operator_.type, *operand)) {
+        Replace(node, *v, node->GetType());
+      }
+    }
+  }
+
+  void VisitDeref(DereferenceExpression* node) override {
+    Fold(node->operand_);
+  }
+
+  void VisitAddressof(AddressofExpression* node) override {
+    Walk(node->operand_);
+  }
+
+  void VisitIf(IfExpression* node) override {
+    Fold(node->condition_);
+    Fold(node->true_branch_);
+    Fold(node->false_branch_);
+
+    if (auto condition = Value(node->condition_)) {
+      Pick(node, *condition ? node->true_branch_ : node->false_branch_);
+    }
+  }
+
+  void VisitFor(ForExpression* node) override {
+    Fold(node->condition_);
+    Fold(node->body_);
+
+    if (auto condition = Value(node->condition_); condition && !*condition) {
+      replacement_ = new BlockExpression{node->for_token_, {}, nullptr};
+    }
+  }
+
+  void VisitMatch(MatchExpression* node) override {
+    Fold(node->against_);
+
+    for (auto& [_, expr] : node->patterns_) {
+      Fold(expr);
+    }
+
+    DropUnreachableArms(node);
+
+    auto against = Value(node->against_);
+    if (!against) {
+      return;
+    }
+
+    for (auto& [pat, expr] : node->patterns_) {
+      if (pat->as<DiscardingPattern>()) {
+        Pick(node, expr);
+        return;
+      }
+
+      auto literal = pat->as<LiteralPattern>();
+      auto value = literal ? Value(literal->pat_) : std::nullopt;
+
+      // Bindings and strings are left to the match compiler
+      if (!value) {
+        return;
+      }
+
+      if (*value == *against) {
+        Pick(node, expr);
+        return;
+      }
+    }
+  }
+
+  void VisitNew(NewExpression* node) override {
+    if (node->allocation_size_) {
+      Fold(node->allocation_size_);
+    }
+    if (node->initial_value_) {
+      Fold(node->initial_value_);
+    }
+  }
+
+  void VisitBlock(BlockExpression* node) override {
+    auto saved = in_scope_;
+
+    for (auto stmt : node->stmts_) {
+      stmt->Accept(this);
+    }
+    if (node->final_) {
+      Fold(node->final_);
+    }
+
+    in_scope_ = std::move(saved);
+
+    // `{ 1 }`, as left by a folded `if`
+    if (node->stmts_.empty() && node->final_) {
+      replacement_ = node->final_;
+    }
+  }
+
+  void VisitFnCall(FnCallExpression* node) override {
+    for (auto& arg : node->arguments_) {
+      Fold(arg);
+    }
+
+    if (evaluate_) {
+      replacement_ = evaluate_(node);
+    }
+  }
+
+  void VisitIntrinsic(IntrinsicCall* node) override {
+    for (auto& arg : node->arguments_) {
+      Fold(arg);
+    }
+  }
+
+  void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+    for (auto& mem : node->initializers_) {
+      if (mem.init) {
+        Fold(mem.init);
+      }
+    }
+  }
+
+  void VisitFieldAccess(FieldAccessExpression* node) override {
+    Fold(node->struct_expression_);
+  }
+
+  void VisitVarAccess(VarAccessExpression* node) override {
+    auto decl = in_scope_.find(node->GetName());
+    if (decl == in_scope_.end()) {
+      return;
+    }
+
+    if (auto it = constants_.find(decl->second); it != constants_.end()) {
+      replacement_ = new LiteralExpression{*it->second};
+    }
+  }
+
+  void VisitTypecast(TypecastExpression* node) override {
+    Fold(node->expr_);
+  }
+
+ private:
+  // Locals that are declared once and only read
+  class Candidates : public EscapeAnalysis {
+   public:
+    Candidates(FunDeclStatement* function) {
+      for (auto& formal : function->formals_) {
+        declared_[formal.GetName()] += 2;
+      }
+      address_taken_ = Run(function->body_);
+    }
+
+    std::unordered_set<VarDeclStatement*> Result() {
+      std::unordered_set<VarDeclStatement*> result;
+
+      for (auto decl : decls_) {
+        auto name = decl->GetName();
+        if (declared_[name] == 1 && !address_taken_.contains(name)) {
+          result.insert(decl);
+        }
+      }
+
+      return result;
+    }
+
+    void VisitVarDecl(VarDeclStatement* node) override {
+      declared_[node->GetName()] += 1;
+      decls_.push_back(node);
+      EscapeAnalysis::VisitVarDecl(node);
+    }
+
+    void VisitBindingPat(BindingPattern* node) override {
+      declared_[node->name_.GetName()] += 2;
+    }
+
+    void VisitAssignment(AssignmentStatement* node) override {
+      if (auto var = node->target_->as<VarAccessExpression>()) {
+        declared_[var->GetName()] += 2;
+      }
+      EscapeAnalysis::VisitAssignment(node);
+    }
+
+   private:
+    std::unordered_map<std::string_view, int> declared_;
+    std::vector<VarDeclStatement*> decls_;
+    std::unordered_set<std::string_view> address_taken_;
+  };
+
+  template <typename T>
+  void Fold(T*& expr) {
+    replacement_ = nullptr;
+    expr->Accept(this);
+
+    if (replacement_) {
+      expr = replacement_;
+      replacement_ = nullptr;
+    }
+  }
+
+  // Lvalues are never replaced, only what is inside of them
+  void Walk(Expression* lvalue) {
+    lvalue->Accept(this);
+    replacement_ = nullptr;
+  }
+
+  // Int, Char and Bool literals
+  static std::optional<int> Value(Expression* expr) {
+    auto literal = expr->as<LiteralExpression>();
+    if (!literal || !FoldsAsInt(literal->GetType())) {
+      return std::nullopt;
+    }
+
+    switch (literal->token_.type) {
+      case lex::TokenType::NUMBER:
+      case lex::TokenType::CHAR:
+        return static_cast<int>(LiteralValue(literal));
+      case lex::TokenType::TRUE:
+        return 1;
+      case lex::TokenType::FALSE:
+        return 0;
+      default:
+        return std::nullopt;
+    }
+  }
+
+  void Replace(Expression* node, int value, types::Type* type) {
+    replacement_ = MakeLiteral(value, type, node->GetLocation());
+  }
+
+  // Only when the branch is typed like the whole expression, not
+  //   when it is a `return` inside of an Int `if`
+  void Pick(Expression* node, Expression* branch) {
+    if (branch->GetType()->tag == node->GetType()->tag) {
+      replacement_ = branch;
+    }
+  }
+
+  static void DropUnreachableArms(MatchExpression* node) {
+    std::unordered_set<int> seen;
+    auto& arms = node->patterns_;
+
+    for (size_t i = 0; i < arms.size(); i++) {
+      auto pat = arms[i].first;
+
+      if (pat->as<DiscardingPattern>() || pat->as<BindingPattern>()) {
+        arms.resize(i + 1);
+        return;
+      }
+
+      auto literal = pat->as<LiteralPattern>();
+      auto value = literal ? Value(literal->pat_) : std::nullopt;
+
+      if (value && !seen.insert(*value).second) {
+        arms.erase(arms.begin() + i);
+        i -= 1;
+      }
+    }
+  }
+
+ private:
+  std::unordered_set<VarDeclStatement*> candidates_;
+  std::unordered_map<VarDeclStatement*, LiteralExpression*> constants_;
+
+  // What a name refers to at this point of the walk
+  std::unordered_map<std::string_view, VarDeclStatement*> in_scope_;
+
+  Evaluate evaluate_;
+
+  Expression* replacement_ = nullptr;
+};
+
+}  // namespace qbe
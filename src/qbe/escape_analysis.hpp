@@ -0,0 +1,245 @@
+#pragma once
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <ast/expressions.hpp>
+#include <ast/declarations.hpp>
+
+#include <functional>
+#include <unordered_set>
+#include <unordered_map>
+#include <string_view>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace qbe {
+
+// Finds the locals of a function whose address is taken,
+//   `&x` or `&x.field.field`. The rest of the scalar locals
+//   can live in temporaries instead of stack slots.
+//
+// Locals are told apart by their names only (like in
+//   `named_values_`), so shadowing is handled conservatively.
+
+class EscapeAnalysis : public JustWalk {
+ public:
+  std::unordered_set<std::string_view> Run(Expression* body) {
+    body->Accept(this);
+    return std::move(escaping_);
+  }
+
+  virtual void VisitAddressof(AddressofExpression* node) override {
+    Expression* root = node->operand_;
+
+    while (auto field = root->as<FieldAccessExpression>()) {
+      root = field->struct_expression_;
+    }
+
+    if (auto var = root->as<VarAccessExpression>()) {
+      escaping_.insert(var->GetName());
+    }
+
+    JustWalk::VisitAddressof(node);
+  }
+
+ private:
+  std::unordered_set<std::string_view> escaping_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Finds the `var p = new T` allocations that never outlive the
+//   function, so they can be placed on its stack.
+//
+// A pointer held in a local or a parameter stays in the frame
+//   if it is only dereferenced, compared, printed, or passed to
+//   a parameter that itself stays in the frame of the callee.
+//   Any other use (returning, storing, taking `&p`, arithmetic,
+//   calls through pointers or to C) lets it escape.
+//
+// Parameter summaries are solved for all functions at once,
+//   starting from "nothing escapes" until nothing changes.
+
+class AllocationEscape {
+ public:
+  // Mangled name of the callee, none for calls through pointers
+  using CalleeName =
+      std::function<std::optional<std::string>(FnCallExpression*)>;
+
+  AllocationEscape(CalleeName callee_name) : callee_name_{callee_name} {
+  }
+
+  void Add(std::string name, FunDeclStatement* function) {
+    Function summary{.decl = function};
+
+    // A generator keeps its arguments in the frame after the call
+    if (function->generator_) {
+      summary.params.assign(summary.params.size(), true);
+    }
+
+    functions_.insert({std::move(name), std::move(summary)});
+  }
+
+  // A function whose body is not there, solved by an earlier build
+  void Add(std::string name, FunDeclStatement* function,
+           std::vector<bool> params) {
+    functions_.insert({std::move(name),
+                       Function{.decl = function, .params = std::move(params),
+                                .solved = true}});
+  }
+
+  void Solve() {
+    for (auto changed = true; changed;) {
+      changed = false;
+
+      for (auto& [_, function] : functions_) {
+        if (function.solved) {
+          continue;
+        }
+
+        auto escaping = Uses(*this, function.decl).escaping;
+
+        for (size_t i = 0; i < function.params.size(); i++) {
+          auto name = function.decl->formals_[i].GetName();
+
+          if (!function.params[i] && escaping.contains(name)) {
+            function.params[i] = true;
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+
+  // `new` expressions of the function that can go to the stack
+  std::unordered_set<NewExpression*> StackAllocations(
+      FunDeclStatement* function) {
+    auto uses = Uses(*this, function);
+
+    std::unordered_set<NewExpression*> result;
+
+    for (auto& [name, allocation] : uses.candidates) {
+      if (!uses.escaping.contains(name)) {
+        result.insert(allocation);
+      }
+    }
+
+    return result;
+  }
+
+  // Whether an allocation passed to each parameter escapes
+  const std::vector<bool>& Params(const std::string& name) {
+    return functions_.at(name).params;
+  }
+
+ private:
+  struct Function {
+    FunDeclStatement* decl;
+    std::vector<bool> params = std::vector<bool>(decl->formals_.size());
+    bool solved = false;
+  };
+
+  bool ParamEscapes(FnCallExpression* call, size_t i) {
+    auto name = callee_name_(call);
+    if (!name) {
+      return true;
+    }
+
+    auto it = functions_.find(*name);
+    return it == functions_.end() || it->second.params[i];
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  class Uses : public JustWalk {
+   public:
+    Uses(AllocationEscape& summaries, FunDeclStatement* function)
+        : summaries_{summaries} {
+      function->body_->Accept(this);
+    }
+
+    virtual void VisitVarDecl(VarDeclStatement* node) override {
+      auto allocation = node->value_->as<NewExpression>();
+
+      if (allocation && !allocation->allocation_size_) {
+        candidates.emplace_back(node->GetName(), allocation);
+      }
+
+      JustWalk::VisitVarDecl(node);
+    }
+
+    virtual void VisitAssignment(AssignmentStatement* node) override {
+      // Overwriting the pointer itself does not leak it
+      if (!node->target_->as<VarAccessExpression>()) {
+        node->target_->Accept(this);
+      }
+
+      node->value_->Accept(this);
+    }
+
+    virtual void VisitDeref(DereferenceExpression* node) override {
+      Safe(node->operand_);
+    }
+
+    // `&(*p).field` points inside the allocation
+    virtual void VisitAddressof(AddressofExpression* node) override {
+      Expression* root = node->operand_;
+
+      while (auto field = root->as<FieldAccessExpression>()) {
+        root = field->struct_expression_;
+      }
+
+      if (auto deref = root->as<DereferenceExpression>()) {
+        deref->operand_->Accept(this);
+      }
+
+      JustWalk::VisitAddressof(node);
+    }
+
+    virtual void VisitComparison(ComparisonExpression* node) override {
+      Safe(node->left_);
+      Safe(node->right_);
+    }
+
+    virtual void VisitIntrinsic(IntrinsicCall* node) override {
+      for (auto arg : node->arguments_) {
+        Safe(arg);
+      }
+    }
+
+    virtual void VisitFnCall(FnCallExpression* node) override {
+      for (size_t i = 0; i < node->arguments_.size(); i++) {
+        auto arg = node->arguments_[i];
+        auto var = arg->as<VarAccessExpression>();
+
+        if (!var || summaries_.ParamEscapes(node, i)) {
+          arg->Accept(this);
+        }
+      }
+    }
+
+    virtual void VisitVarAccess(VarAccessExpression* node) override {
+      escaping.insert(node->GetName());
+    }
+
+    std::vector<std::pair<std::string_view, NewExpression*>> candidates;
+    std::unordered_set<std::string_view> escaping;
+
+   private:
+    void Safe(Expression* expr) {
+      if (!expr->as<VarAccessExpression>()) {
+        expr->Accept(this);
+      }
+    }
+
+   private:
+    AllocationEscape& summaries_;
+  };
+
+ private:
+  CalleeName callee_name_;
+  std::unordered_map<std::string, Function> functions_;
+};
+
+}  // namespace qbe
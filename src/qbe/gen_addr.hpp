@@ -27,13 +27,19 @@ class GenAddr : public AbortVisitor {
   }
 
   virtual void VisitDeref(DereferenceExpression* node) override {
-    fmt::print("  {} =l copy {}\n", target_id_.Emit(),
-               parent_.Eval(node->operand_).Emit());
+    parent_.Print("  {} =l copy {}\n", target_id_.Emit(),
+                  parent_.Eval(node->operand_).Emit());
   }
 
   virtual void VisitFnCall(FnCallExpression* node) override {
-    fmt::print("  {} =l copy {}\n", target_id_.Emit(),
-               parent_.Eval(node).Emit());
+    parent_.Print("  {} =l copy {}\n", target_id_.Emit(),
+                  parent_.Eval(node).Emit());
+  }
+
+  // Inlined calls, as in `{ var x.1 = ...; ... }.field`
+  virtual void VisitBlock(BlockExpression* node) override {
+    parent_.Print("  {} =l copy {}\n", target_id_.Emit(),
+                  parent_.Eval(node).Emit());
   }
 
   virtual void VisitFieldAccess(FieldAccessExpression* node) override {
@@ -42,14 +48,24 @@ class GenAddr : public AbortVisitor {
     auto offset = parent_.measure_.MeasureFieldOffset(
         node->struct_expression_->GetType(), node->field_name_);
 
-    fmt::print("  {} =l add {}, {}\n",  //
-               target_id_.Emit(), target_id_.Emit(), offset);
+    parent_.Print("  {} =l add {}, {}\n",  //
+                  target_id_.Emit(), target_id_.Emit(), offset);
   }
 
   virtual void VisitVarAccess(VarAccessExpression* node) override {
-    fmt::print("  {} =l copy {}\n",  //
-               target_id_.Emit(),
-               parent_.named_values_.at(node->GetName()).Emit());
+    auto it = parent_.named_values_.find(node->GetName());
+
+    // Globals, such as the constants computed at compile time
+    if (it == parent_.named_values_.end()) {
+      parent_.Print("  {} =l copy ${}\n", target_id_.Emit(), node->GetName());
+      return;
+    }
+
+    FMT_ASSERT(it->second.tag != Value::VARIABLE,
+               "Taking the address of a promoted local");
+
+    parent_.Print("  {} =l copy {}\n",  //
+                  target_id_.Emit(), it->second.Emit());
   }
 
  private:
@@ -17,8 +17,8 @@ namespace qbe {
 class GenAt : public AbortVisitor {
  public:
   // Target id is a pointer
-  GenAt(IrEmitter& parent, Value target_id)
-      : parent_{parent}, target_id_{target_id} {
+  GenAt(IrEmitter& parent, Value target_id, bool fresh = false)
+      : parent_{parent}, target_id_{target_id}, fresh_{fresh} {
   }
 
   std::string Give() {
@@ -31,8 +31,8 @@ class GenAt : public AbortVisitor {
     }
 
     auto addr = parent_.Eval(node->operand_);
-    auto [s, a] = parent_.SizeAlign(node);
-    parent_.Copy(a, s, addr, target_id_);
+    auto size = parent_.GetTypeSize(node->GetType());
+    parent_.Copy(size, addr, target_id_);
   }
 
   virtual void VisitFieldAccess(FieldAccessExpression* node) override {
@@ -47,19 +47,26 @@ class GenAt : public AbortVisitor {
     auto offset = parent_.measure_.MeasureFieldOffset(
         node->struct_expression_->GetType(), node->field_name_);
 
-    fmt::print("  {} =l add {}, {}\n", addr.Emit(), addr.Emit(), offset);
+    parent_.Print("  {} =l add {}, {}\n", addr.Emit(), addr.Emit(), offset);
 
-    auto [s, a] = parent_.SizeAlign(node);
+    auto size = parent_.GetTypeSize(node->GetType());
 
-    parent_.Copy(a, s, addr, target_id_);
+    parent_.Copy(size, addr, target_id_);
   }
 
   virtual void VisitFnCall(FnCallExpression* node) override {
+    // The callee may read the target through some pointer while
+    //   constructing its result, unless the target is fresh
+    if (fresh_ && parent_.ReturnsInSlot(node)) {
+      parent_.GenCall(node, target_id_);
+      return;
+    }
+
     auto call = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, call, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, call, target_id_);
       return;
     }
 
@@ -67,12 +74,22 @@ class GenAt : public AbortVisitor {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), call.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), call.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
-    size_t previous_offset = 0;
+    // The initializers may read the target (`p = { .x = p.y, ... }`),
+    //   unless it is fresh the value is built aside
+    if (!fresh_) {
+      auto value = parent_.Eval(node);
+      parent_.Copy(parent_.GetTypeSize(node->GetType()), value, target_id_);
+      return;
+    }
+
+    if (node->array_) {
+      return GenArray(node);
+    }
 
     auto& measure = parent_.measure_;
     auto& field = node->initializers_[0].field;  // The only one!
@@ -80,49 +97,45 @@ class GenAt : public AbortVisitor {
 
     if (underlying->tag == types::TypeTag::TY_SUM) {
       auto discr = measure.SumDiscriminant(underlying, field);
-      fmt::print("  storew {}, {}\n", discr, target_id_.Emit());
+      parent_.StoreDiscriminant(underlying, discr, target_id_);
     }
 
-    auto target = parent_.GenTemporary();
-    fmt::print("  {} = l copy {}\n", target.Emit(), target_id_.Emit());
-
+    // Fields are not necessarily laid out in the order of initializers
     for (auto& i : node->initializers_) {
       auto offset = measure.MeasureFieldOffset(node->GetType(), i.field);
 
-      // Move the pointer
-      fmt::print("  {} =l add {}, {}\n", target.Emit(), target.Emit(),
-                 offset - previous_offset);
-
-      previous_offset = offset;
+      auto target = parent_.GenTemporary();
+      parent_.Print("  {} =l add {}, {}\n", target.Emit(), target_id_.Emit(),
+                    offset);
 
       if (i.init) {
-        parent_.GenAtAddress(i.init, target);
+        parent_.GenAtAddress(i.init, target, fresh_);
       }
     }
   }
 
   virtual void VisitNew(NewExpression* node) override {
     auto mem = parent_.Eval(node);
-    fmt::print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
+    parent_.Print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
   }
 
   virtual void VisitAddressof(AddressofExpression* node) override {
     auto mem = parent_.Eval(node);
-    fmt::print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
+    parent_.Print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
   }
 
   virtual void VisitUnary(UnaryExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitIf(IfExpression* node) override {
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, id, target_id_);
       return;
     }
 
@@ -130,45 +143,66 @@ class GenAt : public AbortVisitor {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
+  }
+
+  // Unit, nothing to store
+  virtual void VisitFor(ForExpression* node) override {
+    parent_.Eval(node);
   }
 
   virtual void VisitTypecast(TypecastExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+
+    if (parent_.measure_.IsCompound(node->GetType())) {
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, id, target_id_);
+      return;
+    }
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitBinary(BinaryExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitComparison(ComparisonExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitBlock(BlockExpression* node) override {
+    // Construct the final value in place
+    if (parent_.measure_.IsCompound(node->GetType()) && node->final_) {
+      for (auto& statement : node->stmts_) {
+        statement->Accept(&parent_);
+      }
+
+      parent_.GenAtAddress(node->final_, target_id_, fresh_);
+      return;
+    }
+
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitVarAccess(VarAccessExpression* node) override {
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, id, target_id_);
       return;
     }
 
@@ -176,16 +210,16 @@ class GenAt : public AbortVisitor {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitMatch(MatchExpression* node) override {
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, id, target_id_);
       return;
     }
 
@@ -193,8 +227,8 @@ class GenAt : public AbortVisitor {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
   virtual void VisitLiteral(LiteralExpression* node) override {
@@ -203,13 +237,50 @@ class GenAt : public AbortVisitor {
     }
 
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
+                  target_id_.Emit());
   }
 
  private:
+  // Element i at i * size; `[v; N]` computes `v` into the first one
+  //   and copies it over the rest in a loop
+  void GenArray(CompoundInitializerExpr* node) {
+    auto array = types::TypeStorage(node->GetType());
+    auto size = parent_.GetTypeSize(array->as_array.element);
+
+    for (size_t i = 0; i < node->initializers_.size(); i++) {
+      auto target = parent_.GenTemporary();
+      parent_.Print("  {} =l add {}, {}\n", target.Emit(), target_id_.Emit(),
+                    i * size);
+      parent_.GenAtAddress(node->initializers_[i].init, target, fresh_);
+    }
+
+    if (node->repeat_.value_or(0) < 2 || size == 0) {
+      return;
+    }
+
+    auto fill_id = parent_.id_ += 1;
+    auto end = parent_.GenTemporary();
+    auto dst = parent_.GenTemporary();
+    auto more = parent_.GenTemporary();
+
+    parent_.Print("  {} =l add {}, {}\n", end.Emit(), target_id_.Emit(),
+                  *node->repeat_ * size);
+    parent_.Print("  {} =l add {}, {}\n", dst.Emit(), target_id_.Emit(), size);
+
+    parent_.Print("@fill.{}          \n", fill_id);
+    parent_.Copy(size, target_id_, dst);
+    parent_.Print("  {} =l add {}, {}\n", dst.Emit(), dst.Emit(), size);
+    parent_.Print("  {} =w cultl {}, {}\n", more.Emit(), dst.Emit(),
+                  end.Emit());
+    parent_.Print("  jnz {}, @fill.{}, @filled.{}\n", more.Emit(), fill_id,
+                  fill_id);
+    parent_.Print("@filled.{}        \n", fill_id);
+  }
+
   IrEmitter& parent_;
   Value target_id_;
+  bool fresh_ = false;
   std::string result_;
 };
 
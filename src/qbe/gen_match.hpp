@@ -49,18 +49,18 @@ class GenMatch : public AbortVisitor {
 
     if (!literal_) {
       auto load = parent_.GenTemporary();
-      fmt::print("  {} = {} load{} {}  \n",  //
-                 load.Emit(), eq_type, load_suf, target_id_.Emit());
+      parent_.Print("  {} = {} load{} {}  \n",  //
+                    load.Emit(), eq_type, load_suf, target_id_.Emit());
       target = load;
     }
 
     auto condition = parent_.GenTemporary();
 
-    fmt::print("  {} =w ceq{} {}, {}\n",  //
-               condition.Emit(), eq_type, target.Emit(), against.Emit());
-    fmt::print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
-               condition.Emit(), next_arm_ - 1, check++, next_arm_);
-    fmt::print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
+    parent_.Print("  {} =w ceq{} {}, {}\n",  //
+                  condition.Emit(), eq_type, target.Emit(), against.Emit());
+    parent_.Print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
+                  condition.Emit(), next_arm_ - 1, check++, next_arm_);
+    parent_.Print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
   }
 
   // In the form `.some.next n`  <<---  parsed as VariantPattern
@@ -71,8 +71,8 @@ class GenMatch : public AbortVisitor {
 
       auto new_addr = parent_.GenTemporary();
 
-      fmt::print("  {} = l add {}, {}  \n",  //
-                 new_addr.Emit(), target_id_.Emit(), offset);
+      parent_.Print("  {} = l add {}, {}  \n",  //
+                    new_addr.Emit(), target_id_.Emit(), offset);
 
       target_id_ = new_addr;
 
@@ -91,23 +91,23 @@ class GenMatch : public AbortVisitor {
     auto discr_pat =
         parent_.GenConstInt(parent_.measure_.SumDiscriminant(ty, node->name_));
 
-    auto memory = parent_.GenTemporary();
-    fmt::print("  {} =w loadsw {}  \n", memory.Emit(), target_id_.Emit());
+    auto memory = parent_.LoadDiscriminant(ty, target_id_);
 
     auto condition = parent_.GenTemporary();
-    fmt::print("  {} =w ceqw {}, {}\n",  //
-               condition.Emit(), discr_pat.Emit(), memory.Emit());
+    parent_.Print("  {} =w ceqw {}, {}\n",  //
+                  condition.Emit(), discr_pat.Emit(), memory.Emit());
 
-    fmt::print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
-               condition.Emit(), next_arm_ - 1, check++, next_arm_);
+    parent_.Print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
+                  condition.Emit(), next_arm_ - 1, check++, next_arm_);
 
-    fmt::print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
+    parent_.Print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
 
     if (auto& inner = node->inner_pat_) {
       auto new_addr = parent_.GenTemporary();
 
-      fmt::print("  {} = l add {}, {}  \n",  //
-                 new_addr.Emit(), target_id_.Emit(), 4);
+      parent_.Print("  {} = l add {}, {}  \n",  //
+                    new_addr.Emit(), target_id_.Emit(),
+                    parent_.measure_.LayoutSum(ty).payload_offset);
 
       target_id_ = new_addr;
 
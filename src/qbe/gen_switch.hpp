@@ -0,0 +1,89 @@
+#pragma once
+
+#include <qbe/ir_emitter.hpp>
+#include <qbe/qbe_value.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include <span>
+
+namespace qbe {
+
+// Jumps to `@match.<label>` of the case whose key equals `key`
+//   with a balanced binary search over the keys, so every dispatch
+//   costs O(log n) compares.
+//
+// QBE has no computed jumps, so there are no real jump tables.
+
+class GenSwitch {
+ public:
+  struct Case {
+    int key;
+    int label;
+  };
+
+  GenSwitch(IrEmitter& parent) : parent_{parent} {
+  }
+
+  // Without a fallback the keys are known to be exhaustive,
+  //   so the last case is taken without a compare
+  void Emit(Value key, std::vector<Case> cases, std::optional<int> fallback) {
+    std::sort(cases.begin(), cases.end(), [](auto& a, auto& b) {
+      return a.key < b.key;
+    });
+
+    if (!fallback) {
+      fallback = cases.back().label;
+      cases.pop_back();
+    }
+
+    Search(key, cases, *fallback);
+  }
+
+ private:
+  // Up to this many cases are compared one by one
+  static constexpr size_t kLinearCases = 3;
+
+  void Search(Value key, std::span<Case> cases, int fallback) {
+    if (cases.size() <= kLinearCases) {
+      for (auto& c : cases) {
+        auto condition = parent_.GenTemporary();
+        auto next = parent_.id_ += 1;
+
+        parent_.Print("  {} =w ceqw {}, {}\n", condition.Emit(), key.Emit(),
+                      c.key);
+        parent_.Print("  jnz {}, @match.{}, @switch.{}\n", condition.Emit(),
+                      c.label, next);
+        parent_.Print("@switch.{}\n", next);
+      }
+
+      parent_.Print("  jmp @match.{}\n", fallback);
+      return;
+    }
+
+    auto mid = cases.size() / 2;
+
+    auto condition = parent_.GenTemporary();
+    auto lower = parent_.id_ += 1;
+    auto upper = parent_.id_ += 1;
+
+    parent_.Print("  {} =w csltw {}, {}\n", condition.Emit(), key.Emit(),
+                  cases[mid].key);
+    parent_.Print("  jnz {}, @switch.{}, @switch.{}\n", condition.Emit(),
+                  lower, upper);
+
+    parent_.Print("@switch.{}\n", lower);
+    Search(key, cases.subspan(0, mid), fallback);
+
+    parent_.Print("@switch.{}\n", upper);
+    Search(key, cases.subspan(mid), fallback);
+  }
+
+ private:
+  IrEmitter& parent_;
+};
+
+}  // namespace qbe
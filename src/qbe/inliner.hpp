@@ -0,0 +1,503 @@
+#pragma once
+
+#include <qbe/escape_analysis.hpp>
+#include <qbe/measure.hpp>
+
+#include <ast/visitors/template_visitor.hpp>
+#include <ast/visitors/just_walk_visitor.hpp>
+#include <ast/scope/context.hpp>
+
+#include <ast/expressions.hpp>
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+#include <deque>
+
+namespace qbe {
+
+// Substitutes the bodies of small functions (and of the ones marked
+//   `@inline`) at their call sites in the monomorphised AST:
+//
+//   at(v, i)  ~>  { var v.1 = v; var i.2 = i; { assert(...); ... } }
+//
+// Every local of the callee gets a fresh name with a dot, which no
+//   identifier of the language has, so nothing in the caller can be
+//   captured. Callees with `return`, with calls through local function
+//   pointers or with ZST parameters are left alone, and so is a callee
+//   refering to a global whose name the caller reuses for a local.
+
+class Inliner : public ReturnVisitor<TreeNode*> {
+ public:
+  static constexpr size_t kMaxSize = 12;
+  static constexpr size_t kMaxDepth = 3;
+
+  Inliner(AllocationEscape::CalleeName callee_name)
+      : callee_name_{callee_name} {
+  }
+
+  void Add(std::string name, FunDeclStatement* function) {
+    auto symbol = function->layer_->RetrieveSymbol(function->GetName());
+    auto attrs = symbol->as_fn_sym.attrs;
+
+    Callee callee{
+        .decl = function,
+        .body = function->body_,
+        .summary = Summary(function),
+        .forced = attrs && attrs->FindAttr("inline"),
+    };
+
+    callee.eligible = !callee.summary.returns;
+
+    for (auto& called : callee.summary.called) {
+      callee.eligible &= !callee.summary.declared.contains(called);
+    }
+
+    for (auto ty : function->type_->as_fun.param_pack) {
+      callee.eligible &= !measure_.IsZST(ty);
+    }
+
+    callees_.insert({std::move(name), std::move(callee)});
+  }
+
+  // Whether the calls to the function may be substituted at all,
+  //   whoever the caller is
+  bool Inlineable(const std::string& name) {
+    auto it = callees_.find(name);
+    return it != callees_.end() && it->second.eligible &&
+           (it->second.forced || it->second.summary.size <= kMaxSize);
+  }
+
+  // Rewrites the body of `function`, true if anything was inlined
+  bool Run(FunDeclStatement* function) {
+    caller_ = function;
+    caller_names_ = Summary(function).declared;
+    inlined_ = false;
+    fresh_ = 0;
+
+    auto body = Eval(function->body_)->as<Expression>();
+
+    if (inlined_) {
+      function->body_ = body;
+    }
+
+    return inlined_;
+  }
+
+  // Statements
+
+  void VisitYield(YieldStatement* node) override {
+    auto n = new YieldStatement{*node};
+    n->yield_value_ = Eval(n->yield_value_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitReturn(ReturnStatement* node) override {
+    auto n = new ReturnStatement{*node};
+    n->return_value_ = Eval(n->return_value_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitAssignment(AssignmentStatement* node) override {
+    auto n = new AssignmentStatement{*node};
+    n->target_ = Eval(n->target_)->as<LvalueExpression>();
+    n->value_ = Eval(n->value_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitExprStatement(ExprStatement* node) override {
+    auto n = new ExprStatement{*node};
+    n->expr_ = Eval(n->expr_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitVarDecl(VarDeclStatement* node) override {
+    auto n = new VarDeclStatement{*node};
+    n->value_ = Eval(n->value_)->as<Expression>();
+    n->lvalue_ = Eval(n->lvalue_)->as<VarAccessExpression>();
+    return_value = n;
+  }
+
+  // Patterns
+
+  void VisitBindingPat(BindingPattern* node) override {
+    auto n = new BindingPattern{*node};
+    n->name_ = Rename(n->name_);
+    return_value = n;
+  }
+
+  void VisitDiscardingPat(DiscardingPattern* node) override {
+    return_value = new DiscardingPattern{*node};
+  }
+
+  void VisitLiteralPat(LiteralPattern* node) override {
+    return_value = new LiteralPattern{*node};
+  }
+
+  void VisitVariantPat(VariantPattern* node) override {
+    auto n = new VariantPattern{*node};
+    if (auto& inner = n->inner_pat_) {
+      inner = Eval(inner)->as<Pattern>();
+    }
+    return_value = n;
+  }
+
+  // Expressions
+
+  void VisitComparison(ComparisonExpression* node) override {
+    auto n = new ComparisonExpression{*node};
+    n->left_ = Eval(n->left_)->as<Expression>();
+    n->right_ = Eval(n->right_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitBinary(BinaryExpression* node) override {
+    auto n = new BinaryExpression{*node};
+    n->left_ = Eval(n->left_)->as<Expression>();
+    n->right_ = Eval(n->right_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitUnary(UnaryExpression* node) override {
+    auto n = new UnaryExpression{*node};
+    n->operand_ = Eval(n->operand_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitDeref(DereferenceExpression* node) override {
+    auto n = new DereferenceExpression{*node};
+    n->operand_ = Eval(n->operand_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitAddressof(AddressofExpression* node) override {
+    auto n = new AddressofExpression{*node};
+    n->operand_ = Eval(n->operand_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitIf(IfExpression* node) override {
+    auto n = new IfExpression{*node};
+    n->condition_ = Eval(n->condition_)->as<Expression>();
+    n->true_branch_ = Eval(n->true_branch_)->as<Expression>();
+    n->false_branch_ = Eval(n->false_branch_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitFor(ForExpression* node) override {
+    auto n = new ForExpression{*node};
+    n->condition_ = Eval(n->condition_)->as<Expression>();
+    n->body_ = Eval(n->body_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitMatch(MatchExpression* node) override {
+    auto n = new MatchExpression{*node};
+    n->against_ = Eval(n->against_)->as<Expression>();
+    for (auto& [pat, expr] : n->patterns_) {
+      pat = Eval(pat)->as<Pattern>();
+      expr = Eval(expr)->as<Expression>();
+    }
+    return_value = n;
+  }
+
+  void VisitNew(NewExpression* node) override {
+    auto n = new NewExpression{*node};
+    if (auto& alloc = n->allocation_size_) {
+      alloc = Eval(alloc)->as<Expression>();
+    }
+    if (auto& init = n->initial_value_) {
+      init = Eval(init)->as<Expression>();
+    }
+    return_value = n;
+  }
+
+  void VisitBlock(BlockExpression* node) override {
+    auto n = new BlockExpression{*node};
+    for (auto& s : n->stmts_) {
+      s = Eval(s)->as<Statement>();
+    }
+    if (n->final_) {
+      n->final_ = Eval(n->final_)->as<Expression>();
+    }
+    return_value = n;
+  }
+
+  void VisitFnCall(FnCallExpression* node) override {
+    auto n = new FnCallExpression{*node};
+    for (auto& a : n->arguments_) {
+      a = Eval(a)->as<Expression>();
+    }
+
+    if (auto callee = Inlineable(n)) {
+      return_value = Expand(n, callee);
+      return;
+    }
+
+    return_value = n;
+  }
+
+  void VisitIntrinsic(IntrinsicCall* node) override {
+    auto n = new IntrinsicCall{*node};
+    for (auto& a : n->arguments_) {
+      a = Eval(a)->as<Expression>();
+    }
+    return_value = n;
+  }
+
+  void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+    auto n = new CompoundInitializerExpr{*node};
+    for (auto& mem : n->initializers_) {
+      if (mem.init) {
+        mem.init = Eval(mem.init)->as<Expression>();
+      }
+    }
+    return_value = n;
+  }
+
+  void VisitFieldAccess(FieldAccessExpression* node) override {
+    auto n = new FieldAccessExpression{*node};
+    n->struct_expression_ = Eval(n->struct_expression_)->as<Expression>();
+    return_value = n;
+  }
+
+  void VisitVarAccess(VarAccessExpression* node) override {
+    auto n = new VarAccessExpression{*node};
+    n->name_ = Rename(n->name_);
+    return_value = n;
+  }
+
+  void VisitLiteral(LiteralExpression* node) override {
+    return_value = new LiteralExpression{*node};
+  }
+
+  void VisitTypecast(TypecastExpression* node) override {
+    auto n = new TypecastExpression{*node};
+    n->expr_ = Eval(n->expr_)->as<Expression>();
+    return_value = n;
+  }
+
+ private:
+  // What is known about a function body without looking at the callers
+  class Summary : public JustWalk {
+   public:
+    Summary(FunDeclStatement* function) {
+      for (auto& formal : function->formals_) {
+        declared.insert(formal.GetName());
+      }
+      function->body_->Accept(this);
+    }
+
+    void VisitYield(YieldStatement* node) override {
+      returns = true;
+      JustWalk::VisitYield(node);
+    }
+
+    void VisitReturn(ReturnStatement* node) override {
+      returns = true;
+      JustWalk::VisitReturn(node);
+    }
+
+    void VisitAssignment(AssignmentStatement* node) override {
+      size += 1;
+      JustWalk::VisitAssignment(node);
+    }
+
+    void VisitVarDecl(VarDeclStatement* node) override {
+      size += 1;
+      declared.insert(node->GetName());
+      JustWalk::VisitVarDecl(node);
+    }
+
+    void VisitBindingPat(BindingPattern* node) override {
+      declared.insert(node->name_.GetName());
+    }
+
+    void VisitComparison(ComparisonExpression* node) override {
+      size += 1;
+      JustWalk::VisitComparison(node);
+    }
+
+    void VisitBinary(BinaryExpression* node) override {
+      size += 1;
+      JustWalk::VisitBinary(node);
+    }
+
+    void VisitUnary(UnaryExpression* node) override {
+      size += 1;
+      JustWalk::VisitUnary(node);
+    }
+
+    void VisitDeref(DereferenceExpression* node) override {
+      size += 1;
+      JustWalk::VisitDeref(node);
+    }
+
+    void VisitIf(IfExpression* node) override {
+      size += 1;
+      JustWalk::VisitIf(node);
+    }
+
+    void VisitFor(ForExpression* node) override {
+      size += 1;
+      JustWalk::VisitFor(node);
+    }
+
+    void VisitMatch(MatchExpression* node) override {
+      size += node->patterns_.size();
+      JustWalk::VisitMatch(node);
+    }
+
+    void VisitNew(NewExpression* node) override {
+      size += 1;
+      JustWalk::VisitNew(node);
+    }
+
+    void VisitFnCall(FnCallExpression* node) override {
+      size += 1;
+      called.insert(node->GetFunctionName());
+      JustWalk::VisitFnCall(node);
+    }
+
+    void VisitIntrinsic(IntrinsicCall* node) override {
+      size += 1;
+      JustWalk::VisitIntrinsic(node);
+    }
+
+    void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+      size += 1;
+      JustWalk::VisitCompoundInitalizer(node);
+    }
+
+    void VisitFieldAccess(FieldAccessExpression* node) override {
+      size += 1;
+      JustWalk::VisitFieldAccess(node);
+    }
+
+    void VisitVarAccess(VarAccessExpression* node) override {
+      used.insert(node->GetName());
+    }
+
+    size_t size = 0;
+    bool returns = false;
+
+    std::unordered_set<std::string_view> declared;
+    std::unordered_set<std::string_view> used;
+    std::unordered_set<std::string_view> called;
+  };
+
+  struct Callee {
+    FunDeclStatement* decl;
+    Expression* body;  // Before anything was inlined into it
+    Summary summary;
+
+    bool forced = false;
+    bool eligible = true;
+  };
+
+  Callee* Inlineable(FnCallExpression* call) {
+    if (stack_.size() >= kMaxDepth) {
+      return nullptr;
+    }
+
+    auto name = callee_name_(call);
+    if (!name) {
+      return nullptr;
+    }
+
+    auto it = callees_.find(*name);
+    if (it == callees_.end()) {
+      return nullptr;
+    }
+
+    auto callee = &it->second;
+
+    if (!callee->eligible || callee->decl == caller_ ||
+        std::find(stack_.begin(), stack_.end(), callee) != stack_.end()) {
+      return nullptr;
+    }
+
+    if (!callee->forced && callee->summary.size > kMaxSize) {
+      return nullptr;
+    }
+
+    auto& summary = callee->summary;
+
+    for (auto names : {&summary.used, &summary.called}) {
+      for (auto global : *names) {
+        if (!summary.declared.contains(global) &&
+            caller_names_.contains(global)) {
+          return nullptr;
+        }
+      }
+    }
+
+    return callee;
+  }
+
+  Expression* Expand(FnCallExpression* call, Callee* callee) {
+    // The arguments were already cloned in the scope of the caller
+    auto saved = std::exchange(renames_, {});
+
+    for (auto name : callee->summary.declared) {
+      names_.push_back(fmt::format("{}.{}", name, fresh_ += 1));
+      renames_.insert({name, names_.back()});
+    }
+
+    std::vector<Statement*> stmts;
+
+    auto& formals = callee->decl->formals_;
+    auto& types = callee->decl->type_->as_fun.param_pack;
+
+    for (size_t i = 0; i < formals.size(); i++) {
+      auto param = new VarAccessExpression{Rename(formals[i])};
+      param->type_ = types[i];
+
+      stmts.push_back(
+          new VarDeclStatement{param, call->arguments_[i], nullptr});
+    }
+
+    stack_.push_back(callee);
+    auto body = Eval(callee->body)->as<Expression>();
+    stack_.pop_back();
+
+    renames_ = std::move(saved);
+    inlined_ = true;
+
+    auto brace = lex::Token{lex::TokenType::LEFT_CBRACE, call->GetLocation()};
+    return new BlockExpression{brace, std::move(stmts), body};
+  }
+
+  lex::Token Rename(lex::Token name) {
+    if (auto it = renames_.find(name.GetName()); it != renames_.end()) {
+      name.sem_info = it->second;
+    }
+    return name;
+  }
+
+ private:
+  AllocationEscape::CalleeName callee_name_;
+
+  std::unordered_map<std::string, Callee> callees_;
+
+  FunDeclStatement* caller_ = nullptr;
+  std::unordered_set<std::string_view> caller_names_;
+
+  // Callees being expanded, innermost last
+  std::vector<Callee*> stack_;
+
+  std::unordered_map<std::string_view, std::string_view> renames_;
+
+  // Fresh names live as long as the tree that refers to them
+  std::deque<std::string> names_;
+  int fresh_ = 0;
+
+  bool inlined_ = false;
+
+  detail::SizeMeasure measure_;
+};
+
+}  // namespace qbe
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+#include <string_view>
+#include <string>
+#include <vector>
+
+namespace qbe {
+
+// Part of every cache key. Bump it whenever the emitter starts
+//   producing different IR for the same function, so that the
+//   text from older compilers is never reused.
+inline constexpr uint64_t kIrCacheVersion = 28;
+
+//////////////////////////////////////////////////////////////////////
+
+// What the callers of a cached function need to know about its body,
+//   which is not instantiated (see IrEmitter::LookUpCache)
+struct CachedSummary {
+  // The inliner may substitute it, so the body is needed after all
+  bool inlineable = false;
+
+  // Per parameter, whether an allocation passed there escapes
+  std::vector<bool> escaping;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Emitted QBE text of monomorphised functions, one file per
+//   instantiation. The key (see types::instantiate::Fingerprint)
+//   covers the definition and all the types it depends on,
+//   so stale entries are never hit, only left behind.
+//
+// The file starts with a line holding the summary:
+//
+//   # inline 0 escapes 01
+
+class IrCache {
+ public:
+  explicit IrCache(std::filesystem::path dir) : dir_{std::move(dir)} {
+    std::filesystem::create_directories(dir_);
+
+    // The instantiator asks about every function, once per build
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+      if (entry.path().extension() == ".ssa") {
+        auto key = entry.path().stem().string();
+        local_keys_.insert(key.substr(0, key.rfind('.')));
+      }
+    }
+  }
+
+  // There is an entry for the function with this fingerprint,
+  //   whatever its callees were
+  bool Knows(const std::string& local_key) const {
+    return local_keys_.contains(local_key);
+  }
+
+  // Also reads the entry, so that `Get` can't miss after this
+  bool Contains(const std::string& key) {
+    if (loaded_.contains(key)) {
+      return true;
+    }
+
+    std::ifstream file(PathOf(key));
+
+    if (!file.is_open()) {
+      return false;
+    }
+
+    // Entries of older compilers have other keys, so a line that
+    //   does not parse is a damaged entry: a miss
+    std::string line;
+    std::getline(file, line);
+
+    std::string_view header = line;
+    auto bits = header.find(kEscapes);
+
+    if (!header.starts_with(kInline) || bits == header.npos) {
+      return false;
+    }
+
+    Entry entry;
+
+    entry.summary.inlineable =
+        header.substr(kInline.size(), bits - kInline.size()) == "1";
+
+    for (auto c : header.substr(bits + kEscapes.size())) {
+      entry.summary.escaping.push_back(c == '1');
+    }
+
+    entry.text = std::string(std::istreambuf_iterator<char>(file),
+                             std::istreambuf_iterator<char>());
+    loaded_.insert({key, std::move(entry)});
+    return true;
+  }
+
+  std::string_view Get(const std::string& key) {
+    return loaded_.at(key).text;
+  }
+
+  const CachedSummary& GetSummary(const std::string& key) {
+    return loaded_.at(key).summary;
+  }
+
+  void Store(const std::string& key, std::string_view text,
+             const CachedSummary& summary) {
+    auto path = PathOf(key);
+    auto temp = path;
+    temp += ".tmp";
+
+    // Write aside and rename, so that a concurrent or an
+    //   interrupted build never reads a half-written entry
+
+    {
+      std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+      if (!file.is_open()) {
+        return;  // The cache is best effort
+      }
+
+      std::string escaping;
+      for (auto escapes : summary.escaping) {
+        escaping += escapes ? '1' : '0';
+      }
+
+      auto line = fmt::format("{}{:d}{}{}\n", kInline, summary.inlineable,
+                              kEscapes, escaping);
+      file.write(line.data(), line.size());
+      file.write(text.data(), text.size());
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+  }
+
+ private:
+  static constexpr std::string_view kInline = "# inline ";
+  static constexpr std::string_view kEscapes = " escapes ";
+
+  std::filesystem::path PathOf(const std::string& key) {
+    return dir_ / fmt::format("{}.ssa", key);
+  }
+
+ private:
+  struct Entry {
+    std::string text;
+    CachedSummary summary;
+  };
+
+  std::filesystem::path dir_;
+
+  std::unordered_set<std::string> local_keys_;
+  std::unordered_map<std::string, Entry> loaded_;
+};
+
+}  // namespace qbe
@@ -4,7 +4,13 @@
 #include <qbe/gen_match.hpp>
 #include <qbe/gen_addr.hpp>
 #include <qbe/gen_at.hpp>
+#include <qbe/match_compiler.hpp>
+#include <qbe/escape_analysis.hpp>
 
+#include <driver/module.hpp>
+
+#include <algorithm>
+#include <cctype>
 #include <span>
 
 namespace qbe {
@@ -16,27 +22,73 @@ void IrEmitter::GenAddress(Expression* what, Value out) {
   what->Accept(&gen_addr);
 };
 
-void IrEmitter::GenAtAddress(Expression* what, Value where) {
+// QBE takes a slot in any block but @start anew every time the block
+//   runs, so in a loop the stack would grow with every iteration.
+//   Loops reuse their slots instead, a local of the body lives for
+//   one iteration like in C (and a `new` on the stack can not leave
+//   its variable at all, see AllocationEscape)
+void IrEmitter::GenAlloc(Value address, size_t alignment, size_t size) {
+  if (generator_) {
+    start_allocs_ += fmt::format("  {} =l add {}, {}\n", address.Emit(),
+                                 generator_->frame.Emit(),
+                                 FrameSlot(alignment, size));
+    return;
+  }
+
+  auto alloc = fmt::format("  {} =l alloc{} {}\n", address.Emit(), alignment,
+                           size);
+
+  if (loop_depth_ > 0) {
+    start_allocs_ += alloc;
+  } else {
+    text_ += alloc;
+  }
+}
+
+size_t IrEmitter::FrameSlot(size_t alignment, size_t size) {
+  auto offset = (generator_->size + alignment - 1) / alignment * alignment;
+  generator_->size = offset + size;
+  return offset;
+}
+
+void IrEmitter::GenAtAddress(Expression* what, Value where, bool fresh) {
   if (measure_.IsZST(what->GetType())) {
     return;
   }
-  class GenAt gen_addr(*this, where);
+  class GenAt gen_addr(*this, where, fresh);
   what->Accept(&gen_addr);
 };
 
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitVarDecl(VarDeclStatement* node) {
+  auto type = node->value_->GetType();
+
+  if (!escaping_.contains(node->GetName()) && !measure_.IsCompound(type) &&
+      !measure_.IsZST(type)) {
+    Print("# declare {}\n", node->GetName());
+    auto value = Eval(node->value_);
+
+    auto variable = GenTemporary();
+    variable.tag = Value::VARIABLE;
+    named_values_.insert_or_assign(node->GetName(), variable);
+
+    PrintCopyInstruction(variable, value, CopySuf(type));
+
+    return_value = Value::None();
+    return;
+  }
+
   auto address = GenTemporary();
   named_values_.insert_or_assign(node->GetName(), address);
 
   auto [size, alignment] = SizeAlign(node->value_);
-  fmt::print("# declare {}\n", node->GetName());
-  fmt::print("  {} =l alloc{} {}\n", address.Emit(), alignment, size);
+  Print("# declare {}\n", node->GetName());
+  GenAlloc(address, alignment, size);
 
   // Gen at address handles big structures itself!
 
-  GenAtAddress(node->value_, address);
+  GenAtAddress(node->value_, address, FreshSlot());
 
   return_value = Value::None();
 }
@@ -44,6 +96,18 @@ void IrEmitter::VisitVarDecl(VarDeclStatement* node) {
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitAssignment(AssignmentStatement* node) {
+  if (auto var = node->target_->as<VarAccessExpression>()) {
+    auto it = named_values_.find(var->GetName());
+
+    if (it != named_values_.end() && it->second.tag == Value::VARIABLE) {
+      auto value = Eval(node->value_);
+      PrintCopyInstruction(it->second, value, CopySuf(var->GetType()));
+
+      return_value = Value::None();
+      return;
+    }
+  }
+
   auto out = GenTemporary();
 
   GenAddress(node->target_, out);
@@ -67,16 +131,74 @@ void IrEmitter::VisitFunDecl(FunDeclStatement* node) {
     return;
   }
 
-  auto mangled = std::string(node->GetName());
   auto symbol = node->layer_->RetrieveSymbol(node->GetName());
 
-  if (!IsNomangle(symbol->as_fn_sym.attrs) &&
-      !IsTest(symbol->as_fn_sym.attrs)) {
-    mangled += types::Mangle(*node->type_);
+  if (IsTest(symbol->as_fn_sym.attrs)) {
+    auto module = node->layer_->unit.GetName();
+    test_functions_.push_back(
+        {MangledName(node), fmt::format("{}.{}", module, node->GetName())});
+  }
+
+  if (node->cached_) {
+    Print("{}", cache_->Get(node->cache_key_));
+    return;
+  }
+
+  auto mangled = MangledName(node);
+
+  // Number from scratch, so that the text only depends on the function
+  id_ = 0;
+  named_values_.clear();
+  escaping_ = EscapeAnalysis{}.Run(node->body_);
+  current_function_ = mangled;
+
+  stack_allocations_.clear();
+
+  if (allocations_) {
+    stack_allocations_ = allocations_->StackAllocations(node);
   }
 
-  auto qbe_ty = ToQbeType(node->type_->as_fun.result_type);
-  fmt::print("export function {} ${} (", qbe_ty, mangled);
+  auto start = text_.size();
+
+  if (node->generator_) {
+    EmitGenerator(node);
+  } else {
+    EmitFunction(node);
+  }
+
+  EmitStringLiterals();
+  EmitConstants();
+
+  if (cache_ && !node->cache_key_.empty()) {
+    CachedSummary summary;
+
+    if (inliner_) {
+      summary.inlineable = inliner_->Inlineable(mangled);
+    }
+
+    if (allocations_) {
+      summary.escaping = allocations_->Params(mangled);
+    }
+
+    cache_->Store(node->cache_key_, std::string_view{text_}.substr(start),
+                  summary);
+  }
+}
+
+void IrEmitter::EmitFunction(FunDeclStatement* node) {
+  // Aggregates are constructed in the slot given by the caller
+
+  auto result_ty = node->type_->as_fun.result_type;
+  auto in_slot = measure_.IsCompound(result_ty);
+
+  auto qbe_ty = in_slot ? std::string{} : ToQbeType(result_ty);
+  Print("export function {} ${} (", qbe_ty, current_function_);
+
+  return_slot_ = in_slot ? GenParam() : Value::None();
+
+  if (in_slot) {
+    Print("l {}, ", return_slot_.Emit());
+  }
 
   auto& arg_ty = node->type_->as_fun.param_pack;
   auto& formals = node->formals_;
@@ -90,21 +212,189 @@ void IrEmitter::VisitFunDecl(FunDeclStatement* node) {
       continue;
     }
 
-    fmt::print("{} {}, ", ToQbeType(arg_ty[i]), t.Emit());
+    Print("{} {}, ", ToQbeType(arg_ty[i]), t.Emit());
   }
 
-  fmt::print(") {{ \n");
-  fmt::print("@start\n");
+  Print(") {{ \n");
+  Print("@start\n");
 
-  auto out = Eval(node->body_);
+  auto start_block = text_.size();
 
-  fmt::print("@ret\n");
-  fmt::print("  ret {}\n", out.Emit());
-  fmt::print("}}\n\n");
+  auto out = Value::None();
 
-  if (IsTest(symbol->as_fn_sym.attrs)) {
-    test_functions_.push_back(node->GetName());
+  if (in_slot) {
+    // The caller never lets anyone else see the slot before the call
+    GenAtAddress(node->body_, return_slot_, /*fresh=*/true);
+  } else {
+    out = Eval(node->body_);
+  }
+
+  Print("@ret\n");
+  Print("  ret {}\n", out.Emit());
+  Print("}}\n\n");
+
+  text_.insert(start_block, start_allocs_);
+  start_allocs_.clear();
+}
+
+// A generator `fun f x = ...` becomes
+//
+//   $f (x): allocates the frame, stores `x` and $f.resume to it
+//   $f.resume (frame): jumps to where the last `yield` left off
+//
+// Everything the body keeps across a `yield` lives in the frame:
+//   its slots, the parameters and the spilled temporaries (see
+//   YieldSpills). `next` in stdlib/gen.et calls the resume function.
+void IrEmitter::EmitGenerator(FunDeclStatement* node) {
+  auto gen_ty = node->type_->as_fun.result_type->as_ptr.underlying;
+
+  return_slot_ = Value::None();
+  generator_.emplace();
+  generator_->frame = GenParam();
+  generator_->state = GenTemporary();
+  generator_->value = GenTemporary();
+  generator_->size = GetTypeSize(gen_ty);
+
+  auto& frame = generator_->frame;
+
+  auto slot_at = [&](Value address, size_t offset) {
+    start_allocs_ += fmt::format("  {} =l add {}, {}\n", address.Emit(),
+                                 frame.Emit(), offset);
+  };
+
+  auto state_offset = FrameSlot(4, 4);
+  slot_at(generator_->state, state_offset);
+  slot_at(generator_->value, measure_.MeasureFieldOffset(gen_ty, "value"));
+
+  auto& arg_ty = node->type_->as_fun.param_pack;
+  auto& formals = node->formals_;
+
+  std::vector<size_t> param_offsets;
+
+  for (size_t i = 0; i < arg_ty.size(); i++) {
+    auto slot = GenTemporary();
+    named_values_.insert_or_assign(formals[i].GetName(), slot);
+
+    auto [size, alignment] = SizeAlign(arg_ty[i]);
+    param_offsets.push_back(FrameSlot(alignment, size));
+    slot_at(slot, param_offsets.back());
+  }
+
+  Print("function w ${}.resume (l {}) {{\n", current_function_,
+        frame.Emit());
+  Print("@start\n");
+
+  auto start_block = text_.size();
+  auto body_id = id_ += 1;
+
+  Print("@body.{}\n", body_id);
+  Eval(node->body_);
+  GenFinish();
+
+  // Now that all the resume points are known
+
+  auto body = text_.substr(start_block);
+  text_.resize(start_block);
+
+  std::vector<std::string> labels;
+  for (auto id : generator_->yields) {
+    labels.push_back(fmt::format("@yield.{}", id));
+  }
+
+  YieldSpills spills{body, labels};
+  std::unordered_map<int, Value> spill_slots;
+
+  for (auto spill : spills.Spilled()) {
+    auto slot = GenTemporary();
+    slot_at(slot, FrameSlot(8, 8));
+    spill_slots.insert({spill.id, slot});
+  }
+
+  text_ += start_allocs_;
+  start_allocs_.clear();
+
+  // The state is 0 before the first resume, the id of the `yield`
+  //   after it and -1 once the body is done
+
+  auto state = GenTemporary();
+  Print("  {} =w loadw {}\n", state.Emit(), generator_->state.Emit());
+
+  auto dispatch = [&](int key, std::string_view label) {
+    auto is = GenTemporary();
+    auto next = id_ += 1;
+    Print("  {} =w ceqw {}, {}\n", is.Emit(), state.Emit(), key);
+    Print("  jnz {}, {}, @dispatch.{}\n", is.Emit(), label, next);
+    Print("@dispatch.{}\n", next);
+  };
+
+  dispatch(0, fmt::format("@body.{}", body_id));
+  for (size_t i = 0; i < labels.size(); i++) {
+    dispatch(generator_->yields[i], labels[i]);
+  }
+
+  Print("  ret 0\n");
+
+  text_ += spills.Rewrite([&](int id) {
+    return spill_slots.at(id).Emit();
+  });
+
+  Print("}}\n\n");
+
+  // The constructor
+
+  auto frame_size = (generator_->size + 7) / 8 * 8;
+  auto result = GenTemporary();
+
+  Print("export function l ${} (", current_function_);
+
+  std::vector<Value> params;
+
+  for (size_t i = 0; i < arg_ty.size(); i++) {
+    params.push_back(GenParam());
+
+    if (!measure_.IsZST(arg_ty[i])) {
+      Print("{} {}, ", ToQbeType(arg_ty[i]), params.back().Emit());
+    }
   }
+
+  Print(") {{\n");
+  Print("@start\n");
+  Print("  {} =l call $et_alloc (l {})\n", result.Emit(), frame_size);
+
+  auto field_at = [&](size_t offset) {
+    auto address = GenTemporary();
+    Print("  {} =l add {}, {}\n", address.Emit(), result.Emit(), offset);
+    return address;
+  };
+
+  Print("  storel ${}.resume, {}\n", current_function_,
+        field_at(measure_.MeasureFieldOffset(gen_ty, "resume")).Emit());
+  Print("  storew 0, {}\n", field_at(state_offset).Emit());
+
+  for (size_t i = 0; i < arg_ty.size(); i++) {
+    if (measure_.IsZST(arg_ty[i])) {
+      continue;
+    }
+
+    auto slot = field_at(param_offsets[i]);
+
+    if (measure_.IsCompound(arg_ty[i])) {
+      Copy(GetTypeSize(arg_ty[i]), params[i], slot);
+    } else {
+      Print("  store{} {}, {}\n", StoreSuf(arg_ty[i]), params[i].Emit(),
+            slot.Emit());
+    }
+  }
+
+  Print("  ret {}\n", result.Emit());
+  Print("}}\n\n");
+
+  generator_.reset();
+}
+
+void IrEmitter::GenFinish() {
+  Print("  storew -1, {}\n", generator_->state.Emit());
+  Print("  ret 0\n");
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -118,11 +408,361 @@ char GlobalFun(ast::scope::Symbol* symbol) {
   return IsFunctional(symbol) ? '$' : ' ';
 }
 
+// The same for the definition and for the calls: tests of all the
+//   modules go into one binary as `test.module.name`, the rest get
+//   their type appended unless @nomangle
+std::string SymbolName(std::string_view name, ast::scope::Symbol* symbol,
+                       types::Type* mono) {
+  auto attrs = symbol->as_fn_sym.attrs;
+
+  if (IsTest(attrs)) {
+    auto module = std::string(symbol->declared_at.unit.GetName());
+    std::replace_if(
+        module.begin(), module.end(),
+        [](unsigned char c) { return !std::isalnum(c) && c != '_'; }, '_');
+    return fmt::format("test.{}.{}", module, symbol->name);
+  }
+
+  auto mangled = std::string(name);
+
+  if (!IsNomangle(attrs)) {
+    mangled += types::Mangle(*mono);
+  }
+
+  return mangled;
+}
+
+std::string IrEmitter::MangledName(FunDeclStatement* node) {
+  auto symbol = node->layer_->RetrieveSymbol(node->GetName());
+  return SymbolName(node->GetName(), symbol, node->type_);
+}
+
+std::optional<std::string> IrEmitter::CalleeName(FnCallExpression* node) {
+  auto symbol = node->layer_->RetrieveSymbol(node->GetFunctionName());
+
+  if (!IsFunctional(symbol)) {
+    return std::nullopt;
+  }
+
+  return SymbolName(node->GetFunctionName(), symbol, node->callable_type_);
+}
+
+Value IrEmitter::LoadDiscriminant(types::Type* sum, Value addr) {
+  auto layout = measure_.LayoutSum(sum);
+
+  switch (layout.kind) {
+    case detail::SumLayout::SINGLE:
+      return GenConstInt(0);
+
+    case detail::SumLayout::TAGGED: {
+      auto key = GenTemporary();
+      Print("  {} =w {} {}\n", key.Emit(),
+            layout.tag_size == 1 ? "loadub" : "loaduw", addr.Emit());
+      return key;
+    }
+
+    case detail::SumLayout::NICHE: {
+      auto payload = GenTemporary();
+      auto is_niche = GenTemporary();
+
+      Print("  {} =w loadub {}\n", payload.Emit(), addr.Emit());
+      Print("  {} =w ceqw {}, 2\n", is_niche.Emit(), payload.Emit());
+
+      if (layout.niche_variant == 1) {
+        return is_niche;
+      }
+
+      auto key = GenTemporary();
+      Print("  {} =w xor {}, 1\n", key.Emit(), is_niche.Emit());
+      return key;
+    }
+  }
+
+  std::abort();
+}
+
+void IrEmitter::StoreDiscriminant(types::Type* sum, int variant, Value addr) {
+  auto layout = measure_.LayoutSum(sum);
+
+  switch (layout.kind) {
+    case detail::SumLayout::SINGLE:
+      break;
+
+    case detail::SumLayout::TAGGED:
+      Print("  {} {}, {}\n", layout.tag_size == 1 ? "storeb" : "storew",
+            variant, addr.Emit());
+      break;
+
+    // The payload of the other variant writes the rest
+    case detail::SumLayout::NICHE:
+      if (variant == layout.niche_variant) {
+        Print("  storeb 2, {}\n", addr.Emit());
+      }
+      break;
+  }
+}
+
+// Functions called by name
+class DirectCalls : public JustWalk {
+ public:
+  explicit DirectCalls(Expression* body) {
+    body->Accept(this);
+  }
+
+  void VisitFnCall(FnCallExpression* node) override {
+    calls.push_back(node);
+    JustWalk::VisitFnCall(node);
+  }
+
+  std::vector<FnCallExpression*> calls;
+};
+
+void IrEmitter::LookUpCache(const std::vector<FunDeclStatement*>& funs,
+                            InstantiateBody instantiate_body) {
+  instantiate_body_ = std::move(instantiate_body);
+
+  if (!cache_) {
+    return;
+  }
+
+  std::unordered_map<std::string, FunDeclStatement*> by_name;
+  for (auto f : funs) {
+    if (f->body_) {
+      by_name.insert({MangledName(f), f});
+    }
+  }
+
+  std::unordered_map<FunDeclStatement*, std::vector<FunDeclStatement*>> callees;
+  for (auto [_, f] : by_name) {
+    auto calls =
+        f->deferred_ ? f->deferred_calls_ : DirectCalls{f->body_}.calls;
+
+    for (auto call : calls) {
+      auto name = CalleeName(call);
+      auto it = name ? by_name.find(*name) : by_name.end();
+      if (it != by_name.end()) {
+        callees[f].push_back(it->second);
+      }
+    }
+  }
+
+  // The text depends on the bodies of all the functions reachable
+  //   from this one: they are inlined, evaluated and summarized
+
+  std::unordered_map<FunDeclStatement*, std::string> keys;
+
+  for (auto [_, f] : by_name) {
+    if (f->cache_key_.empty()) {
+      continue;
+    }
+
+    std::unordered_set<FunDeclStatement*> reached{f};
+    std::vector<FunDeclStatement*> stack{f};
+    std::vector<std::string_view> reached_keys;
+
+    while (!stack.empty()) {
+      auto g = stack.back();
+      stack.pop_back();
+      reached_keys.push_back(g->cache_key_);
+
+      for (auto callee : callees[g]) {
+        if (reached.insert(callee).second) {
+          stack.push_back(callee);
+        }
+      }
+    }
+
+    std::sort(reached_keys.begin(), reached_keys.end());
+
+    // FNV-1a, 64 bit, as the fingerprint
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto key : reached_keys) {
+      for (unsigned char c : key) {
+        hash = (hash ^ c) * 0x100000001b3;
+      }
+      hash = (hash ^ '/') * 0x100000001b3;
+    }
+
+    keys.insert({f, fmt::format("{}.{:016x}", f->cache_key_, hash)});
+  }
+
+  std::vector<FunDeclStatement*> stack;
+
+  for (auto f : funs) {
+    if (keys.contains(f)) {
+      f->cache_key_ = std::move(keys.at(f));
+      f->cached_ = cache_->Contains(f->cache_key_);
+    }
+
+    if (f->body_ && !f->cached_) {
+      stack.push_back(f);
+    }
+  }
+
+  // Of the hits, the misses only need the bodies they may inline
+  //   (and what those inline in turn), the evaluator asks for
+  //   the rest as it runs into them
+
+  std::unordered_set<FunDeclStatement*> needed{stack.begin(), stack.end()};
+
+  while (!stack.empty()) {
+    auto f = stack.back();
+    stack.pop_back();
+
+    if (f->deferred_) {
+      instantiate_body_(f);
+    }
+
+    for (auto callee : callees[f]) {
+      if (callee->cached_ &&
+          cache_->GetSummary(callee->cache_key_).inlineable &&
+          needed.insert(callee).second) {
+        stack.push_back(callee);
+      }
+    }
+  }
+}
+
+void IrEmitter::InlineCalls(const std::vector<FunDeclStatement*>& funs) {
+  inliner_.emplace([this](FnCallExpression* call) {
+    return CalleeName(call);
+  });
+
+  // Cached functions are inlined into the others as in the build
+  //   that cached them, the ones left polymorphic never were
+  for (auto f : funs) {
+    if (f->body_ && !f->deferred_) {
+      inliner_->Add(MangledName(f), f);
+    }
+  }
+
+  for (auto f : funs) {
+    if (f->body_ && !f->deferred_) {
+      inliner_->Run(f);
+    }
+  }
+}
+
+void IrEmitter::FoldConstants(const std::vector<FunDeclStatement*>& funs) {
+  if (!evaluator_) {
+    evaluator_.emplace(
+        [this](FnCallExpression* call) {
+          return CalleeName(call);
+        },
+        [this](FunDeclStatement* callee) {
+          if (callee->deferred_) {
+            instantiate_body_(callee);
+          }
+        });
+
+    for (auto f : funs) {
+      if (f->body_) {
+        evaluator_->Add(MangledName(f), f);
+      }
+    }
+  }
+
+  for (auto f : funs) {
+    if (!f->body_ || f->deferred_) {
+      continue;
+    }
+
+    current_function_ = MangledName(f);
+
+    ConstantFolding folding([this](FnCallExpression* call) {
+      return EvaluateCall(call);
+    });
+
+    folding.Run(f);
+  }
+}
+
+Expression* IrEmitter::EvaluateCall(FnCallExpression* node) {
+  auto type = node->GetType();
+
+  if (measure_.IsZST(type)) {
+    return nullptr;
+  }
+
+  auto value = evaluator_->Run(node);
+  if (!value) {
+    return nullptr;
+  }
+
+  if (!measure_.IsCompound(type)) {
+    return value->kind == Constant::SCALAR
+               ? MakeLiteral(value->scalar, type, node->GetLocation())
+               : nullptr;
+  }
+
+  std::string image(measure_.MeasureSize(type), '\0');
+
+  if (!WriteConstant(measure_, type, *value, image, 0)) {
+    return nullptr;
+  }
+
+  // data $const.main.0 = align 4 { b 42 0 0 0 2 0 0 0 }
+  auto data = fmt::format("align {} {{ b", measure_.MeasureAlignment(type));
+  for (auto byte : image) {
+    fmt::format_to(std::back_inserter(data), " {}",
+                   static_cast<unsigned char>(byte));
+  }
+  data += " }";
+
+  auto& constants = constants_[current_function_];
+  auto& name = constant_names_.emplace_back(
+      fmt::format("const.{}.{}", current_function_, constants.size()));
+  constants.push_back(std::move(data));
+
+  // Read through its address, like any global
+  auto var = new VarAccessExpression{
+      lex::Token{lex::TokenType::IDENTIFIER, node->GetLocation(),
+                 std::string_view{name}}};
+  var->type_ = type;
+  return var;
+}
+
+void IrEmitter::AnalyzeEscapes(const std::vector<FunDeclStatement*>& funs) {
+  allocations_.emplace([this](FnCallExpression* call) {
+    return CalleeName(call);
+  });
+
+  for (auto f : funs) {
+    if (f->cached_) {
+      auto& summary = cache_->GetSummary(f->cache_key_);
+      allocations_->Add(MangledName(f), f, summary.escaping);
+    } else if (f->body_) {
+      allocations_->Add(MangledName(f), f);
+    }
+  }
+
+  allocations_->Solve();
+}
+
+bool IrEmitter::ReturnsInSlot(FnCallExpression* node) {
+  if (!measure_.IsCompound(node->GetType())) {
+    return false;
+  }
+
+  // C functions are declared without a body, those follow the ABI
+  auto symbol = node->layer_->RetrieveSymbol(node->GetFunctionName());
+
+  return symbol->sym_type != ast::scope::SymbolType::FUN ||
+         !symbol->as_fn_sym.def || symbol->as_fn_sym.def->body_;
+}
+
 void IrEmitter::VisitFnCall(FnCallExpression* node) {
-  auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
+  return_value = GenCall(node, Value::None());
+}
+
+Value IrEmitter::GenCall(FnCallExpression* node, Value slot) {
+  auto in_slot = ReturnsInSlot(node);
+
+  auto out = measure_.IsZST(node->GetType()) || in_slot ? Value::None()
+                                                        : GenTemporary();
 
   // %out = call $rt.memset(l %binding.5, l 0, l 8)
-  fmt::print("# call {}\n", node->GetFunctionName());
+  Print("# call {}\n", node->GetFunctionName());
 
   struct Arg {
     Value v;
@@ -136,40 +776,45 @@ void IrEmitter::VisitFnCall(FnCallExpression* node) {
 
   // If there are struct args, I need to allocate space for them and copy there
 
-  auto mangled = std::string(node->GetFunctionName());
   auto symbol = node->layer_->RetrieveSymbol(node->GetFunctionName());
+  auto callee = CalleeName(node);
 
-  if (!IsFunctional(symbol)) {
-    mangled = named_values_[mangled].Emit();
-  } else if (!IsNomangle(symbol->as_fn_sym.attrs) &&
-             !IsTest(symbol->as_fn_sym.attrs)) {
-    mangled += types::Mangle(*node->callable_type_);
-  }
+  auto mangled = callee ? *callee
+                        : named_values_[node->GetFunctionName()].Emit();
 
-  if (measure_.IsZST(node->GetType())) {
-    fmt::print("  call {}{} ( ", GlobalFun(symbol), mangled);
+  if (in_slot) {
+    if (slot.tag == Value::NONE) {
+      auto [size, alignment] = SizeAlign(node);
+      slot = GenTemporary();
+      GenAlloc(slot, alignment, size);
+    }
+
+    out = slot;
+    Print("  call {}{} ( l {}, ", GlobalFun(symbol), mangled, slot.Emit());
+  } else if (measure_.IsZST(node->GetType())) {
+    Print("  call {}{} ( ", GlobalFun(symbol), mangled);
   } else {
     auto result_ty = ToQbeType(node->GetType());
-    fmt::print("  {} = {} call {}{} ( ", out.Emit(), result_ty,
-               GlobalFun(symbol), mangled);
+    Print("  {} = {} call {}{} ( ", out.Emit(), result_ty,
+          GlobalFun(symbol), mangled);
   }
 
   for (auto& i : args) {
     if (i.v.tag == Value::NONE) {
       continue;
     }
-    fmt::print("{} {}, ", i.qbe_ty, i.v.Emit());
+    Print("{} {}, ", i.qbe_ty, i.v.Emit());
   }
 
-  fmt::print(")\n");
+  Print(")\n");
 
-  return_value = out;
+  return out;
 }
 
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
-  fmt::print("# Call intrinsic {}\n", node->GetFunctionName());
+  Print("# Call intrinsic {}\n", node->GetFunctionName());
 
   switch (node->intrinsic) {
     case ast::elaboration::Intrinsic::PRINT:
@@ -190,18 +835,46 @@ void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitReturn(ReturnStatement* node) {
+  if (generator_) {
+    Eval(node->return_value_);
+    GenFinish();
+    Print("@block{}\n", id_ += 1);
+
+    return_value = Value::None();
+    return;
+  }
+
+  if (return_slot_.tag != Value::NONE) {
+    GenAtAddress(node->return_value_, return_slot_, /*fresh=*/true);
+    Print("  ret\n");
+    Print("@block{}\n", id_ += 1);
+
+    return_value = Value::None();
+    return;
+  }
+
   auto returning = Eval(node->return_value_);
 
-  fmt::print("  ret {}\n", returning.Emit());
-  fmt::print("@block{}\n", id_ += 1);
+  Print("  ret {}\n", returning.Emit());
+  Print("@block{}\n", id_ += 1);
 
   return_value = Value::None();
 }
 
 ////////////////////////////////////////////////////////////////////
 
-void IrEmitter::VisitYield(YieldStatement*) {
-  FMT_ASSERT(false, "Unimplemented!");
+// Leaves the value in the header and returns true from the resume
+//   function, which goes on from the label next time (see
+//   EmitGenerator)
+void IrEmitter::VisitYield(YieldStatement* node) {
+  GenAtAddress(node->yield_value_, generator_->value);
+
+  auto id = id_ += 1;
+  generator_->yields.push_back(id);
+
+  Print("  storew {}, {}\n", id, generator_->state.Emit());
+  Print("  ret 1\n");
+  Print("@yield.{}\n", id);
 
   return_value = Value::None();
 }
@@ -230,8 +903,8 @@ void IrEmitter::VisitDeref(DereferenceExpression* node) {
   }
 
   auto temp = GenTemporary();
-  fmt::print("  {} = {} load{} {}  \n", temp.Emit(), ToQbeType(node->GetType()),
-             LoadSuf(node->GetType()), src.Emit());
+  Print("  {} = {} load{} {}  \n", temp.Emit(), ToQbeType(node->GetType()),
+        LoadSuf(node->GetType()), src.Emit());
   return_value = temp;
 }
 
@@ -250,37 +923,49 @@ void IrEmitter::VisitComparison(ComparisonExpression* node) {
   auto left = Eval(node->left_);
   auto right = Eval(node->right_);
 
+  auto type = node->left_->GetType();
+
+  if (left.tag == Value::CONST_INT && right.tag == Value::CONST_INT &&
+      FoldsAsInt(type)) {
+    if (auto v = FoldComparison(node->operator_.type, left.value,
+                                right.value)) {
+      return_value = GenConstInt(*v);
+      return;
+    }
+  }
+
+  auto suffix = ToQbeType(type);
+  auto sign = SignSuf(type);
+
   switch (node->operator_.type) {
     case lex::TokenType::EQUALS:
-      fmt::print("  {} =w ceq{} {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->left_->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} =w ceq{} {}, {}\n",  //
+            out.Emit(), suffix, left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::NOT_EQ:
-      fmt::print("  {} =w cne{} {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->left_->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} =w cne{} {}, {}\n",  //
+            out.Emit(), suffix, left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::LT:
-      fmt::print("  {} =w csltw {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}lt{} {}, {}\n",  //
+            out.Emit(), sign, suffix, left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::GE:
-      fmt::print("  {} =w csgew {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}ge{} {}, {}\n",  //
+            out.Emit(), sign, suffix, left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::LE:
-      fmt::print("  {} =w cslew {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}le{} {}, {}\n",  //
+            out.Emit(), sign, suffix, left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::GT:
-      fmt::print("  {} =w csgtw {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}gt{} {}, {}\n",  //
+            out.Emit(), sign, suffix, left.Emit(), right.Emit());
       break;
 
     default:
@@ -297,62 +982,131 @@ void IrEmitter::VisitBinary(BinaryExpression* node) {
   auto left = Eval(node->left_);
   auto right = Eval(node->right_);
 
-  // Handle pointer arithmetic
+  auto type = node->GetType();
+  auto right_type = node->right_->GetType();
 
-  if (node->left_->GetType()->tag == types::TypeTag::TY_PTR) {
-    auto ptr_type = node->left_->GetType();
+  // Handle pointer arithmetic, an array is the address of its first
+  //   element here
 
-    auto underlying = ptr_type->as_ptr.underlying;
-    auto multiplier = GetTypeSize(underlying);
+  auto left_type = node->left_->GetType();
+  auto array = types::TypeStorage(left_type);
 
-    auto temp = GenTemporary();
-    fmt::print("  {} =l extuw {}\n", temp.Emit(), right.Emit());
+  if (left_type->tag == types::TypeTag::TY_PTR ||
+      array->tag == types::TypeTag::TY_ARRAY) {
+    auto underlying = left_type->tag == types::TypeTag::TY_PTR
+                          ? left_type->as_ptr.underlying
+                          : array->as_array.element;
+    auto multiplier = GetTypeSize(underlying);
 
-    if (multiplier != 1) {
-      fmt::print("  {} =l mul {}, {}\n",  //
-                 temp.Emit(), temp.Emit(), multiplier);
+    // The index is zero-extended, as below
+    auto index = ToQbeType(right_type) == "l"
+                     ? static_cast<uint64_t>(right.value)
+                     : uint64_t{static_cast<uint32_t>(right.value)};
+    auto scaled = right.tag == Value::CONST_INT && index <= INT32_MAX
+                      ? index * multiplier
+                      : uint64_t{INT32_MAX} + 1;
+
+    if (scaled <= INT32_MAX) {
+      right = GenConstInt(static_cast<int>(scaled));
+    } else {
+      auto temp = GenTemporary();
+
+      if (ToQbeType(right_type) == "l") {
+        Print("  {} =l copy {}\n", temp.Emit(), right.Emit());
+      } else {
+        Print("  {} =l extuw {}\n", temp.Emit(), right.Emit());
+      }
+
+      if (multiplier != 1) {
+        Print("  {} =l mul {}, {}\n",  //
+              temp.Emit(), temp.Emit(), multiplier);
+      }
+
+      right = temp;
     }
-
+  } else if (left.tag == Value::CONST_INT && right.tag == Value::CONST_INT &&
+             FoldsAsInt(type)) {
+    if (auto v = FoldBinary(node->operator_.type, left.value, right.value)) {
+      return_value = GenConstInt(*v);
+      return;
+    }
+  } else if (ToQbeType(type) == "l" && ToQbeType(right_type) == "w" &&
+             right.tag != Value::CONST_INT) {
+    // A generic `x + n` instantiated with a 64-bit `x`
+    auto temp = GenTemporary();
+    Print("  {} =l ext{}w {}\n", temp.Emit(), SignSuf(right_type),
+          right.Emit());
     right = temp;
   }
 
+  // x + 0, x - 0, p + 0
+  if (right.tag == Value::CONST_INT && right.value == 0 &&
+      (node->operator_.type == lex::TokenType::PLUS ||
+       node->operator_.type == lex::TokenType::MINUS)) {
+    return_value = left;
+    return;
+  }
+
   switch (node->operator_.type) {
     case lex::TokenType::PLUS:
-      fmt::print("  {} = {} add {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} = {} add {}, {}\n",  //
+            out.Emit(), ToQbeType(type), left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::MINUS:
-      fmt::print("  {} = {} sub {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} = {} sub {}, {}\n",  //
+            out.Emit(), ToQbeType(type), left.Emit(), right.Emit());
       break;
 
     case lex::TokenType::STAR:
-      fmt::print("  {} =w mul {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} = {} mul {}, {}\n",  //
+            out.Emit(), ToQbeType(type), left.Emit(), right.Emit());
+      break;
+
+    case lex::TokenType::DIV:
+      Print("  {} = {} {}div {}, {}\n",  //
+            out.Emit(), ToQbeType(type), types::IsUnsigned(type) ? "u" : "",
+            left.Emit(), right.Emit());
       break;
 
     default:
       FMT_ASSERT(false, "Unreachable!");
   }
 
+  // U8 lives in a `w`, it wraps around at 256
+  if (type->tag == types::TypeTag::TY_U8) {
+    Print("  {} =w and {}, 255\n", out.Emit(), out.Emit());
+  }
+
   return_value = out;
 }
 
 void IrEmitter::VisitUnary(UnaryExpression* node) {
   auto out = GenTemporary();
+  auto operand = Eval(node->operand_);
+
+  auto type = node->GetType();
+
+  if (operand.tag == Value::CONST_INT && FoldsAsInt(type)) {
+    if (auto v = FoldUnary(node->operator_.type, operand.value)) {
+      return_value = GenConstInt(*v);
+      return;
+    }
+  }
 
   switch (node->operator_.type) {
     case lex::TokenType::MINUS:
-      fmt::print("  {} =w neg {}    \n",  //
-                 out.Emit(), Eval(node->operand_).Emit());
+      Print("  {} = {} neg {}    \n",  //
+            out.Emit(), ToQbeType(type), operand.Emit());
+
+      if (type->tag == types::TypeTag::TY_U8) {
+        Print("  {} =w and {}, 255\n", out.Emit(), out.Emit());
+      }
       break;
 
     case lex::TokenType::NOT:
-      fmt::print("  {} =w ceqw {}, 0\n",  //
-                 out.Emit(), Eval(node->operand_).Emit());
+      Print("  {} =w ceqw {}, 0\n",  //
+            out.Emit(), operand.Emit());
       break;
 
     default:
@@ -364,14 +1118,6 @@ void IrEmitter::VisitUnary(UnaryExpression* node) {
 
 ////////////////////////////////////////////////////////////////////
 
-void PrintCopyInstruction(Value out, Value res, std::string_view assign) {
-  if (res.tag != Value::NONE) {
-    fmt::print("  {} = {} copy {}   \n", out.Emit(), assign, res.Emit());
-  }
-}
-
-////////////////////////////////////////////////////////////////////
-
 void IrEmitter::VisitIf(IfExpression* node) {
   auto true_id = id_ += 1;
   auto false_id = id_ += 1;
@@ -380,28 +1126,61 @@ void IrEmitter::VisitIf(IfExpression* node) {
   auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
   auto condition = Eval(node->condition_);
 
-  fmt::print("#if-start\n");
-  fmt::print("  jnz {}, @true.{}, @false.{}\n",  //
-             condition.Emit(), true_id, false_id);
+  // Only the branch that is taken
+  if (condition.tag == Value::CONST_INT) {
+    auto taken = condition.value ? node->true_branch_ : node->false_branch_;
+    PrintCopyInstruction(out, Eval(taken), CopySuf(node->GetType()));
+    return_value = out;
+    return;
+  }
+
+  Print("#if-start\n");
+  Print("  jnz {}, @true.{}, @false.{}\n",  //
+        condition.Emit(), true_id, false_id);
 
-  fmt::print("@true.{}          \n", true_id);
+  Print("@true.{}          \n", true_id);
   auto true_v = Eval(node->true_branch_);
   auto assign = CopySuf(node->GetType());
 
   PrintCopyInstruction(out, true_v, assign);
-  fmt::print("  jmp @join.{}    \n", join_id);
+  Print("  jmp @join.{}    \n", join_id);
 
-  fmt::print("@false.{}         \n", false_id);
+  Print("@false.{}         \n", false_id);
   auto false_v = Eval(node->false_branch_);
 
   PrintCopyInstruction(out, false_v, assign);
-  fmt::print("@join.{}          \n", join_id);
+  Print("@join.{}          \n", join_id);
 
   return_value = out;
 }
 
 ////////////////////////////////////////////////////////////////////
 
+void IrEmitter::VisitFor(ForExpression* node) {
+  auto cond_id = id_ += 1;
+  auto loop_id = id_ += 1;
+  auto end_id = id_ += 1;
+
+  loop_depth_ += 1;
+
+  Print("@cond.{}          \n", cond_id);
+  auto condition = Eval(node->condition_);
+  Print("  jnz {}, @loop.{}, @end.{}\n",  //
+        condition.Emit(), loop_id, end_id);
+
+  Print("@loop.{}          \n", loop_id);
+  Eval(node->body_);
+  Print("  jmp @cond.{}    \n", cond_id);
+
+  Print("@end.{}           \n", end_id);
+
+  loop_depth_ -= 1;
+
+  return_value = Value::None();
+}
+
+////////////////////////////////////////////////////////////////////
+
 void IrEmitter::VisitMatch(MatchExpression* node) {
   auto assign = CopySuf(node->GetType());
 
@@ -413,6 +1192,11 @@ void IrEmitter::VisitMatch(MatchExpression* node) {
                        CopySuf(node->against_->GetType()));
   target = materialized;
 
+  if (MatchCompiler compiler{*this}; compiler.Applies(node)) {
+    return_value = compiler.Emit(node, target);
+    return;
+  }
+
   auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
   auto end_id = id_ += 1;
 
@@ -423,21 +1207,21 @@ void IrEmitter::VisitMatch(MatchExpression* node) {
     auto lit = !measure_.IsCompound(node->against_->GetType());
     GenMatch match{*this, target, next_arm, lit};
 
-    fmt::print("@match.{}          \n", match_arm);
+    Print("@match.{}          \n", match_arm);
     pat->Accept(&match);
 
     auto res = Eval(expr);
     PrintCopyInstruction(out, res, assign);
 
-    fmt::print("  jmp @match_end.{}    \n", end_id);
+    Print("  jmp @match_end.{}    \n", end_id);
 
     match_arm = next_arm;
     next_arm = id_ += 1;
   }
 
-  fmt::print("@match.{}          \n", match_arm);
+  Print("@match.{}          \n", match_arm);
   CallAbort(node);
-  fmt::print("@match_end.{}    \n", end_id);
+  Print("@match_end.{}    \n", end_id);
 
   return_value = out;
 }
@@ -446,21 +1230,55 @@ void IrEmitter::VisitMatch(MatchExpression* node) {
 
 void IrEmitter::VisitNew(NewExpression* node) {
   auto out = GenTemporary();
+
+  // Never outlives the function
+  if (stack_allocations_.contains(node)) {
+    auto [size, alignment] = SizeAlign(node->underlying_);
+    GenAlloc(out, std::max<size_t>(alignment, 4), size);
+
+    // Programs count on a `new T` without a value starting zeroed
+    if (node->initial_value_) {
+      GenAtAddress(node->initial_value_, out, FreshSlot());
+    } else {
+      Zero(size, out);
+    }
+
+    return_value = out;
+    return;
+  }
+
   auto type_size = GetTypeSize(node->underlying_);
 
   auto size = GenTemporary();
-  fmt::print("  {} =w copy {}\n", size.Emit(), type_size);
 
   if (node->allocation_size_) {
     auto alloc_size = Eval(node->allocation_size_);
-    fmt::print("  {} =w mul {}, {}\n",  //
-               size.Emit(), alloc_size.Emit(), type_size);
+    auto count_type = node->allocation_size_->GetType();
+
+    // In bytes the size may not fit into a `w`
+    if (ToQbeType(count_type) == "l") {
+      Print("  {} =l copy {}\n", size.Emit(), alloc_size.Emit());
+    } else {
+      Print("  {} =l ext{}w {}\n", size.Emit(), SignSuf(count_type),
+            alloc_size.Emit());
+    }
+
+    Print("  {} =l mul {}, {}\n",  //
+          size.Emit(), size.Emit(), type_size);
+  } else {
+    Print("  {} =l copy {}\n", size.Emit(), type_size);
   }
 
-  fmt::print("  {} =l call $malloc (w {})\n", out.Emit(), size.Emit());
+  // The allocator is picked at link time, see stdlib/runtime
+  Print("  {} =l call $et_alloc (l {})\n", out.Emit(), size.Emit());
 
+  // Zeroed as on the stack, none of the allocators clears memory
   if (node->initial_value_) {
-    GenAtAddress(node->initial_value_, out);
+    GenAtAddress(node->initial_value_, out, /*fresh=*/true);
+  } else if (node->allocation_size_) {
+    Print("  call $memset (l {}, w 0, l {})\n", out.Emit(), size.Emit());
+  } else {
+    Zero(type_size, out);
   }
 
   return_value = out;
@@ -491,9 +1309,10 @@ void IrEmitter::VisitCompoundInitalizer(CompoundInitializerExpr* node) {
   auto out = GenTemporary();
 
   auto [size, alignment] = SizeAlign(node);
-  fmt::print("  {} =l alloc{} {}\n", out.Emit(), alignment, size);
+  GenAlloc(out, alignment, size);
 
-  GenAtAddress(node, out);
+  // Nothing has the address of a temporary
+  GenAtAddress(node, out, /*fresh=*/true);
   return_value = out;
 }
 
@@ -515,8 +1334,8 @@ void IrEmitter::VisitFieldAccess(FieldAccessExpression* node) {
   }
 
   auto out = GenTemporary();
-  fmt::print("  {} = {} load{} {}  \n", out.Emit(), ToQbeType(node->GetType()),
-             LoadSuf(node->GetType()), addr.Emit());
+  Print("  {} = {} load{} {}  \n", out.Emit(), ToQbeType(node->GetType()),
+        LoadSuf(node->GetType()), addr.Emit());
   return_value = out;
 }
 
@@ -528,6 +1347,11 @@ void IrEmitter::VisitTypecast(TypecastExpression* node) {
   auto original = node->expr_->GetType();
   auto target = node->type_;
 
+  if (types::IsFloat(original) || types::IsFloat(target)) {
+    return_value = EmitFloatCast(node->expr_, original, target);
+    return;
+  }
+
   if (GetTypeSize(original) == GetTypeSize(target)) {
     return_value = Eval(node->expr_);
     return;
@@ -547,10 +1371,47 @@ void IrEmitter::VisitTypecast(TypecastExpression* node) {
     return;
   }
 
-  if (original->tag == types::TypeTag::TY_CHAR &&
-      target->tag == types::TypeTag::TY_INT) {
+  auto integral = [](types::Type* type) {
+    return types::IsInteger(type) || type->tag == types::TypeTag::TY_CHAR;
+  };
+
+  if (integral(original) && integral(target)) {
+    auto value = Eval(node->expr_);
+    auto from = GetTypeSize(original);
+    auto to = GetTypeSize(target);
+
+    // A wider `l` is used as a `w` as is
+    if (to == 4 && from == 8) {
+      return_value = value;
+      return;
+    }
+
+    if (value.tag == Value::CONST_INT) {
+      auto v = value.value;
+
+      if (from == 1 || to == 1) {
+        v &= 0xFF;
+      } else if (from == 4) {
+        v = types::IsUnsigned(original) ? int64_t{static_cast<uint32_t>(v)}
+                                        : int64_t{static_cast<int32_t>(v)};
+      }
+
+      return_value = GenConstInt(v);
+      return;
+    }
+
     auto cast = GenTemporary();
-    fmt::print("  {} = w extub {}\n", cast.Emit(), Eval(node->expr_).Emit());
+
+    if (to == 1) {
+      Print("  {} =w and {}, 255\n", cast.Emit(), value.Emit());
+    } else if (from == 1) {
+      Print("  {} = {} extub {}\n", cast.Emit(), ToQbeType(target),
+            value.Emit());
+    } else {
+      Print("  {} =l ext{}w {}\n", cast.Emit(), SignSuf(original),
+            value.Emit());
+    }
+
     return_value = cast;
     return;
   }
@@ -559,13 +1420,69 @@ void IrEmitter::VisitTypecast(TypecastExpression* node) {
   std::abort();  // Unreachable
 }
 
+// F32 <-> F64 and the integers (or Char) <-> F32, F64
+Value IrEmitter::EmitFloatCast(Expression* expr, types::Type* original,
+                               types::Type* target) {
+  auto value = Eval(expr);
+
+  if (original->tag == target->tag) {
+    return value;
+  }
+
+  auto cast = GenTemporary();
+  auto to = ToQbeType(target);
+
+  if (types::IsFloat(original) && types::IsFloat(target)) {
+    Print("  {} = {} {} {}\n", cast.Emit(), to,
+          target->tag == types::TypeTag::TY_F64 ? "exts" : "truncd",
+          value.Emit());
+    return cast;
+  }
+
+  if (types::IsFloat(target)) {
+    auto from = GetTypeSize(original);
+
+    // Bytes are zero-extended to a `w` first
+    if (from == 1 && value.tag != Value::CONST_INT) {
+      auto wide = GenTemporary();
+      Print("  {} =w extub {}\n", wide.Emit(), value.Emit());
+      value = wide;
+    }
+
+    Print("  {} = {} {}{}tof {}\n", cast.Emit(), to,
+          from == 1 ? "s" : SignSuf(original), from == 8 ? "l" : "w",
+          value.Emit());
+    return cast;
+  }
+
+  // Truncates toward zero
+  auto to_size = GetTypeSize(target);
+  Print("  {} = {} {}to{}i {}\n", cast.Emit(), to_size == 8 ? "l" : "w",
+        ToQbeType(original), SignSuf(target), value.Emit());
+
+  if (to_size == 1) {
+    Print("  {} =w and {}, 255\n", cast.Emit(), cast.Emit());
+  }
+
+  return cast;
+}
+
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitLiteral(LiteralExpression* node) {
   switch (node->token_.type) {
     case lex::TokenType::CHAR:
     case lex::TokenType::NUMBER:
-      return_value = GenConstInt(std::get<int>(node->token_.sem_info));
+      return_value = GenConstInt(LiteralValue(node));
+      break;
+
+    case lex::TokenType::FLOAT:
+      // d_1.5, s_1.5
+      return_value = Value{
+          .tag = Value::CONST_FLOAT,
+          .name = fmt::format(
+              "{}_{}", ToQbeType(node->GetType()),
+              std::get<std::string_view>(node->token_.sem_info))};
       break;
 
     case lex::TokenType::TRUE:
@@ -577,15 +1494,16 @@ void IrEmitter::VisitLiteral(LiteralExpression* node) {
       break;
 
     case lex::TokenType::STRING:
-      // section ".data.strdata.0"
-      // data $strdata.0 = { b "fowiejf" }
+      // section ".data.strdata.main.0"
+      // data $strdata.main.0 = { b "fowiejf" }
 
       return_value =
           Value{.tag = Value::GLOBAL,
-                .name = fmt::format("strdata.{}", string_literals_.size())};
+                .name = fmt::format("strdata.{}.{}", current_function_,
+                                    string_literals_.size())};
 
       // section ".data.lit"
-      // data $lit = { l $strdata.0, l 7, l 7 }
+      // data $lit = { l $strdata.main.0, l 7, l 7 }
 
       string_literals_.push_back(
           std::get<std::string_view>(node->token_.sem_info));
@@ -628,16 +1546,22 @@ void IrEmitter::VisitVarAccess(VarAccessExpression* node) {
     // Don't need to load params
     case Value::PARAM:
     case Value::CONST_INT:
+    case Value::CONST_FLOAT:
       return_value = location;
       return;
 
+      // Snapshot promoted locals, the expression may assign them later
+    case Value::VARIABLE:
+      PrintCopyInstruction(out, location, CopySuf(node->GetType()));
+      break;
+
       // But do need to load locals
     case Value::TEMPORARY: {
       auto eq_type = ToQbeType(node->GetType());
       auto load_suf = LoadSuf(node->GetType());
 
-      fmt::print("  {} = {} load{} {}\n",  //
-                 out.Emit(), eq_type, load_suf, location.Emit());
+      Print("  {} = {} load{} {}\n",  //
+            out.Emit(), eq_type, load_suf, location.Emit());
       break;
     }
 
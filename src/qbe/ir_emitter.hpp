@@ -2,7 +2,13 @@
 
 #include <qbe/qbe_value.hpp>
 #include <qbe/qbe_types.hpp>
+#include <qbe/ir_cache.hpp>
 #include <qbe/measure.hpp>
+#include <qbe/escape_analysis.hpp>
+#include <qbe/inliner.hpp>
+#include <qbe/yield_spills.hpp>
+#include <qbe/const_fold.hpp>
+#include <qbe/const_eval.hpp>
 
 #include <ast/visitors/template_visitor.hpp>
 
@@ -10,6 +16,10 @@
 #include <ast/patterns.hpp>
 
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <optional>
+#include <iterator>
 #include <utility>
 
 namespace qbe {
@@ -17,12 +27,19 @@ namespace qbe {
 class GenMatch;
 class GenAddr;
 class GenAt;
+class GenSwitch;
+class MatchCompiler;
 
 class IrEmitter : public ReturnVisitor<Value> {
  public:
   friend class GenMatch;
   friend class GenAddr;
   friend class GenAt;
+  friend class GenSwitch;
+  friend class MatchCompiler;
+
+  IrEmitter(IrCache* cache = nullptr) : cache_{cache} {
+  }
 
   virtual void VisitAssignment(AssignmentStatement* node) override;
   virtual void VisitReturn(ReturnStatement* node) override;
@@ -43,6 +60,7 @@ class IrEmitter : public ReturnVisitor<Value> {
   virtual void VisitDeref(DereferenceExpression* node) override;
   virtual void VisitAddressof(AddressofExpression* node) override;
   virtual void VisitIf(IfExpression* node) override;
+  virtual void VisitFor(ForExpression* node) override;
   virtual void VisitMatch(MatchExpression* node) override;
   virtual void VisitNew(NewExpression* node) override;
   virtual void VisitBlock(BlockExpression* node) override;
@@ -70,7 +88,8 @@ class IrEmitter : public ReturnVisitor<Value> {
  public:
   void EmitType(types::Type* ty) {
     if (ty->tag != types::TypeTag::TY_APP &&
-        ty->tag != types::TypeTag::TY_STRUCT) {
+        ty->tag != types::TypeTag::TY_STRUCT &&
+        ty->tag != types::TypeTag::TY_ARRAY) {
       return;
     }
 
@@ -88,13 +107,39 @@ class IrEmitter : public ReturnVisitor<Value> {
           EmitType(mem.ty);
         }
 
-        fmt::print("type :{} = {{ ", Mangle(*ty));
+        auto align = measure_.MeasureAlignment(storage);
 
-        for (auto& mem : members) {
-          fmt::print("{} {}, ", ToQbeType(mem.ty), 1);
+        if (measure_.IsZST(storage)) {
+          Print("type :{} = align {} {{ 0 }}\n", Mangle(*ty), align);
+          break;
+        }
+
+        Print("type :{} = align {} {{ ", Mangle(*ty), align);
+
+        for (auto mem : measure_.StructOrder(storage)) {
+          if (!measure_.IsZST(mem->ty)) {
+            Print("{} 1, ", ToQbeFieldType(mem->ty));
+          }
         }
 
-        fmt::print("}}\n");
+        Print("}}\n");
+        break;
+      }
+
+      // The element repeated, `type :A4i = align 4 { w 4 }`
+      case types::TypeTag::TY_ARRAY: {
+        auto element = storage->as_array.element;
+        EmitType(element);
+
+        auto align = measure_.MeasureAlignment(storage);
+
+        if (measure_.IsZST(storage)) {
+          Print("type :{} = align {} {{ 0 }}\n", Mangle(*ty), align);
+          break;
+        }
+
+        Print("type :{} = align {} {{ {} {} }}\n", Mangle(*ty), align,
+              ToQbeFieldType(element), storage->as_array.length);
         break;
       }
 
@@ -105,12 +150,16 @@ class IrEmitter : public ReturnVisitor<Value> {
           EmitType(mem.ty);
         }
 
-        fmt::print("type :{} = {{ w 1, ", Mangle(*ty));
+        auto layout = measure_.LayoutSum(storage);
 
-        auto size = measure_.MeasureSum(storage);
-        fmt::print(" w {} ", size / 4 - 1);
+        if (layout.size == 0) {
+          Print("type :{} = align 4 {{ 0 }}\n", Mangle(*ty));
+        } else if (layout.align == 8) {
+          Print("type :{} = {{ l {} }}\n", Mangle(*ty), layout.size / 8);
+        } else {
+          Print("type :{} = {{ w {} }}\n", Mangle(*ty), layout.size / 4);
+        }
 
-        fmt::print("}}\n");
         break;
       }
 
@@ -125,30 +174,95 @@ class IrEmitter : public ReturnVisitor<Value> {
     }
   }
 
-  ~IrEmitter() {
+  using InstantiateBody = std::function<void(FunDeclStatement*)>;
+
+  // Marks the functions whose text can come from the IR cache,
+  //   extending their keys with the keys of their callees. The
+  //   deferred bodies of the misses (and of the hits the callers
+  //   may inline) are instantiated here, the rest when evaluated.
+  void LookUpCache(const std::vector<FunDeclStatement*>& funs,
+                   InstantiateBody instantiate_body);
+
+  // Substitutes small callees into the bodies of the functions
+  //   (see inliner.hpp), before anything else looks at them
+  void InlineCalls(const std::vector<FunDeclStatement*>& funs);
+
+  // Folds constants and drops dead branches (see const_fold.hpp),
+  //   evaluating the calls of pure functions on constants on the way
+  //   (see const_eval.hpp)
+  void FoldConstants(const std::vector<FunDeclStatement*>& funs);
+
+  // Decides which `new` go to the stack, before the functions
+  //   are emitted (see escape_analysis.hpp)
+  void AnalyzeEscapes(const std::vector<FunDeclStatement*>& funs);
+
+  // Returns all the IR emitted so far
+  std::string Finish() {
     EmitTestArray();
-    EmitStringLiterals();
+    return std::move(text_);
   }
 
+  // Literals are named after the function using them, so that
+  //   its text does not depend on what was emitted before it
+  //   (and can be cached)
   void EmitStringLiterals() {
     for (size_t i = 0; i < string_literals_.size(); i++) {
-      fmt::print("data $strdata.{} = {{ b \"{}\", b 0 }}", i,
-                 string_literals_[i]);
-      fmt::print("\n");
+      Print("data $strdata.{}.{} = {{ b \"{}\", b 0 }}", current_function_,
+            i, string_literals_[i]);
+      Print("\n");
+    }
+
+    string_literals_.clear();
+  }
+
+  // Aggregates computed at compile time, named like the literals
+  void EmitConstants() {
+    auto& constants = constants_[current_function_];
+
+    for (size_t i = 0; i < constants.size(); i++) {
+      Print("data $const.{}.{} = {}\n", current_function_, i, constants[i]);
     }
   }
 
+  // For stdlib/runtime/test_main.c: the tests and their names,
+  //   both null-terminated
   void EmitTestArray() {
-    fmt::print("export data $et_test_array = {{ ");
+    for (size_t i = 0; i < test_functions_.size(); i++) {
+      Print("data $testname.{} = {{ b \"{}\", b 0 }}\n", i,
+            test_functions_[i].second);
+    }
+
+    Print("export data $et_test_array = {{ ");
+
+    for (auto& [symbol, name] : test_functions_) {
+      Print("l ${}, ", symbol);
+    }
+
+    Print("l 0 }}\n");
+
+    Print("export data $et_test_names = {{ ");
 
     for (size_t i = 0; i < test_functions_.size(); i++) {
-      fmt::print("l ${}, ", test_functions_[i]);
+      Print("l $testname.{}, ", i);
     }
 
-    fmt::print("l 0 }}\n");
+    Print("l 0 }}\n");
   }
 
  private:
+  // All the output goes through here
+  template <typename... Args>
+  void Print(fmt::format_string<Args...> format, Args&&... args) {
+    fmt::format_to(std::back_inserter(text_), format,
+                   std::forward<Args>(args)...);
+  }
+
+  void PrintCopyInstruction(Value out, Value res, std::string_view assign) {
+    if (res.tag != Value::NONE) {
+      Print("  {} = {} copy {}   \n", out.Emit(), assign, res.Emit());
+    }
+  }
+
   char GetStoreSuf(size_t align) {
     switch (align) {
       case 1:
@@ -187,30 +301,69 @@ class IrEmitter : public ReturnVisitor<Value> {
     }
   }
 
-  void Copy(size_t align, size_t size, Value src, Value dst) {
-    auto str_suf = GetStoreSuf(align);
-    auto ld_suf = GetLoadSuf(align);
-    auto ld_res = LoadResult(align);
+  // Bigger aggregates are copied with a call to memcpy
+  static constexpr size_t kCopyUnrollLimit = 64;
+
+  // Widest moves first: all of QBE's targets allow unaligned
+  //   8-byte accesses. With `U8` fields and arrays (`[3]U8`) the
+  //   size need not be a multiple of 4, the last 1 to 3 bytes
+  //   are moved one by one
+  void Copy(size_t size, Value src, Value dst) {
+    if (size > kCopyUnrollLimit) {
+      Print("  call $memcpy (l {}, l {}, l {})\n", dst.Emit(), src.Emit(),
+            size);
+      return;
+    }
+
+    size_t offset = 0;
+
+    for (size_t width : {8, 4, 1}) {
+      for (; offset + width <= size; offset += width) {
+        CopyAt(width, offset, src, dst);
+      }
+    }
+  }
+
+  void CopyAt(size_t width, size_t offset, Value src, Value dst) {
+    if (offset != 0) {
+      auto src_ptr = GenTemporary();
+      auto dst_ptr = GenTemporary();
+      Print("  {} =l add {}, {}\n", src_ptr.Emit(), src.Emit(), offset);
+      Print("  {} =l add {}, {}\n", dst_ptr.Emit(), dst.Emit(), offset);
+      src = src_ptr;
+      dst = dst_ptr;
+    }
 
     auto temp = GenTemporary();
-    auto src_ptr = GenTemporary();
-    auto dst_ptr = GenTemporary();
+    Print("  {} ={} load{} {}\n", temp.Emit(), LoadResult(width),
+          GetLoadSuf(width), src.Emit());
+    Print("  store{} {}, {}\n", GetStoreSuf(width), temp.Emit(), dst.Emit());
+  }
 
-    fmt::print("  {} = l copy {}\n", src_ptr.Emit(), src.Emit());
-    fmt::print("  {} = l copy {}\n", dst_ptr.Emit(), dst.Emit());
+  // The same for zeroing, `new T` without a value starts zeroed
+  void Zero(size_t size, Value dst) {
+    if (size > kCopyUnrollLimit) {
+      Print("  call $memset (l {}, w 0, l {})\n", dst.Emit(), size);
+      return;
+    }
 
-    for (size_t copied = 0; copied < size; copied += align) {
-      fmt::print("# Copying \n");
-      fmt::print("  {} = {} load{} {}\n", temp.Emit(), ld_res, ld_suf,
-                 src_ptr.Emit());
-      fmt::print("  store{} {}, {}  \n", str_suf, temp.Emit(), dst_ptr.Emit());
+    size_t offset = 0;
 
-      fmt::print("  {} =l add {}, {}\n", src_ptr.Emit(), src_ptr.Emit(), align);
-      fmt::print("  {} =l add {}, {}\n", dst_ptr.Emit(), dst_ptr.Emit(), align);
+    for (size_t width : {8, 4, 1}) {
+      for (; offset + width <= size; offset += width) {
+        auto ptr = dst;
+
+        if (offset != 0) {
+          ptr = GenTemporary();
+          Print("  {} =l add {}, {}\n", ptr.Emit(), dst.Emit(), offset);
+        }
+
+        Print("  store{} 0, {}\n", GetStoreSuf(width), ptr.Emit());
+      }
     }
   }
 
-  uint8_t GetTypeSize(types::Type* t) {
+  size_t GetTypeSize(types::Type* t) {
     return measure_.MeasureSize(t);
   }
 
@@ -223,15 +376,15 @@ class IrEmitter : public ReturnVisitor<Value> {
       values.push_back(Eval(a));
     }
 
-    fmt::print("  call $printf (l {}, ..., ", fmt.Emit());
+    Print("  call $printf (l {}, ..., ", fmt.Emit());
 
     for (auto& a : std::span(node->arguments_).subspan(1)) {
       auto value = std::move(values.front());
-      fmt::print("{} {}, ", ToQbeType(a->GetType()), value.Emit());
+      Print("{} {}, ", ToQbeType(a->GetType()), value.Emit());
       values.pop_front();
     }
 
-    fmt::print(")\n");
+    Print(")\n");
   }
 
   void CheckAssertion(Expression* cond) {
@@ -241,18 +394,23 @@ class IrEmitter : public ReturnVisitor<Value> {
 
     auto condition = Eval(cond);
 
-    fmt::print("#if-start\n");
-    fmt::print("  jnz {}, @true.{}, @false.{}\n", condition.Emit(), true_id,
-               false_id);
+    // Holds for sure
+    if (condition.tag == Value::CONST_INT && condition.value) {
+      return;
+    }
+
+    Print("#if-start\n");
+    Print("  jnz {}, @true.{}, @false.{}\n", condition.Emit(), true_id,
+          false_id);
 
-    fmt::print("@true.{}          \n", true_id);
+    Print("@true.{}          \n", true_id);
     // Do nothing
-    fmt::print("  jmp @join.{}    \n", join_id);
+    Print("  jmp @join.{}    \n", join_id);
 
-    fmt::print("@false.{}         \n", false_id);
+    Print("@false.{}         \n", false_id);
     CallAbort(cond);
 
-    fmt::print("@join.{}          \n", join_id);
+    Print("@join.{}          \n", join_id);
   }
 
   void CallAbort(Expression* cond) {
@@ -261,9 +419,9 @@ class IrEmitter : public ReturnVisitor<Value> {
 
     string_literals_.push_back(error_msg_storage_.back());
 
-    fmt::print("  call $printf (l $strdata.{}, ..., ) \n",
-               string_literals_.size() - 1);
-    fmt::print("  call $abort ()  \n");
+    Print("  call $printf (l $strdata.{}.{}, ..., ) \n", current_function_,
+          string_literals_.size() - 1);
+    Print("  call $abort ()  \n");
   }
 
   Value GenParam() {
@@ -274,7 +432,7 @@ class IrEmitter : public ReturnVisitor<Value> {
     return {.tag = Value::TEMPORARY, .id = id_ += 1};
   }
 
-  Value GenConstInt(int value) {
+  Value GenConstInt(int64_t value) {
     return {.tag = Value::CONST_INT, .value = value};
   }
 
@@ -282,17 +440,109 @@ class IrEmitter : public ReturnVisitor<Value> {
     return {.tag = Value::GLOBAL, .name = std::string{name}};
   }
 
+  // A stack slot of the current function (a slot in the frame
+  //   of a generator)
+  void GenAlloc(Value address, size_t alignment, size_t size);
+
+  // A slot taken inside of a loop is the same on every iteration,
+  //   so the previous one may still refer to it
+  bool FreshSlot() const {
+    return loop_depth_ == 0;
+  }
+
+  // Offset of a new slot in the frame of the generator
+  size_t FrameSlot(size_t alignment, size_t size);
+
+  void EmitFunction(FunDeclStatement* node);
+
+  // `*Gen(a)` constructor and its resume function (see VisitYield)
+  void EmitGenerator(FunDeclStatement* node);
+
+  // Marks the generator done and returns false from the resume
+  void GenFinish();
+
   void GenAddress(Expression* what, Value out);
 
-  void GenAtAddress(Expression* what, Value where);
+  // `fresh` when nothing else can refer to `where` yet, so that
+  //   calls may construct their result right there
+  void GenAtAddress(Expression* what, Value where, bool fresh = false);
+
+  // Evaluates the call, constructing an aggregate result in `slot`
+  //   (in a new one if none given) and returning its address
+  Value GenCall(FnCallExpression* node, Value slot);
+
+  bool ReturnsInSlot(FnCallExpression* node);
+
+  std::string MangledName(FunDeclStatement* node);
+
+  // None for calls through function pointers
+  std::optional<std::string> CalleeName(FnCallExpression* node);
+
+  // What to replace the call with, if it is computed at compile time
+  Expression* EvaluateCall(FnCallExpression* node);
+
+  // Index of the variant of the sum stored at `addr`
+  Value LoadDiscriminant(types::Type* sum, Value addr);
+
+  void StoreDiscriminant(types::Type* sum, int variant, Value addr);
+
+  // Typecasts to or from F32 and F64
+  Value EmitFloatCast(Expression* expr, types::Type* original,
+                      types::Type* target);
 
  private:
+  std::string text_;
+
+  IrCache* cache_ = nullptr;
+
+  std::string current_function_;
+
+  // Where the current function constructs its aggregate result
+  Value return_slot_ = Value::None();
+
   int id_ = 0;
 
+  // Slots placed in @start: the ones taken inside of loops, and all
+  //   the slots of a generator (see GenAlloc)
+  int loop_depth_ = 0;
+  std::string start_allocs_;
+
+  // The frame of the generator being emitted: the `Gen(a)` header,
+  //   the state (the label to resume at), then the slots
+  struct GeneratorFrame {
+    Value frame;
+    Value state;
+    Value value;  // `value` field of the header
+    size_t size = 0;
+    std::vector<int> yields;  // `@yield.N` resumes at state N
+  };
+
+  std::optional<GeneratorFrame> generator_;
+
   std::unordered_map<std::string_view, Value> named_values_;
 
+  // Locals of the current function that must stay on the stack
+  std::unordered_set<std::string_view> escaping_;
+
+  std::optional<AllocationEscape> allocations_;
+
+  // Also owns the names of the inlined locals
+  std::optional<Inliner> inliner_;
+
+  std::optional<ConstEvaluator> evaluator_;
+
+  // Clones the body of a function the instantiator deferred
+  InstantiateBody instantiate_body_;
+
+  // Data definitions of the constant aggregates of each function
+  std::unordered_map<std::string, std::vector<std::string>> constants_;
+  std::deque<std::string> constant_names_;
+
+  std::unordered_set<NewExpression*> stack_allocations_;
+
   std::vector<std::string_view> string_literals_;
-  std::vector<std::string_view> test_functions_;
+  // Symbol and `module.name` of each @test function
+  std::vector<std::pair<std::string, std::string>> test_functions_;
 
   std::vector<std::string> error_msg_storage_;
 
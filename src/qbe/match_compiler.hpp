@@ -0,0 +1,479 @@
+#pragma once
+
+#include <qbe/ir_emitter.hpp>
+#include <qbe/gen_switch.hpp>
+#include <qbe/qbe_types.hpp>
+#include <qbe/qbe_value.hpp>
+
+#include <ast/patterns.hpp>
+
+#include <lex/token.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include <map>
+
+namespace qbe {
+
+// Compiles a `match` into a decision tree (Maranget, "Compiling
+//   Pattern Matching to Good Decision Trees").
+//
+// The arms form a matrix: a row per arm, a column per occurrence
+//   (a sub-value of the scrutinee). The compiler switches on the
+//   first column the first row refutes, and continues with the
+//   rows that agree with each outcome. Along any path every
+//   discriminant is loaded and tested once, and the abort block
+//   is only emitted when some path is left without a row.
+//
+//   match list {               switch list
+//   | .cons.next .nil: 1  -->  | .cons: switch list.cons.next
+//   | .cons _: 2               |        | .nil: -> 1
+//   | .nil: 3                  |        | _:    -> 2
+//   }                          | .nil:  -> 3
+
+class MatchCompiler {
+ public:
+  MatchCompiler(IrEmitter& parent) : parent_{parent} {
+  }
+
+  // Literal patterns other than integers, chars, bools
+  //   and units are left to GenMatch
+  bool Applies(MatchExpression* node) {
+    for (auto& [pat, _] : node->patterns_) {
+      if (!Supported(pat)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // `target` is the address of a compound or the value of a scalar
+  Value Emit(MatchExpression* node, Value target) {
+    auto out = parent_.measure_.IsZST(node->GetType())
+                   ? Value::None()
+                   : parent_.GenTemporary();
+
+    auto assign = CopySuf(node->GetType());
+
+    auto compound = parent_.measure_.IsCompound(node->against_->GetType());
+
+    std::vector<Row> rows;
+
+    for (size_t i = 0; i < node->patterns_.size(); i++) {
+      arms_.push_back({.label = parent_.id_ += 1});
+      rows.push_back({.pats = {node->patterns_[i].first}, .arm = i});
+    }
+
+    abort_label_ = parent_.id_ += 1;
+    auto end_id = parent_.id_ += 1;
+
+    Compile({{.value = target, .in_memory = compound}}, std::move(rows));
+
+    for (size_t i = 0; i < arms_.size(); i++) {
+      if (!arms_[i].reached) {
+        continue;  // Redundant arm
+      }
+
+      parent_.Print("@match.{}\n", arms_[i].label);
+
+      for (auto& [name, value] : arms_[i].bindings) {
+        parent_.named_values_.insert_or_assign(name, value);
+      }
+
+      auto res = parent_.Eval(node->patterns_[i].second);
+      parent_.PrintCopyInstruction(out, res, assign);
+
+      parent_.Print("  jmp @match_end.{}\n", end_id);
+    }
+
+    if (abort_reachable_) {
+      parent_.Print("@match.{}\n", abort_label_);
+      parent_.CallAbort(node);
+    }
+
+    parent_.Print("@match_end.{}\n", end_id);
+
+    return out;
+  }
+
+ private:
+  struct Occurrence {
+    Value value;
+    bool in_memory = true;  // Otherwise `value` is the scalar itself
+  };
+
+  using Bindings = std::vector<std::pair<std::string_view, Value>>;
+
+  // Null patterns are wildcards
+  struct Row {
+    std::vector<Pattern*> pats;
+    size_t arm;
+    Bindings bindings{};
+  };
+
+  struct Arm {
+    int label;
+    bool reached = false;
+    Bindings bindings{};
+  };
+
+  //////////////////////////////////////////////////////////////////////
+
+  void Compile(std::vector<Occurrence> occs, std::vector<Row> rows) {
+    if (rows.empty()) {
+      abort_reachable_ = true;
+      parent_.Print("  jmp @match.{}\n", abort_label_);
+      return;
+    }
+
+    auto& first = rows.front();
+
+    auto col = std::find_if(first.pats.begin(), first.pats.end(),
+                            [](Pattern* pat) {
+                              return !IsWildcard(pat);
+                            }) -
+               first.pats.begin();
+
+    if ((size_t)col == first.pats.size()) {
+      Leaf(occs, first);
+      return;
+    }
+
+    auto head = first.pats[col];
+
+    if (auto variant = head->as<VariantPattern>()) {
+      auto storage = types::TypeStorage(variant->GetType());
+
+      if (storage->tag == types::TypeTag::TY_STRUCT) {
+        ExpandStruct(occs, rows, col, variant->GetType());
+      } else {
+        SwitchSum(occs, rows, col, storage);
+      }
+      return;
+    }
+
+    SwitchLiteral(occs, rows, col, head->as<LiteralPattern>());
+  }
+
+  void Leaf(std::vector<Occurrence>& occs, Row& row) {
+    for (size_t i = 0; i < occs.size(); i++) {
+      Bind(row, row.pats[i], occs[i]);
+    }
+
+    auto& arm = arms_[row.arm];
+
+    // Every path to the arm binds the same names to the same
+    //   occurrences, see Field
+    if (!arm.reached) {
+      arm.reached = true;
+      arm.bindings = row.bindings;
+    }
+
+    parent_.Print("  jmp @match.{}\n", arm.label);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  // `.field pat` on a struct only projects, so the column is
+  //   replaced by the fields the rows look at
+  void ExpandStruct(std::vector<Occurrence>& occs, std::vector<Row>& rows,
+                    size_t col, types::Type* type) {
+    std::vector<std::string_view> fields;
+
+    for (auto& row : rows) {
+      if (auto variant = As<VariantPattern>(row.pats[col])) {
+        auto name = variant->name_.GetName();
+        if (std::find(fields.begin(), fields.end(), name) == fields.end()) {
+          fields.push_back(name);
+        }
+      }
+    }
+
+    auto sub = Without(occs, col);
+
+    for (auto& name : fields) {
+      auto offset = parent_.measure_.MeasureFieldOffset(type, name);
+      sub.push_back(Field(occs[col], offset));
+    }
+
+    std::vector<Row> next;
+
+    for (auto& row : rows) {
+      auto pat = row.pats[col];
+      auto expanded = Without(row, col, occs[col]);
+
+      for (auto& name : fields) {
+        auto variant = As<VariantPattern>(pat);
+        auto taken = variant && variant->name_.GetName() == name;
+        expanded.pats.push_back(taken ? variant->inner_pat_ : nullptr);
+      }
+
+      next.push_back(std::move(expanded));
+    }
+
+    Compile(std::move(sub), std::move(next));
+  }
+
+  void SwitchSum(std::vector<Occurrence>& occs, std::vector<Row>& rows,
+                 size_t col, types::Type* sum) {
+    auto& variants = sum->as_sum.first;
+    auto occ = occs[col];
+
+    auto key = parent_.LoadDiscriminant(sum, occ.value);
+    auto payload_offset = parent_.measure_.LayoutSum(sum).payload_offset;
+
+    // Constructors in the order of appearance
+
+    std::vector<VariantPattern*> heads;
+
+    for (auto& row : rows) {
+      auto variant = As<VariantPattern>(row.pats[col]);
+
+      auto seen = variant && std::any_of(heads.begin(), heads.end(),
+                                         [&](VariantPattern* head) {
+                                           return head->name_.GetName() ==
+                                                  variant->name_.GetName();
+                                         });
+
+      if (variant && !seen) {
+        heads.push_back(variant);
+      }
+    }
+
+    std::vector<GenSwitch::Case> cases;
+
+    for (auto head : heads) {
+      cases.push_back({
+          .key = parent_.measure_.SumDiscriminant(sum, head->name_.GetName()),
+          .label = parent_.id_ += 1,
+      });
+    }
+
+    auto complete = heads.size() == variants.size();
+    auto fallback = complete ? std::nullopt
+                             : std::optional<int>{parent_.id_ += 1};
+
+    GenSwitch{parent_}.Emit(key, cases, fallback);
+
+    for (size_t i = 0; i < heads.size(); i++) {
+      auto name = heads[i]->name_.GetName();
+
+      auto ty = variants[cases[i].key].ty;
+      auto payload = ty && !parent_.measure_.IsZST(ty);
+
+      parent_.Print("@match.{}\n", cases[i].label);
+
+      auto sub = Without(occs, col);
+      if (payload) {
+        sub.push_back(Field(occ, payload_offset));
+      }
+
+      std::vector<Row> next;
+
+      for (auto& row : rows) {
+        auto variant = As<VariantPattern>(row.pats[col]);
+
+        if (variant && variant->name_.GetName() != name) {
+          continue;
+        }
+
+        auto specialized = Without(row, col, occ);
+        if (payload) {
+          specialized.pats.push_back(variant ? variant->inner_pat_ : nullptr);
+        }
+
+        next.push_back(std::move(specialized));
+      }
+
+      Compile(std::move(sub), std::move(next));
+    }
+
+    if (fallback) {
+      parent_.Print("@match.{}\n", *fallback);
+      Compile(Without(occs, col), Default(rows, col, occ));
+    }
+  }
+
+  void SwitchLiteral(std::vector<Occurrence>& occs, std::vector<Row>& rows,
+                     size_t col, LiteralPattern* head) {
+    auto occ = occs[col];
+    auto key = occ.value;
+
+    if (occ.in_memory) {
+      auto type = head->pat_->GetType();
+
+      key = parent_.GenTemporary();
+      parent_.Print("  {} = {} load{} {}\n", key.Emit(), ToQbeType(type),
+                    LoadSuf(type), occ.value.Emit());
+    }
+
+    std::vector<GenSwitch::Case> cases;
+
+    for (auto& row : rows) {
+      if (auto literal = As<LiteralPattern>(row.pats[col])) {
+        auto value = *KeyOf(literal);
+
+        auto seen = std::any_of(cases.begin(), cases.end(), [&](auto& c) {
+          return c.key == value;
+        });
+
+        if (!seen) {
+          cases.push_back({.key = value, .label = parent_.id_ += 1});
+        }
+      }
+    }
+
+    auto boolean = head->pat_->GetType()->tag == types::TypeTag::TY_BOOL;
+    auto complete = boolean && cases.size() == 2;
+
+    auto fallback = complete ? std::nullopt
+                             : std::optional<int>{parent_.id_ += 1};
+
+    GenSwitch{parent_}.Emit(key, cases, fallback);
+
+    for (auto& c : cases) {
+      std::vector<Row> next;
+
+      for (auto& row : rows) {
+        auto literal = As<LiteralPattern>(row.pats[col]);
+
+        if (literal && *KeyOf(literal) != c.key) {
+          continue;
+        }
+
+        next.push_back(Without(row, col, occ));
+      }
+
+      parent_.Print("@match.{}\n", c.label);
+      Compile(Without(occs, col), std::move(next));
+    }
+
+    if (fallback) {
+      parent_.Print("@match.{}\n", *fallback);
+      Compile(Without(occs, col), Default(rows, col, occ));
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  // The rows that match whatever is not listed in the column
+  std::vector<Row> Default(std::vector<Row>& rows, size_t col,
+                           Occurrence occ) {
+    std::vector<Row> next;
+
+    for (auto& row : rows) {
+      if (IsWildcard(row.pats[col])) {
+        next.push_back(Without(row, col, occ));
+      }
+    }
+
+    return next;
+  }
+
+  Row Without(Row& row, size_t col, Occurrence occ) {
+    auto copy = row;
+    Bind(copy, row.pats[col], occ);
+    copy.pats.erase(copy.pats.begin() + col);
+    return copy;
+  }
+
+  static std::vector<Occurrence> Without(std::vector<Occurrence>& occs,
+                                         size_t col) {
+    auto copy = occs;
+    copy.erase(copy.begin() + col);
+    return copy;
+  }
+
+  void Bind(Row& row, Pattern* pat, Occurrence occ) {
+    if (auto binding = As<BindingPattern>(pat)) {
+      row.bindings.emplace_back(binding->name_.GetName(),
+                                occ.in_memory ? occ.value
+                                              : occ.value.AsPattern());
+    }
+  }
+
+  // The same field of the same occurrence is always held in
+  //   the same temporary, whichever path computes it
+  Occurrence Field(Occurrence occ, size_t offset) {
+    auto [it, fresh] =
+        fields_.try_emplace({occ.value.id, offset}, Value::None());
+
+    if (fresh) {
+      it->second = parent_.GenTemporary();
+    }
+
+    parent_.Print("  {} =l add {}, {}\n", it->second.Emit(),
+                  occ.value.Emit(), offset);
+
+    return {.value = it->second};
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  template <typename T>
+  static T* As(Pattern* pat) {
+    return pat ? pat->as<T>() : nullptr;
+  }
+
+  static bool IsWildcard(Pattern* pat) {
+    if (!pat || pat->as<BindingPattern>() || pat->as<DiscardingPattern>()) {
+      return true;
+    }
+
+    auto literal = pat->as<LiteralPattern>();
+    return literal &&
+           literal->pat_->GetType()->tag == types::TypeTag::TY_UNIT;
+  }
+
+  static bool Supported(Pattern* pat) {
+    if (IsWildcard(pat)) {
+      return true;
+    }
+
+    if (auto variant = pat->as<VariantPattern>()) {
+      return !variant->inner_pat_ || Supported(variant->inner_pat_);
+    }
+
+    return KeyOf(pat->as<LiteralPattern>()).has_value();
+  }
+
+  static std::optional<int> KeyOf(LiteralPattern* pat) {
+    auto& token = pat->pat_->token_;
+
+    // The switch compares `w` keys, see GenSwitch
+    if (!FoldsAsInt(pat->pat_->GetType())) {
+      return std::nullopt;
+    }
+
+    switch (token.type) {
+      case lex::TokenType::NUMBER:
+      case lex::TokenType::CHAR:
+        return static_cast<int>(LiteralValue(pat->pat_));
+
+      case lex::TokenType::TRUE:
+        return 1;
+
+      case lex::TokenType::FALSE:
+        return 0;
+
+      default:
+        return std::nullopt;
+    }
+  }
+
+ private:
+  IrEmitter& parent_;
+
+  std::vector<Arm> arms_;
+
+  int abort_label_ = -1;
+  bool abort_reachable_ = false;
+
+  // (occurrence, offset) -> temporary holding the address
+  std::map<std::pair<int, size_t>, Value> fields_;
+};
+
+}  // namespace qbe
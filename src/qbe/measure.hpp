@@ -2,14 +2,39 @@
 
 #include <types/type.hpp>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 namespace qbe::detail {
 
+// How a sum is placed in memory
+struct SumLayout {
+  enum Kind {
+    TAGGED,  // Discriminant of `tag_size` bytes, then the payload
+    NICHE,   // The variant without a payload is an impossible value
+             //   of the other one's Bool payload (2)
+    SINGLE,  // Only one variant, no discriminant at all
+  } kind = TAGGED;
+
+  size_t tag_size = 0;
+  size_t payload_offset = 0;
+
+  size_t size = 0;
+  size_t align = 4;
+
+  // NICHE only
+  int data_variant = 0;
+  int niche_variant = 0;
+};
+
 class SizeMeasure {
  public:
   bool IsCompound(types::Type* t) {
     t = types::TypeStorage(t);
     return t->tag == types::TypeTag::TY_STRUCT ||
-           t->tag == types::TypeTag::TY_SUM;
+           t->tag == types::TypeTag::TY_SUM ||
+           t->tag == types::TypeTag::TY_ARRAY;
   }
 
   bool IsZST(types::Type* t) {
@@ -21,8 +46,16 @@ class SizeMeasure {
 
     switch (t->tag) {
       case types::TypeTag::TY_INT:
+      case types::TypeTag::TY_U32:
+      case types::TypeTag::TY_F32:
         return 4;
 
+      case types::TypeTag::TY_I64:
+      case types::TypeTag::TY_U64:
+      case types::TypeTag::TY_F64:
+        return 8;
+
+      case types::TypeTag::TY_U8:
       case types::TypeTag::TY_BOOL:
       case types::TypeTag::TY_CHAR:
         return 1;  // Is this ok?
@@ -35,6 +68,9 @@ class SizeMeasure {
       case types::TypeTag::TY_FUN:
         return 8;
 
+      case types::TypeTag::TY_ARRAY:
+        return MeasureAlignment(t->as_array.element);
+
       case types::TypeTag::TY_APP: {
         while (t->tag == types::TypeTag::TY_APP) {
           t = types::ApplyTyconsLazy(t);
@@ -83,7 +119,7 @@ class SizeMeasure {
     }
 
     if (t->tag == types::TypeTag::TY_SUM) {
-      return 4;
+      return LayoutSum(t).payload_offset;
     }
 
     FMT_ASSERT(t->tag == types::TypeTag::TY_STRUCT,
@@ -91,14 +127,14 @@ class SizeMeasure {
 
     size_t offset = 0;
 
-    for (auto& mem : t->as_struct.first) {
+    for (auto mem : StructOrder(t)) {
       // This is important!
-      offset += AddForAlignment(MeasureAlignment(mem.ty), offset);
+      offset += AddForAlignment(MeasureAlignment(mem->ty), offset);
 
-      if (mem.field.compare(field) == 0) {
+      if (mem->field.compare(field) == 0) {
         return offset;
       } else {
-        offset += MeasureSize(mem.ty);
+        offset += MeasureSize(mem->ty);
       }
     }
 
@@ -125,8 +161,16 @@ class SizeMeasure {
 
     switch (t->tag) {
       case types::TypeTag::TY_INT:
+      case types::TypeTag::TY_U32:
+      case types::TypeTag::TY_F32:
         return 4;
 
+      case types::TypeTag::TY_I64:
+      case types::TypeTag::TY_U64:
+      case types::TypeTag::TY_F64:
+        return 8;
+
+      case types::TypeTag::TY_U8:
       case types::TypeTag::TY_BOOL:
       case types::TypeTag::TY_CHAR:
         return 1;
@@ -139,6 +183,9 @@ class SizeMeasure {
       case types::TypeTag::TY_FUN:
         return 8;
 
+      case types::TypeTag::TY_ARRAY:
+        return MeasureSize(t->as_array.element) * t->as_array.length;
+
       case types::TypeTag::TY_APP:
         return MeasureTyApp(t);
 
@@ -164,9 +211,9 @@ class SizeMeasure {
 
     auto result = 0;
 
-    for (auto& mem : t->as_struct.first) {
-      result += AddForAlignment(MeasureAlignment(mem.ty), result);
-      result += MeasureSize(mem.ty);
+    for (auto mem : StructOrder(t)) {
+      result += AddForAlignment(MeasureAlignment(mem->ty), result);
+      result += MeasureSize(mem->ty);
     }
 
     auto align = MeasureAlignment(t);
@@ -175,24 +222,97 @@ class SizeMeasure {
     return result;
   }
 
+  // Fields in the order they are placed in memory: by decreasing
+  //   alignment, so that no padding is needed between them, or as
+  //   declared for `@repr(C)` structs
+  std::vector<types::Member*> StructOrder(types::Type* t) {
+    FMT_ASSERT(t->tag == types::TypeTag::TY_STRUCT, "Incorrect tag");
+
+    std::vector<types::Member*> order;
+
+    for (auto& mem : t->as_struct.first) {
+      order.push_back(&mem);
+    }
+
+    if (!t->as_struct.repr_c) {
+      std::stable_sort(order.begin(), order.end(),
+                       [this](types::Member* a, types::Member* b) {
+                         return MeasureAlignment(a->ty) >
+                                MeasureAlignment(b->ty);
+                       });
+    }
+
+    return order;
+  }
+
   size_t MeasureSum(types::Type* t) {
     FMT_ASSERT(t->tag == types::TypeTag::TY_SUM, "Incorrect tag");
+    return LayoutSum(t).size;
+  }
+
+  SumLayout LayoutSum(types::Type* t) {
+    t = types::TypeStorage(types::FindLeader(t));
+    FMT_ASSERT(t->tag == types::TypeTag::TY_SUM, "Incorrect tag");
+
+    auto& variants = t->as_sum.first;
 
-    auto result = 4;  // 4 bytes for discriminant
-    size_t max_field = 0;
+    SumLayout layout;
+    layout.align = MeasureAlignment(t);
 
-    for (auto& mem : t->as_sum.first) {
+    size_t max_payload = 0;
+    size_t max_align = 0;
+
+    for (auto& mem : variants) {
       if (mem.ty) {
-        max_field = std::max(MeasureSize(mem.ty), max_field);
+        max_payload = std::max(MeasureSize(mem.ty), max_payload);
+        max_align = std::max(MeasureAlignment(mem.ty), max_align);
       }
     }
 
-    auto align = MeasureAlignment(t);
+    if (variants.size() == 1) {
+      layout.kind = SumLayout::SINGLE;
+    } else if (auto niche = FindNiche(t)) {
+      layout = *niche;
+    } else {
+      layout.tag_size = variants.size() <= 256 ? 1 : 4;
+      layout.payload_offset =
+          layout.tag_size + AddForAlignment(max_align, layout.tag_size);
+    }
 
-    result += max_field;
-    result += AddForAlignment(align, result);
+    layout.align = MeasureAlignment(t);
+    layout.size = layout.payload_offset + max_payload;
+    layout.size += AddForAlignment(layout.align, layout.size);
 
-    return result;
+    return layout;
+  }
+
+ private:
+  bool HasPayload(types::Member& variant) {
+    return variant.ty && !IsZST(variant.ty);
+  }
+
+  // `Maybe(Bool)`: 2 is `.none`. Pointers have no niche, null is
+  //   a pointer like any other (`unit ~> _`)
+  std::optional<SumLayout> FindNiche(types::Type* sum) {
+    auto& variants = sum->as_sum.first;
+
+    if (variants.size() != 2 || HasPayload(variants[0]) ==
+                                    HasPayload(variants[1])) {
+      return std::nullopt;
+    }
+
+    auto data = HasPayload(variants[0]) ? 0 : 1;
+    auto payload = types::FindLeader(variants[data].ty);
+
+    if (payload->tag != types::TypeTag::TY_BOOL) {
+      return std::nullopt;
+    }
+
+    return SumLayout{
+        .kind = SumLayout::NICHE,
+        .data_variant = data,
+        .niche_variant = 1 - data,
+    };
   }
 
  private:
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <ast/expressions.hpp>
+#include <ast/error_at_location.hpp>
+
 #include <types/type.hpp>
 
 namespace qbe {
@@ -9,19 +12,30 @@ namespace qbe {
 inline std::string ToQbeType(types::Type* type) {
   switch (type->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_U32:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_BOOL:
       return "w";
 
+    case types::TypeTag::TY_I64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
     case types::TypeTag::TY_FUN:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     case types::TypeTag::TY_UNIT:
       return "";
 
     case types::TypeTag::TY_APP:
     case types::TypeTag::TY_STRUCT:
+    case types::TypeTag::TY_ARRAY:
       return ":" + types::Mangle(*type);
 
     default:
@@ -29,18 +43,43 @@ inline std::string ToQbeType(types::Type* type) {
   }
 }
 
+// Member of an aggregate `type :T = { ... }`, as wide as in memory
+inline std::string ToQbeFieldType(types::Type* type) {
+  switch (type->tag) {
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_CHAR:
+    case types::TypeTag::TY_BOOL:
+      return "b";
+
+    default:
+      return ToQbeType(type);
+  }
+}
+
 inline std::string_view CopySuf(types::Type* type) {
   switch (type->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_U32:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_BOOL:
       return "w";
 
+    case types::TypeTag::TY_I64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
+    case types::TypeTag::TY_FUN:
     case types::TypeTag::TY_APP:
     case types::TypeTag::TY_STRUCT:
+    case types::TypeTag::TY_ARRAY:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_NEVER:
       return "";
@@ -55,14 +94,27 @@ inline std::string_view LoadSuf(types::Type* ty) {
     case types::TypeTag::TY_INT:
       return "sw";
 
+    case types::TypeTag::TY_U32:
+      return "uw";
+
+    case types::TypeTag::TY_U8:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_BOOL:
       return "ub";
 
+    case types::TypeTag::TY_I64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
+    case types::TypeTag::TY_FUN:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     default:
       std::abort();
   }
@@ -71,21 +123,84 @@ inline std::string_view LoadSuf(types::Type* ty) {
 inline std::string_view StoreSuf(types::Type* ty) {
   switch (ty->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U32:
       return "w";
 
+    case types::TypeTag::TY_U8:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_BOOL:
       return "b";
 
+    case types::TypeTag::TY_I64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
+    case types::TypeTag::TY_FUN:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     default:
       std::abort();
   }
 }
 
+// `s` or `u` in `csltw`, `cultl`, ..., nothing in `cltd`
+inline std::string_view SignSuf(types::Type* ty) {
+  if (types::IsFloat(ty)) {
+    return "";
+  }
+  return types::IsUnsigned(ty) ? "u" : "s";
+}
+
+// Constants are folded as 32-bit Int (see const_fold.hpp), the other
+//   number types are left to QBE
+inline bool FoldsAsInt(types::Type* ty) {
+  return !(types::IsInteger(ty) || types::IsFloat(ty)) ||
+         ty->tag == types::TypeTag::TY_INT;
+}
+
+// An integer or Char literal once its type is known: the bits of
+//   the type, the signed types sign-extended to 64
+inline int64_t LiteralValue(LiteralExpression* literal) {
+  auto raw = std::get<uint64_t>(literal->token_.sem_info);
+  auto type = literal->GetType();
+
+  auto bits = 64;
+
+  switch (type->tag) {
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_CHAR:
+      bits = 8;
+      break;
+
+    case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U32:
+      bits = 32;
+      break;
+
+    default:
+      break;
+  }
+
+  if (bits < 64 && raw >> bits) {
+    throw ErrorAtLocation(
+        literal->GetLocation(),
+        fmt::format("Literal {} does not fit into {}", raw, type->Format()));
+  }
+
+  if (bits == 64 || types::IsUnsigned(type) ||
+      type->tag == types::TypeTag::TY_CHAR) {
+    return static_cast<int64_t>(raw);
+  }
+
+  return static_cast<int64_t>(raw << (64 - bits)) >> (64 - bits);
+}
+
 ////////////////////////////////////////////////////////////////////
 
 }  // namespace qbe
@@ -3,6 +3,7 @@
 #include <fmt/core.h>
 #include <string>
 #include <cstdlib>
+#include <cstdint>
 
 namespace qbe {
 
@@ -12,7 +13,9 @@ struct Value {
     PARAM,
     GLOBAL,
     TEMPORARY,
+    VARIABLE,  // A local promoted from the stack to a temporary
     CONST_INT,
+    CONST_FLOAT,  // `d_1.5` in `name`
   } tag;
 
   static Value None() {
@@ -32,10 +35,13 @@ struct Value {
       case GLOBAL:
         return fmt::format("${}", name);
       case TEMPORARY:
+      case VARIABLE:
       case PARAM:
         return fmt::format("%.{}", id);
       case CONST_INT:
         return fmt::format("{}", value);
+      case CONST_FLOAT:
+        return name;
       default:
         std::abort();
     }
@@ -44,7 +50,7 @@ struct Value {
   std::string_view aggregate_type{};
   std::string name{};
   size_t addr = 0;
-  int value = 0;
+  int64_t value = 0;  // See LiteralValue
   int id = 0;
 };
 
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <cctype>
+#include <vector>
+
+namespace qbe {
+
+// A generator returns at every `yield` and the next resume starts the
+//   function over, so the QBE temporaries do not survive a `yield`.
+//   This finds the ones live at the resume labels (liveness over the
+//   blocks of the emitted text), stores them to the frame after each
+//   definition and loads them back at the labels.
+//
+// Temporaries without a definition in the body (the parameters and
+//   the addresses @start computes on every resume) are left alone.
+
+class YieldSpills {
+ public:
+  struct Spill {
+    int id;
+    char type;  // w, l, s or d
+  };
+
+  YieldSpills(std::string_view body, const std::vector<std::string>& labels)
+      : labels_{labels.begin(), labels.end()} {
+    Split(body);
+    Solve();
+  }
+
+  const std::vector<Spill>& Spilled() const {
+    return spilled_;
+  }
+
+  // The body with the stores and the loads, `slot` gives the address
+  //   of a spilled temporary in the frame
+  std::string Rewrite(std::function<std::string(int)> slot) const {
+    std::unordered_map<int, char> types;
+    for (auto spill : spilled_) {
+      types.insert({spill.id, spill.type});
+    }
+
+    std::string result;
+
+    for (size_t b = 0; b < blocks_.size(); b++) {
+      auto& block = blocks_[b];
+
+      for (size_t i = block.begin; i < block.end; i++) {
+        auto& line = lines_[i];
+        result += line.text;
+        result += '\n';
+
+        if (i == block.begin && labels_.contains(block.label)) {
+          std::vector<int> live(live_in_[b].begin(), live_in_[b].end());
+          std::sort(live.begin(), live.end());
+
+          for (auto id : live) {
+            auto type = types.at(id);
+            fmt::format_to(std::back_inserter(result),
+                           "  %.{} ={} load{} {}\n", id, type, type, slot(id));
+          }
+        }
+
+        if (line.def != kNone && types.contains(line.def)) {
+          fmt::format_to(std::back_inserter(result), "  store{} %.{}, {}\n",
+                         types.at(line.def), line.def, slot(line.def));
+        }
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  static constexpr int kNone = -1;
+
+  struct Line {
+    std::string_view text;
+    int def = kNone;
+    char type = 'l';
+    std::vector<int> uses;
+    std::vector<std::string_view> targets;
+    bool terminator = false;
+  };
+
+  struct Block {
+    std::string_view label;
+    size_t begin = 0;
+    size_t end = 0;
+
+    std::unordered_set<int> uses;  // Before any definition in the block
+    std::unordered_set<int> defs;
+    std::vector<size_t> successors;
+  };
+
+  static std::string_view Trim(std::string_view s) {
+    auto first = s.find_first_not_of(' ');
+    return first == s.npos ? std::string_view{} : s.substr(first);
+  }
+
+  // `%.42` at `at`, kNone otherwise
+  static int Temporary(std::string_view s, size_t& at) {
+    if (s.substr(at, 2) != "%.") {
+      return kNone;
+    }
+
+    auto end = at + 2;
+    int id = 0;
+    for (; end < s.size() && std::isdigit(s[end]); end++) {
+      id = id * 10 + (s[end] - '0');
+    }
+
+    if (end == at + 2) {
+      return kNone;
+    }
+
+    at = end;
+    return id;
+  }
+
+  static Line Parse(std::string_view text) {
+    Line line;
+    line.text = text;
+    auto s = Trim(text);
+
+    if (s.empty() || s[0] == '#' || s[0] == '@') {
+      return line;
+    }
+
+    size_t at = 0;
+
+    // %.3 =w add %.1, %.2  or  %.3 = w copy %.1
+    if (auto def = Temporary(s, at); def != kNone) {
+      auto rest = Trim(s.substr(at));
+
+      if (!rest.empty() && rest[0] == '=') {
+        line.def = def;
+        rest = Trim(rest.substr(1));
+        line.type = rest.empty() ? 'l' : rest[0];
+        s = rest;
+      } else {
+        line.uses.push_back(def);
+      }
+    }
+
+    line.terminator = s.starts_with("jmp") || s.starts_with("jnz") ||
+                      s.starts_with("ret") || s.starts_with("hlt");
+
+    for (size_t i = 0; i < s.size(); i++) {
+      if (auto use = Temporary(s, i); use != kNone) {
+        line.uses.push_back(use);
+        i -= 1;
+      } else if (line.terminator && s[i] == '@') {
+        auto end = s.find_first_of(", ", i);
+        line.targets.push_back(s.substr(i, end == s.npos ? end : end - i));
+      }
+    }
+
+    return line;
+  }
+
+  void Split(std::string_view body) {
+    while (!body.empty()) {
+      auto end = body.find('\n');
+      lines_.push_back(Parse(body.substr(0, end)));
+      body = end == body.npos ? std::string_view{} : body.substr(end + 1);
+    }
+
+    std::unordered_map<std::string_view, size_t> by_label;
+
+    for (size_t i = 0; i < lines_.size(); i++) {
+      auto text = Trim(lines_[i].text);
+
+      if (i == 0 || text.starts_with('@')) {
+        auto label = text.starts_with('@')
+                         ? text.substr(0, text.find_first_of(' '))
+                         : std::string_view{};
+        by_label.insert({label, blocks_.size()});
+        auto& block = blocks_.emplace_back();
+        block.label = label;
+        block.begin = i;
+      }
+
+      auto& block = blocks_.back();
+      auto& line = lines_[i];
+      block.end = i + 1;
+
+      for (auto use : line.uses) {
+        if (!block.defs.contains(use)) {
+          block.uses.insert(use);
+        }
+      }
+
+      if (line.def != kNone) {
+        block.defs.insert(line.def);
+        types_.insert({line.def, line.type});
+      }
+    }
+
+    for (size_t b = 0; b < blocks_.size(); b++) {
+      auto& block = blocks_[b];
+
+      auto last = block.end;
+      while (last > block.begin && lines_[last - 1].uses.empty() &&
+             !lines_[last - 1].terminator && lines_[last - 1].def == kNone) {
+        last -= 1;  // Labels and comments
+      }
+
+      if (last > block.begin && lines_[last - 1].terminator) {
+        for (auto target : lines_[last - 1].targets) {
+          block.successors.push_back(by_label.at(target));
+        }
+      } else if (b + 1 < blocks_.size()) {
+        block.successors.push_back(b + 1);
+      }
+    }
+  }
+
+  void Solve() {
+    live_in_.assign(blocks_.size(), {});
+
+    for (auto changed = true; changed;) {
+      changed = false;
+
+      for (size_t b = blocks_.size(); b-- > 0;) {
+        auto& block = blocks_[b];
+        auto live = block.uses;
+
+        for (auto s : block.successors) {
+          for (auto id : live_in_[s]) {
+            if (!block.defs.contains(id)) {
+              live.insert(id);
+            }
+          }
+        }
+
+        if (live.size() != live_in_[b].size()) {
+          live_in_[b] = std::move(live);
+          changed = true;
+        }
+      }
+    }
+
+    std::unordered_set<int> spilled;
+
+    for (size_t b = 0; b < blocks_.size(); b++) {
+      if (!labels_.contains(blocks_[b].label)) {
+        continue;
+      }
+
+      // Only what the body defines
+      std::erase_if(live_in_[b],
+                    [&](int id) { return !types_.contains(id); });
+      spilled.insert(live_in_[b].begin(), live_in_[b].end());
+    }
+
+    for (auto id : spilled) {
+      spilled_.push_back({.id = id, .type = types_.at(id)});
+    }
+
+    std::sort(spilled_.begin(), spilled_.end(),
+              [](Spill a, Spill b) { return a.id < b.id; });
+  }
+
+ private:
+  std::unordered_set<std::string_view> labels_;
+
+  std::vector<Line> lines_;
+  std::vector<Block> blocks_;
+  std::unordered_map<int, char> types_;
+
+  std::vector<std::unordered_set<int>> live_in_;
+  std::vector<Spill> spilled_;
+};
+
+}  // namespace qbe
@@ -5,6 +5,12 @@ namespace types {
 //////////////////////////////////////////////////////////////////////
 
 Type builtin_int{.tag = TypeTag::TY_INT};
+Type builtin_i64{.tag = TypeTag::TY_I64};
+Type builtin_u8{.tag = TypeTag::TY_U8};
+Type builtin_u32{.tag = TypeTag::TY_U32};
+Type builtin_u64{.tag = TypeTag::TY_U64};
+Type builtin_f32{.tag = TypeTag::TY_F32};
+Type builtin_f64{.tag = TypeTag::TY_F64};
 Type builtin_bool{.tag = TypeTag::TY_BOOL};
 Type builtin_char{.tag = TypeTag::TY_CHAR};
 Type builtin_unit{.tag = TypeTag::TY_UNIT};
@@ -5,9 +5,9 @@
 #include <ast/patterns.hpp>
 #include <lex/token.hpp>
 
-namespace types::constraints {
+#include <log/log.hpp>
 
-constexpr bool TraceExpand = false;
+namespace types::constraints {
 
 //////////////////////////////////////////////////////////////////////
 
@@ -17,17 +17,13 @@ void DefineGenerics(Type* ty) {
 
     if (auto symbol = ty->typing_context_->RetrieveSymbol(name, true)) {
       if (symbol->sym_type == ast::scope::SymbolType::GENERIC) {
-        if constexpr (TraceExpand) {
-          fmt::print(stderr, "Using generic {}\n", name.GetName());
-        }
+        ETC_LOG(TRACE, "Using generic {}", name.GetName());
         ty->leader = symbol->as_type.type;
       }
 
     } else {
-      if constexpr (TraceExpand) {
-        fmt::print(stderr, "Defining generic {} at {}\n", name.GetName(),
-                 ty->typing_context_->location.Format());
-      }
+      ETC_LOG(TRACE, "Defining generic {} at {}", name.GetName(),
+              ty->typing_context_->location.Format());
       ty->leader = MakeTypeVar(ty->typing_context_);
       ty->typing_context_->bindings.InsertSymbol({
           .sym_type = ast::scope::SymbolType::GENERIC,
@@ -67,6 +63,10 @@ void Traverse(Type* ty) {
       Traverse(ty->as_ptr.underlying);
       break;
 
+    case TypeTag::TY_ARRAY:
+      Traverse(ty->as_array.element);
+      break;
+
     case TypeTag::TY_STRUCT:
       for (auto& a : ty->as_struct.first) {
         Traverse(a.ty);
@@ -82,6 +82,12 @@ void Traverse(Type* ty) {
     case TypeTag::TY_VARIABLE:
     case TypeTag::TY_PARAMETER:
     case TypeTag::TY_INT:
+    case TypeTag::TY_I64:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -179,6 +185,9 @@ void ExpandTypeVariables::VisitAddressof(AddressofExpression*) {
 void ExpandTypeVariables::VisitIf(IfExpression*) {
 }
 
+void ExpandTypeVariables::VisitFor(ForExpression*) {
+}
+
 void ExpandTypeVariables::VisitMatch(MatchExpression*) {
 }
 
@@ -72,7 +72,27 @@ void AlgorithmW::VisitFunDecl(FunDeclStatement* node) {
     PushEqual(node->GetLocation(), ty, symbol->GetType());
   }
 
-  PushEqual(node->GetLocation(), Eval(node->body_), ty->as_fun.result_type);
+  if (!node->generator_) {
+    PushEqual(node->GetLocation(), Eval(node->body_), ty->as_fun.result_type);
+    node->type_ = return_value = ty;
+    return;
+  }
+
+  // A generator returns `*Gen(a)` (see stdlib/gen.et) right away,
+  //   the body runs on the resumes and yields values of `a`
+
+  auto loc = node->GetLocation();
+
+  yield_type_ = MakeTypeVar(node->layer_);
+  auto gen = MakeTypePtr(MakeTyApp(
+      lex::Token{lex::TokenType::IDENTIFIER, loc, std::string_view{"Gen"}},
+      {yield_type_}));
+  SetTyContext(gen, node->layer_);
+
+  PushEqual(loc, gen, ty->as_fun.result_type);
+  PushEqual(loc, Eval(node->body_), &builtin_unit);
+
+  yield_type_ = nullptr;
 
   node->type_ = return_value = ty;
 }
@@ -131,13 +151,20 @@ void AlgorithmW::VisitVariantPat(VariantPattern* node) {
 //////////////////////////////////////////////////////////////////////
 
 void AlgorithmW::VisitYield(YieldStatement* node) {
-  Eval(node->yield_value_);
-  return_value = &builtin_never;
+  PushEqual(node->GetLocation(), Eval(node->yield_value_), yield_type_);
+  return_value = &builtin_unit;
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void AlgorithmW::VisitReturn(ReturnStatement* node) {
+  // Finishes the generator
+  if (yield_type_) {
+    PushEqual(node->GetLocation(), Eval(node->return_value_), &builtin_unit);
+    return_value = &builtin_never;
+    return;
+  }
+
   auto find = node->layer_->RetrieveSymbol(node->this_fun);
 
   std::vector<Type*> args;
@@ -203,16 +230,32 @@ void AlgorithmW::VisitComparison(ComparisonExpression* node) {
 //////////////////////////////////////////////////////////////////////
 
 void AlgorithmW::VisitBinary(BinaryExpression* node) {
-  PushEqual(node->GetLocation(), Eval(node->right_), &builtin_int);
+  auto right = Eval(node->right_);
+
+  // a[i] is *(a + i), where `a` is a pointer or an array of elements
+  if (node->indexing_) {
+    auto element = MakeTypeVar();
+
+    work_queue_.push_back(MakeNumTrait(right, node->GetLocation()));
+    work_queue_.push_back(
+        MakeIndexTrait(Eval(node->left_), element, node->GetLocation()));
+
+    node->type_ = return_value = MakeTypePtr(element);
+    return;
+  }
 
   node->type_ = return_value = Eval(node->left_);
 
-  work_queue_.push_back(Trait{
-      .tag = TraitTags::ADD,
-      .bound = return_value,
-      .none = {},
-      .location = node->GetLocation(),
-  });
+  // Only the numbers multiply and divide
+  if (node->operator_.type == lex::TokenType::STAR ||
+      node->operator_.type == lex::TokenType::DIV) {
+    work_queue_.push_back(MakeArithTrait(return_value, node->GetLocation()));
+    PushEqual(node->GetLocation(), right, return_value);
+    return;
+  }
+
+  work_queue_.push_back(
+      MakeAddTrait(return_value, right, node->GetLocation()));
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -222,7 +265,7 @@ void AlgorithmW::VisitUnary(UnaryExpression* node) {
 
   switch (node->operator_.type) {
     case lex::TokenType::MINUS:
-      PushEqual(node->GetLocation(), Eval(node->operand_), &builtin_int);
+      work_queue_.push_back(MakeArithTrait(result, node->GetLocation()));
       break;
 
     case lex::TokenType::NOT:
@@ -272,6 +315,15 @@ void AlgorithmW::VisitIf(IfExpression* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void AlgorithmW::VisitFor(ForExpression* node) {
+  PushEqual(node->GetLocation(), Eval(node->condition_), &builtin_bool);
+  Eval(node->body_);
+
+  return_value = &builtin_unit;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void AlgorithmW::VisitMatch(MatchExpression* node) {
   auto result_ty = MakeTypeVar();
   auto target_ty = Eval(node->against_);
@@ -288,7 +340,8 @@ void AlgorithmW::VisitMatch(MatchExpression* node) {
 
 void AlgorithmW::VisitNew(NewExpression* node) {
   if (node->allocation_size_) {
-    PushEqual(node->GetLocation(), Eval(node->allocation_size_), &builtin_int);
+    work_queue_.push_back(
+        MakeNumTrait(Eval(node->allocation_size_), node->GetLocation()));
   }
 
   if (node->initial_value_) {
@@ -401,10 +454,22 @@ void AlgorithmW::VisitIntrinsic(IntrinsicCall* node) {
 //////////////////////////////////////////////////////////////////////
 
 void AlgorithmW::VisitCompoundInitalizer(CompoundInitializerExpr* node) {
-  node->type_ = MakeTypeVar(node->layer_);
-
   auto loc = node->GetLocation();
 
+  if (node->array_) {
+    auto element = MakeTypeVar();
+
+    for (auto& mem : node->initializers_) {
+      PushEqual(loc, element, Eval(mem.init));
+    }
+
+    node->type_ = MakeArrayType(element, node->ArrayLength());
+    return_value = node->type_;
+    return;
+  }
+
+  node->type_ = MakeTypeVar(node->layer_);
+
   for (auto& mem : node->initializers_) {
     auto field_type = mem.init ? Eval(mem.init) : &builtin_unit;
     auto trait = MakeHasFieldTrait(node->type_, mem.field, field_type, loc);
@@ -452,7 +517,13 @@ void AlgorithmW::VisitVarAccess(VarAccessExpression* node) {
 void AlgorithmW::VisitLiteral(LiteralExpression* node) {
   switch (node->token_.type) {
     case lex::TokenType::NUMBER:
-      return_value = &builtin_int;
+      return_value = MakeTypeVar();
+      work_queue_.push_back(MakeNumTrait(return_value, node->GetLocation()));
+      break;
+
+    case lex::TokenType::FLOAT:
+      return_value = MakeTypeVar();
+      work_queue_.push_back(MakeFloatTrait(return_value, node->GetLocation()));
       break;
 
     case lex::TokenType::STRING:
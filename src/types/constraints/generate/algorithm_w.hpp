@@ -40,6 +40,7 @@ class AlgorithmW : public ReturnVisitor<Type*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitFor(ForExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -58,6 +59,9 @@ class AlgorithmW : public ReturnVisitor<Type*> {
   ConstraintSolver& solver_;
 
   std::deque<Trait>& work_queue_;
+
+  // What the generator being checked yields
+  Type* yield_type_ = nullptr;
 };
 
 }  // namespace types::constraints::generate
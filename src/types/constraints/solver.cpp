@@ -4,6 +4,8 @@
 
 #include <ast/error_at_location.hpp>
 
+#include <log/log.hpp>
+
 namespace types::constraints {
 
 ConstraintSolver::ConstraintSolver() {
@@ -74,17 +76,13 @@ void ConstraintSolver::GeneralizeBindingGroup(BindingGroup& group) {
   for (auto def : group) {
     Generalize(def->type_);
 
-    #if LOG_TYPING
-      fmt::print(stderr, "[[Debug]] {} generalized type {}\n", def->GetName(),
-                def->type_->Format());
-    #endif
+    ETC_LOG(DEBUG, "{} generalized type {}", def->GetName(),
+            def->type_->Format());
   }
 }
 
 bool ConstraintSolver::TrySolveConstraint(Trait i) {
-  #if LOG_TYPING
-    fmt::print(stderr, "Solving constraint {}\n", FormatTrait(i));
-  #endif
+  ETC_LOG(TRACE, "Solving constraint {}", FormatTrait(i));
 
   CheckTypes();
 
@@ -95,15 +93,52 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       }
       return true;
 
-    case TraitTags::ADD:
+    case TraitTags::ADD: {
       i.bound = FindLeader(i.bound);
+      auto operand = i.add.operand;
+
+      // Numbers add to their own type, pointers to any integer
+      if (IsInteger(i.bound) || IsFloat(i.bound)) {
+        fill_queue_.push_back(MakeTyEqTrait(operand, i.bound, i.location));
+        return true;
+      }
+
+      if (i.bound->tag == TypeTag::TY_PTR) {
+        fill_queue_.push_back(MakeNumTrait(operand, i.location));
+        return true;
+      }
+
+      if (i.bound->tag == TypeTag::TY_VARIABLE) {
+        break;  // See DefaultTraits
+      }
 
-      if (i.bound->tag == TypeTag::TY_VARIABLE ||
-          i.bound->tag == TypeTag::TY_PARAMETER) {
+      if (i.bound->tag == TypeTag::TY_PARAMETER) {
         i.bound->as_parameter.constraints.push_back(i);
       }
 
+      fill_queue_.push_back(MakeTyEqTrait(operand, &builtin_int, i.location));
       return true;
+    }
+
+    case TraitTags::ARITH:
+    case TraitTags::NUM:
+    case TraitTags::FLOAT: {
+      i.bound = FindLeader(i.bound);
+
+      auto integer = IsInteger(i.bound) && i.tag != TraitTags::FLOAT;
+      auto floating = IsFloat(i.bound) && i.tag != TraitTags::NUM;
+
+      if (integer || floating) {
+        return true;
+      }
+
+      if (i.bound->tag != TypeTag::TY_VARIABLE) {
+        errors_.push_back(i);
+        return true;
+      }
+
+      break;
+    }
 
     case TraitTags::EQ:
       i.bound = FindLeader(i.bound);
@@ -131,7 +166,7 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
         return false;
       }
 
-    case TraitTags::CONVERTIBLE_TO:
+    case TraitTags::CONVERTIBLE_TO: {
       i.bound = FindLeader(i.bound);
       i.convertible_to.to_type = FindLeader(i.convertible_to.to_type);
 
@@ -147,9 +182,13 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
         return true;
       }
 
-      if (i.convertible_to.to_type->tag == TypeTag::TY_INT &&
-          i.bound->tag == TypeTag::TY_CHAR) {
-        // Extension
+      auto numeric = [](Type* type) {
+        return IsInteger(type) || IsFloat(type) ||
+               type->tag == TypeTag::TY_CHAR;
+      };
+
+      if (numeric(i.convertible_to.to_type) && numeric(i.bound)) {
+        // Extension, truncation or a conversion to or from a float
         return true;
       }
 
@@ -159,6 +198,37 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
         return true;
       }
       return false;
+    }
+
+    case TraitTags::INDEX: {
+      i.bound = FindLeader(i.bound);
+      auto element = i.index.element_type;
+
+      if (i.bound->tag == TypeTag::TY_PTR) {
+        fill_queue_.push_back(
+            MakeTyEqTrait(i.bound->as_ptr.underlying, element, i.location));
+        return true;
+      }
+
+      if (i.bound->tag == TypeTag::TY_ARRAY) {
+        fill_queue_.push_back(
+            MakeTyEqTrait(i.bound->as_array.element, element, i.location));
+        return true;
+      }
+
+      if (i.bound->tag == TypeTag::TY_APP) {
+        i.bound = ApplyTyconsLazy(i.bound);
+        fill_queue_.push_back(i);
+        return true;
+      }
+
+      if (i.bound->tag != TypeTag::TY_VARIABLE) {
+        errors_.push_back(i);
+        return true;
+      }
+
+      break;
+    }
 
     case TraitTags::HAS_FIELD:
       i.bound = FindLeader(i.bound);
@@ -197,9 +267,7 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       if (i.bound->tag == TypeTag::TY_APP) {
         i.bound = ApplyTyconsLazy(i.bound);
 
-        #if LOG_TYPING
-          fmt::print(stderr, "Applied tycons {}\n", FormatType(*i.bound));
-        #endif
+        ETC_LOG(TRACE, "Applied tycons {}", FormatType(*i.bound));
 
         fill_queue_.push_back(i);
         return true;
@@ -211,7 +279,6 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       }
 
     case TraitTags::USER_DEFINED:
-    case TraitTags::NUM:
       break;
   }
 
@@ -220,9 +287,9 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
 }
 
 void ConstraintSolver::SolveBatch() {
-  #if LOG_TYPING
+  if (logging::Enabled(logging::Level::TRACE)) {
     PrintQueue();
-  #endif
+  }
 
   bool once_more = true;
 
@@ -231,9 +298,14 @@ void ConstraintSolver::SolveBatch() {
       auto i = std::move(work_queue_.front());
       once_more |= TrySolveConstraint(std::move(i));
       work_queue_.pop_front();
+      solved_ += 1;
     }
 
     std::swap(work_queue_, fill_queue_);
+
+    if (!once_more) {
+      once_more = DefaultTraits();
+    }
   }
 
   if (errors_.size()) {
@@ -242,6 +314,76 @@ void ConstraintSolver::SolveBatch() {
   }
 }
 
+// Nothing tells what `p` in `p[i]` or `p + i` is: it is a pointer
+//   or an Int, as it was before there were arrays and the other
+//   number types. One step at a time, each may tell about the next:
+//
+//   1. `p[i]` takes `p` for a pointer
+//   2. `x + n` takes `x` for the type of `n`, if it is not an Int
+//   3. The literals are Int and F64
+//   4. What is left is generic over `+` or `*`
+bool ConstraintSolver::DefaultTraits() {
+  auto step = [this](auto rule) {
+    bool defaulted = false;
+
+    for (auto& i : work_queue_) {
+      if (i.tag == TraitTags::TYPES_EQ) {
+        continue;
+      }
+
+      i.bound = FindLeader(i.bound);
+
+      if (i.bound->tag == TypeTag::TY_VARIABLE && rule(i)) {
+        defaulted = true;
+      }
+    }
+
+    return defaulted;
+  };
+
+  return step([](Trait& i) {
+           if (i.tag != TraitTags::INDEX) {
+             return false;
+           }
+           i = MakeTyEqTrait(i.bound, MakeTypePtr(i.index.element_type),
+                             i.location);
+           return true;
+         }) ||
+         step([](Trait& i) {
+           if (i.tag != TraitTags::ADD) {
+             return false;
+           }
+           auto operand = FindLeader(i.add.operand);
+           if (operand->tag == TypeTag::TY_INT ||
+               !(IsInteger(operand) || IsFloat(operand))) {
+             return false;
+           }
+           i = MakeTyEqTrait(i.bound, operand, i.location);
+           return true;
+         }) ||
+         step([](Trait& i) {
+           if (i.tag != TraitTags::NUM && i.tag != TraitTags::FLOAT) {
+             return false;
+           }
+           auto type = i.tag == TraitTags::NUM ? &builtin_int : &builtin_f64;
+           i = MakeTyEqTrait(i.bound, type, i.location);
+           return true;
+         }) ||
+         step([](Trait& i) {
+           if (i.tag != TraitTags::ADD && i.tag != TraitTags::ARITH) {
+             return false;
+           }
+           i.bound->as_parameter.constraints.push_back(i);
+           auto operand = i.tag == TraitTags::ADD ? i.add.operand : i.bound;
+           // `x + x` stays generic, `p + 1` takes an Int
+           i = MakeTyEqTrait(operand,
+                             FindLeader(operand) == i.bound ? i.bound
+                                                            : &builtin_int,
+                             i.location);
+           return true;
+         });
+}
+
 void ConstraintSolver::ReportErrors() {
   for (auto& error : errors_) {
     fmt::print(stderr, "Cannot satisfy bound {} arising from {}\n",  //
@@ -23,8 +23,14 @@ class ConstraintSolver {
 
   bool Unify(Type* a, Type* b);
 
+  // Constraints taken off the queue so far, retries included
+  size_t SolvedCount() const {
+    return solved_;
+  }
+
  private:
   void SolveBatch();
+  bool DefaultTraits();
 
   void PrintQueue();
   void ReportErrors();
@@ -43,6 +49,8 @@ class ConstraintSolver {
   std::deque<Trait> fill_queue_;
 
   std::deque<Trait> errors_;
+
+  size_t solved_ = 0;
 };
 
 }  // namespace types::constraints
@@ -19,6 +19,28 @@ Trait MakeOrdTrait(Type* bound, lex::Location loc) {
       .tag = TraitTags::ORD, .bound = bound, .none = {}, .location = loc};
 }
 
+Trait MakeAddTrait(Type* bound, Type* operand, lex::Location loc) {
+  return Trait{.tag = TraitTags::ADD,
+               .bound = bound,
+               .add = {.operand = operand},
+               .location = loc};
+}
+
+Trait MakeArithTrait(Type* bound, lex::Location loc) {
+  return Trait{
+      .tag = TraitTags::ARITH, .bound = bound, .none = {}, .location = loc};
+}
+
+Trait MakeNumTrait(Type* bound, lex::Location loc) {
+  return Trait{
+      .tag = TraitTags::NUM, .bound = bound, .none = {}, .location = loc};
+}
+
+Trait MakeFloatTrait(Type* bound, lex::Location loc) {
+  return Trait{
+      .tag = TraitTags::FLOAT, .bound = bound, .none = {}, .location = loc};
+}
+
 Trait MakeHasFieldTrait(Type* bound, std::string_view name, Type* field_type,
                         lex::Location loc) {
   return Trait{
@@ -29,6 +51,15 @@ Trait MakeHasFieldTrait(Type* bound, std::string_view name, Type* field_type,
   };
 }
 
+Trait MakeIndexTrait(Type* bound, Type* element_type, lex::Location loc) {
+  return Trait{
+      .tag = TraitTags::INDEX,
+      .bound = bound,
+      .index = {.element_type = element_type},
+      .location = loc,
+  };
+}
+
 std::string FormatTrait(Trait& trait) {
   switch (trait.tag) {
     case TraitTags::EQ:
@@ -40,9 +71,15 @@ std::string FormatTrait(Trait& trait) {
     case TraitTags::ADD:
       return fmt::format("Add {}", FormatType(*trait.bound));
 
+    case TraitTags::ARITH:
+      return fmt::format("Arith {}", FormatType(*trait.bound));
+
     case TraitTags::NUM:
       return fmt::format("Num {}", FormatType(*trait.bound));
 
+    case TraitTags::FLOAT:
+      return fmt::format("Float {}", FormatType(*trait.bound));
+
     case TraitTags::CALLABLE:
       return fmt::format("Call {}", FormatType(*trait.bound));
 
@@ -55,6 +92,10 @@ std::string FormatTrait(Trait& trait) {
                          trait.has_field.field_name,
                          FormatType(*trait.has_field.field_type));
 
+    case TraitTags::INDEX:
+      return fmt::format("{}[] ~ {}", FormatType(*trait.bound),
+                         FormatType(*trait.index.element_type));
+
     case TraitTags::CONVERTIBLE_TO:
       return fmt::format("{} ~> {}", FormatType(*trait.bound),
                          FormatType(*trait.convertible_to.to_type));
@@ -78,9 +119,15 @@ std::string FormatTraitNoType(Trait& trait) {
     case TraitTags::ADD:
       return fmt::format("Add");
 
+    case TraitTags::ARITH:
+      return fmt::format("Arith");
+
     case TraitTags::NUM:
       return fmt::format("Num");
 
+    case TraitTags::FLOAT:
+      return fmt::format("Float");
+
     case TraitTags::CALLABLE:
       return fmt::format("Call");
 
@@ -92,6 +139,9 @@ std::string FormatTraitNoType(Trait& trait) {
       return fmt::format("Field '{}' {}", trait.has_field.field_name,
                          FormatType(*trait.has_field.field_type));
 
+    case TraitTags::INDEX:
+      return fmt::format("Index {}", FormatType(*trait.index.element_type));
+
     case TraitTags::CONVERTIBLE_TO:
       return fmt::format("Into {}", FormatType(*trait.convertible_to.to_type));
 
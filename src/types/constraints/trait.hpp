@@ -15,14 +15,17 @@ enum class TraitTags {
   EQ,
   ORD,  // EQ a => ORD a
 
-  ADD,  // only + : for pointers and numeric
-  NUM,  // ADD a => NUM a
+  ADD,    // only + : for pointers and numeric
+  ARITH,  // * / and unary - : integers and floats
+  NUM,    // integers and literals, Int unless told otherwise
+  FLOAT,  // float literals, F64 unless told otherwise
 
   CALLABLE,
 
   TYPES_EQ,
   HAS_FIELD,
   CONVERTIBLE_TO,
+  INDEX,  // a[i] : pointers and arrays
 
   USER_DEFINED,
 };
@@ -32,6 +35,14 @@ struct HasFieldTrait {
   Type* field_type = nullptr;
 };
 
+struct IndexTrait {
+  Type* element_type = nullptr;
+};
+
+struct AddTrait {
+  Type* operand = nullptr;  // The right one
+};
+
 struct ConvertibleToTrait {
   Type* to_type = nullptr;
 };
@@ -55,8 +66,10 @@ struct Trait {
   union {
     None none;  // shut up [-Wmissing-field-initializers] warnings
 
+    AddTrait add;
     ConvertibleToTrait convertible_to;
     HasFieldTrait has_field;
+    IndexTrait index;
     TypesEqual types_equal;
     UserDefinedTrait* user;
   };
@@ -67,8 +80,13 @@ struct Trait {
 Trait MakeTyEqTrait(Type* a, Type* b, lex::Location);
 Trait MakeEqTrait(Type* bound, lex::Location loc);
 Trait MakeOrdTrait(Type* bound, lex::Location loc);
+Trait MakeAddTrait(Type* bound, Type* operand, lex::Location loc);
+Trait MakeArithTrait(Type* bound, lex::Location loc);
+Trait MakeNumTrait(Type* bound, lex::Location loc);
+Trait MakeFloatTrait(Type* bound, lex::Location loc);
 Trait MakeHasFieldTrait(Type* bound, std::string_view name, Type* field_type,
                         lex::Location loc);
+Trait MakeIndexTrait(Type* bound, Type* element_type, lex::Location loc);
 
 std::string FormatTrait(Trait& trait);
 std::string FormatTraitNoType(Trait& trait);
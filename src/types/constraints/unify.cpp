@@ -3,6 +3,8 @@
 
 #include <ast/error_at_location.hpp>
 
+#include <log/log.hpp>
+
 #include <cassert>
 #include <unordered_map>
 
@@ -39,6 +41,15 @@ bool ConstraintSolver::Unify(Type* a, Type* b) {
     return UnifyUnderlyingTypes(la, lb);
   }
 
+  // Array literals have no name: `of Buf var b = [...]`
+  if (lb->tag == TypeTag::TY_APP) {
+    std::swap(la, lb);
+  }
+
+  if (la->tag == TypeTag::TY_APP && lb->tag == TypeTag::TY_ARRAY) {
+    return Unify(ApplyTyconsLazy(la), lb);
+  }
+
   return false;
 }
 
@@ -49,6 +60,10 @@ bool ConstraintSolver::UnifyUnderlyingTypes(Type* a, Type* b) {
     case TypeTag::TY_PTR:
       return Unify(a->as_ptr.underlying, b->as_ptr.underlying);
 
+    case TypeTag::TY_ARRAY:
+      return a->as_array.length == b->as_array.length &&
+             Unify(a->as_array.element, b->as_array.element);
+
     case TypeTag::TY_STRUCT: {
       auto& a_mem = a->as_struct.first;
       auto& b_mem = b->as_struct.first;
@@ -158,12 +173,12 @@ bool ConstraintSolver::UnifyUnderlyingTypes(Type* a, Type* b) {
     case TypeTag::TY_APP: {
       if (a->as_tyapp.name.GetName() != b->as_tyapp.name) {
         while (auto new_a = ApplyTyconsLazy(a)) {
-          fmt::print(stderr, "a ~ {}\n", FormatType(*new_a));
+          ETC_LOG(TRACE, "a ~ {}", FormatType(*new_a));
           a = new_a;
         }
 
         while (auto new_b = ApplyTyconsLazy(b)) {
-          fmt::print(stderr, "b ~ {}\n", FormatType(*new_b));
+          ETC_LOG(TRACE, "b ~ {}", FormatType(*new_b));
           b = new_b;
         }
 
@@ -207,6 +222,10 @@ void ConstraintSolver::Generalize(Type* ty) {
       Generalize(l->as_ptr.underlying);
       break;
 
+    case TypeTag::TY_ARRAY:
+      Generalize(l->as_array.element);
+      break;
+
     case TypeTag::TY_STRUCT:
       for (auto& mem : l->as_struct.first) {
         Generalize(mem.ty);
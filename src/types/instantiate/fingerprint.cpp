@@ -0,0 +1,377 @@
+#include <types/instantiate/fingerprint.hpp>
+
+#include <qbe/ir_cache.hpp>
+
+#include <ast/elaboration/intrinsics.hpp>
+#include <ast/scope/context.hpp>
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
+namespace types::instantiate {
+
+//////////////////////////////////////////////////////////////////////
+
+// FNV-1a, 64 bit
+static constexpr uint64_t kOffsetBasis = 0xcbf29ce484222325;
+static constexpr uint64_t kPrime = 0x100000001b3;
+
+Fingerprint::Fingerprint(KnownParams& substitution)
+    : hash_{kOffsetBasis}, substitution_{substitution} {
+}
+
+//////////////////////////////////////////////////////////////////////
+
+std::string Fingerprint::Compute(FunDeclStatement* definition) {
+  Mix(qbe::kIrCacheVersion);
+
+  Mix(definition->GetName());
+  MixType(definition->type_);
+
+  MixSymbol(definition->layer_->RetrieveSymbol(definition->GetName()));
+
+  for (auto& formal : definition->formals_) {
+    Mix(formal);
+  }
+
+  definition->body_->Accept(this);
+
+  return fmt::format("{}.{:016x}", definition->GetName(), hash_);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::Mix(uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    hash_ ^= (value >> (i * 8)) & 0xff;
+    hash_ *= kPrime;
+  }
+}
+
+void Fingerprint::Mix(std::string_view str) {
+  Mix(str.size());
+  for (unsigned char c : str) {
+    hash_ ^= c;
+    hash_ *= kPrime;
+  }
+}
+
+void Fingerprint::Mix(const lex::Token& token) {
+  Mix((uint64_t)token.type);
+  Mix(token.sem_info.index());
+
+  if (auto str = std::get_if<std::string_view>(&token.sem_info)) {
+    Mix(*str);
+  } else if (auto num = std::get_if<uint64_t>(&token.sem_info)) {
+    Mix(*num);
+  }
+}
+
+void Fingerprint::Mix(Attribute* attrs) {
+  for (; attrs; attrs = attrs->next) {
+    Mix(attrs->value);
+  }
+  Mix(uint64_t{0});
+}
+
+void Fingerprint::MixSymbol(ast::scope::Symbol* symbol) {
+  if (!symbol) {
+    Mix(uint64_t{0});
+    return;
+  }
+
+  Mix((uint64_t)symbol->sym_type + 1);
+
+  if (symbol->sym_type == ast::scope::SymbolType::FUN ||
+      symbol->sym_type == ast::scope::SymbolType::TRAIT_METHOD) {
+    Mix(symbol->as_fn_sym.attrs);
+
+    // Functions without a body return aggregates by the C ABI
+    auto def = symbol->as_fn_sym.def;
+    Mix(uint64_t{def && def->body_});
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::MixMembers(std::vector<Member>& members) {
+  Mix(members.size());
+  for (auto& mem : members) {
+    Mix(mem.field);
+    MixType(mem.ty);
+  }
+}
+
+void Fingerprint::MixType(Type* ty) {
+  if (!ty) {
+    Mix(uint64_t{0});
+    return;
+  }
+
+  ty = FindLeader(ty);
+
+  if (ty->tag == TypeTag::TY_PARAMETER && substitution_.contains(ty)) {
+    return MixType(substitution_.at(ty));
+  }
+
+  Mix((uint64_t)ty->tag + 1);
+
+  switch (ty->tag) {
+    case TypeTag::TY_PTR:
+      MixType(ty->as_ptr.underlying);
+      break;
+
+    case TypeTag::TY_ARRAY:
+      Mix(ty->as_array.length);
+      MixType(ty->as_array.element);
+      break;
+
+    case TypeTag::TY_STRUCT:
+      MixMembers(ty->as_struct.first);
+      Mix(ty->as_struct.repr_c);
+      break;
+
+    case TypeTag::TY_SUM:
+      MixMembers(ty->as_sum.first);
+      break;
+
+    case TypeTag::TY_FUN:
+      Mix(ty->as_fun.param_pack.size());
+      for (auto param : ty->as_fun.param_pack) {
+        MixType(param);
+      }
+      MixType(ty->as_fun.result_type);
+      break;
+
+    case TypeTag::TY_APP: {
+      // The name and the arguments are enough to tell applications
+      //   apart, but the layout (and so the IR) also depends on
+      //   the body of the type constructor. Hash it once per
+      //   application, which also ends the recursion for `List`.
+
+      auto outer = hash_;
+      hash_ = kOffsetBasis;
+
+      Mix(ty->as_tyapp.name.GetName());
+      for (auto param : ty->as_tyapp.param_pack) {
+        MixType(param);
+      }
+
+      auto app = hash_;
+
+      if (!expanded_.contains(app)) {
+        expanded_.insert({app, app});
+        MixType(TypeStorage(ty));
+        expanded_.insert_or_assign(app, hash_);
+      }
+
+      hash_ = outer;
+      Mix(expanded_.at(app));
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::VisitYield(YieldStatement* node) {
+  Mix("yield");
+  JustWalk::VisitYield(node);
+}
+
+void Fingerprint::VisitReturn(ReturnStatement* node) {
+  Mix("return");
+  JustWalk::VisitReturn(node);
+}
+
+void Fingerprint::VisitAssignment(AssignmentStatement* node) {
+  Mix("assign");
+  JustWalk::VisitAssignment(node);
+}
+
+void Fingerprint::VisitExprStatement(ExprStatement* node) {
+  Mix("expr");
+  JustWalk::VisitExprStatement(node);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::VisitVarDecl(VarDeclStatement* node) {
+  Mix("var");
+  Mix(node->GetName());
+  JustWalk::VisitVarDecl(node);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::VisitBindingPat(BindingPattern* node) {
+  Mix("binding");
+  Mix(node->name_);
+  MixType(node->type_);
+}
+
+void Fingerprint::VisitDiscardingPat(DiscardingPattern*) {
+  Mix("discard");
+}
+
+void Fingerprint::VisitLiteralPat(LiteralPattern* node) {
+  Mix("literal-pat");
+  JustWalk::VisitLiteralPat(node);
+}
+
+void Fingerprint::VisitVariantPat(VariantPattern* node) {
+  Mix("variant");
+  Mix(node->name_);
+  MixType(node->type_);
+  Mix(node->inner_pat_ != nullptr);
+  JustWalk::VisitVariantPat(node);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Fingerprint::VisitComparison(ComparisonExpression* node) {
+  Mix("compare");
+  Mix(node->operator_);
+  MixType(node->left_->GetType());
+  JustWalk::VisitComparison(node);
+}
+
+void Fingerprint::VisitBinary(BinaryExpression* node) {
+  Mix("binary");
+  Mix(node->operator_);
+  Mix(node->indexing_);
+  MixType(node->type_);
+  JustWalk::VisitBinary(node);
+}
+
+void Fingerprint::VisitUnary(UnaryExpression* node) {
+  Mix("unary");
+  Mix(node->operator_);
+  JustWalk::VisitUnary(node);
+}
+
+void Fingerprint::VisitDeref(DereferenceExpression* node) {
+  Mix("deref");
+  MixType(node->type_);
+  JustWalk::VisitDeref(node);
+}
+
+void Fingerprint::VisitAddressof(AddressofExpression* node) {
+  Mix("addressof");
+  MixType(node->type_);
+  JustWalk::VisitAddressof(node);
+}
+
+void Fingerprint::VisitIf(IfExpression* node) {
+  Mix("if");
+  MixType(node->type_);
+  JustWalk::VisitIf(node);
+}
+
+void Fingerprint::VisitFor(ForExpression* node) {
+  Mix("for");
+  JustWalk::VisitFor(node);
+}
+
+void Fingerprint::VisitMatch(MatchExpression* node) {
+  Mix("match");
+  MixType(node->type_);
+  Mix(node->patterns_.size());
+
+  // The location ends up in the message of the abort
+  Mix(node->GetLocation().Format());
+
+  JustWalk::VisitMatch(node);
+}
+
+void Fingerprint::VisitNew(NewExpression* node) {
+  Mix("new");
+  MixType(node->underlying_);
+  Mix(node->allocation_size_ != nullptr);
+  Mix(node->initial_value_ != nullptr);
+  JustWalk::VisitNew(node);
+}
+
+void Fingerprint::VisitBlock(BlockExpression* node) {
+  Mix("block");
+  Mix(node->stmts_.size());
+  Mix(node->final_ != nullptr);
+  JustWalk::VisitBlock(node);
+}
+
+void Fingerprint::VisitFnCall(FnCallExpression* node) {
+  Mix("call");
+  Mix(node->GetFunctionName());
+  Mix(node->arguments_.size());
+  MixType(node->callable_type_);
+
+  // Decides between a call through a pointer and a mangled global
+  MixSymbol(node->layer_->RetrieveSymbol(node->GetFunctionName()));
+
+  JustWalk::VisitFnCall(node);
+
+  calls_.push_back(node);
+}
+
+void Fingerprint::VisitIntrinsic(IntrinsicCall* node) {
+  Mix("intrinsic");
+  Mix((uint64_t)node->intrinsic);
+  Mix(node->arguments_.size());
+
+  // For the abort message of `assert`
+  Mix(node->GetLocation().Format());
+
+  for (auto arg : node->arguments_) {
+    MixType(arg->GetType());
+  }
+
+  JustWalk::VisitIntrinsic(node);
+}
+
+void Fingerprint::VisitCompoundInitalizer(CompoundInitializerExpr* node) {
+  Mix("compound");
+  MixType(node->type_);
+  Mix(node->array_);
+  Mix(node->repeat_.has_value());
+  Mix(node->ArrayLength());
+
+  for (auto& mem : node->initializers_) {
+    Mix(mem.field);
+    Mix(mem.init != nullptr);
+  }
+
+  JustWalk::VisitCompoundInitalizer(node);
+}
+
+void Fingerprint::VisitFieldAccess(FieldAccessExpression* node) {
+  Mix("field");
+  Mix(node->field_name_);
+  MixType(node->type_);
+  MixType(node->struct_expression_->GetType());
+  JustWalk::VisitFieldAccess(node);
+}
+
+void Fingerprint::VisitVarAccess(VarAccessExpression* node) {
+  Mix("var-access");
+  Mix(node->name_);
+  MixType(node->type_);
+}
+
+void Fingerprint::VisitLiteral(LiteralExpression* node) {
+  Mix("literal");
+  Mix(node->token_);
+  MixType(node->type_);
+}
+
+void Fingerprint::VisitTypecast(TypecastExpression* node) {
+  Mix("cast");
+  MixType(node->type_);
+  MixType(node->expr_->GetType());
+  JustWalk::VisitTypecast(node);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace types::instantiate
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <types/type.hpp>
+
+#include <ast/visitors/just_walk_visitor.hpp>
+#include <ast/expressions.hpp>
+
+#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace types::instantiate {
+
+// Hashes everything about a monomorphised function that can
+//   change the IR emitted for it: the definition itself, the
+//   substituted types (expanded down to their fields, since
+//   the layout depends on them) and the callees' mangled names.
+// Two instantiations with equal fingerprints, reaching functions
+//   with equal fingerprints (their bodies are inlined), emit equal
+//   QBE text, so together they are the IR cache key.
+
+class Fingerprint : public JustWalk {
+ public:
+  Fingerprint(KnownParams& substitution);
+
+  std::string Compute(FunDeclStatement* definition);
+
+  // Calls met in the body, in the order the instantiator meets them
+  auto Calls() -> std::vector<FnCallExpression*>& {
+    return calls_;
+  }
+
+  // Statements
+
+  void VisitYield(YieldStatement* node) override;
+  void VisitReturn(ReturnStatement* node) override;
+  void VisitAssignment(AssignmentStatement* node) override;
+  void VisitExprStatement(ExprStatement* node) override;
+
+  // Declarations
+
+  void VisitVarDecl(VarDeclStatement* node) override;
+
+  // Patterns
+
+  void VisitBindingPat(BindingPattern* node) override;
+  void VisitDiscardingPat(DiscardingPattern* node) override;
+  void VisitLiteralPat(LiteralPattern* node) override;
+  void VisitVariantPat(VariantPattern* node) override;
+
+  // Expressions
+
+  void VisitComparison(ComparisonExpression* node) override;
+  void VisitBinary(BinaryExpression* node) override;
+  void VisitUnary(UnaryExpression* node) override;
+  void VisitDeref(DereferenceExpression* node) override;
+  void VisitAddressof(AddressofExpression* node) override;
+  void VisitIf(IfExpression* node) override;
+  void VisitFor(ForExpression* node) override;
+  void VisitMatch(MatchExpression* node) override;
+  void VisitNew(NewExpression* node) override;
+  void VisitBlock(BlockExpression* node) override;
+  void VisitFnCall(FnCallExpression* node) override;
+  void VisitIntrinsic(IntrinsicCall* node) override;
+  void VisitCompoundInitalizer(CompoundInitializerExpr* node) override;
+  void VisitFieldAccess(FieldAccessExpression* node) override;
+  void VisitVarAccess(VarAccessExpression* node) override;
+  void VisitLiteral(LiteralExpression* node) override;
+  void VisitTypecast(TypecastExpression* node) override;
+
+ private:
+  void Mix(uint64_t value);
+  void Mix(std::string_view str);
+  void Mix(const lex::Token& token);
+  void Mix(Attribute* attrs);
+  void MixSymbol(ast::scope::Symbol* symbol);
+
+  void MixType(Type* ty);
+  void MixMembers(std::vector<Member>& members);
+
+ private:
+  uint64_t hash_;
+
+  KnownParams& substitution_;
+
+  // Expanded type applications, keyed by the hash of the application.
+  //   Breaks the cycles of recursive types like `List`.
+  std::unordered_map<uint64_t, uint64_t> expanded_;
+
+  std::vector<FnCallExpression*> calls_;
+};
+
+}  // namespace types::instantiate
@@ -1,11 +1,16 @@
 #include <types/instantiate/instantiator.hpp>
+#include <types/instantiate/fingerprint.hpp>
 #include <types/constraints/solver.hpp>
 
+#include <qbe/ir_cache.hpp>
+
 #include <ast/patterns.hpp>
 #include <ast/error_at_location.hpp>
 
 #include <lex/token.hpp>
 
+#include <log/log.hpp>
+
 #include <cassert>
 
 
@@ -18,12 +23,12 @@ FunDeclStatement* TemplateInstantiator::FindTraitMethod(
   for (auto& impl : symbol->as_fn_sym.trait->impls_) {
     for (auto& def : impl->trait_methods_) {
       if (def->GetName() == symbol->name) {
-        fmt::print(stderr, "Searching method {} for {}\n", symbol->name,
-                   impl->for_type_->Format());
+        ETC_LOG(TRACE, "Searching method {} for {}", symbol->name,
+                impl->for_type_->Format());
         current_substitution_.clear();
         if (BuildSubstitution(def->type_, mono, current_substitution_)) {
-          fmt::print(stderr, "Substitution suffices\n");
-          fmt::print(stderr, "Type: {}\n", def->type_->Format());
+          ETC_LOG(TRACE, "Substitution suffices, type {}",
+                  def->type_->Format());
 
           return def;
         }
@@ -61,12 +66,83 @@ bool TemplateInstantiator::TryFindInstantiation(FnCallExpression* i) {
 
 void TemplateInstantiator::StartUp(FunDeclStatement* main) {
   call_context_ = main->layer_;
-  auto main_fn = Eval(main)->as<FunDeclStatement>();
+  auto main_fn = Instantiate(main);
   mono_items_.insert({main_fn->name_, main_fn});
 }
 
 //////////////////////////////////////////////////////////////////////
 
+FunDeclStatement* TemplateInstantiator::Instantiate(
+    FunDeclStatement* definition) {
+  if (!cache_ || !definition->body_) {
+    return Eval(definition)->as<FunDeclStatement>();
+  }
+
+  Fingerprint fingerprint{current_substitution_};
+  auto key = fingerprint.Compute(definition);
+
+  if (!cache_->Knows(key)) {
+    auto mono_fun = Eval(definition)->as<FunDeclStatement>();
+    mono_fun->cache_key_ = std::move(key);
+    return mono_fun;
+  }
+
+  // Whether it is a hit also depends on the callees (see
+  //   IrEmitter::LookUpCache), until then the body stays polymorphic
+
+  auto mono_fun = new FunDeclStatement{*definition};
+  mono_fun->type_ = Instantinate(mono_fun->type_, current_substitution_);
+  mono_fun->cache_key_ = std::move(key);
+  mono_fun->deferred_ = true;
+
+  // But what it calls still has to be instantiated
+
+  for (auto call : fingerprint.Calls()) {
+    mono_fun->deferred_calls_.push_back(EnqueueCachedCall(call));
+  }
+
+  deferred_.insert({mono_fun, current_substitution_});
+
+  return mono_fun;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Same as VisitFnCall, minus cloning the arguments
+FnCallExpression* TemplateInstantiator::EnqueueCachedCall(
+    FnCallExpression* node) {
+  auto n = new FnCallExpression{*node};
+
+  for (auto& a : n->arguments_) {
+    MaybeSaveForIL(Instantinate(a->GetType(), current_substitution_));
+  }
+
+  n->callable_type_ = Instantinate(node->callable_type_, current_substitution_);
+
+  MaybeSaveForIL(n->GetType());
+
+  instantiation_quque_.push_back(n);
+
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TemplateInstantiator::InstantiateBody(FunDeclStatement* mono_fun) {
+  auto it = deferred_.find(mono_fun);
+  std::swap(current_substitution_, it->second);
+
+  mono_fun->body_ = Eval(mono_fun->body_)->as<Expression>();
+  mono_fun->deferred_ = false;
+
+  deferred_.erase(it);
+
+  // The callees were instantiated along with the signature
+  instantiation_quque_.clear();
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void TemplateInstantiator::ProcessQueueItem(FnCallExpression* i) {
   // 1) Check not already instantiated
 
@@ -85,8 +161,8 @@ void TemplateInstantiator::ProcessQueueItem(FnCallExpression* i) {
   auto poly = symbol->GetType();
   auto mono = i->callable_type_;
 
-  fmt::print(stderr, "[!] Poly {}\n", FormatType(*poly));
-  fmt::print(stderr, "[!] Mono {}\n", FormatType(*mono));
+  ETC_LOG(TRACE, "Poly {}", FormatType(*poly));
+  ETC_LOG(TRACE, "Mono {}", FormatType(*mono));
 
   call_context_ = i->layer_;
 
@@ -100,9 +176,9 @@ void TemplateInstantiator::ProcessQueueItem(FnCallExpression* i) {
     }
   }();
 
-  // 4) Evaluate
+  // 4) Evaluate (or reuse the IR of the previous build)
 
-  auto mono_fun = Eval(definition)->as<FunDeclStatement>();
+  auto mono_fun = Instantiate(definition);
 
   // 5) Save result
   if (mono_fun->body_) {
@@ -122,10 +198,12 @@ void TemplateInstantiator::ProcessQueue() {
 
 //////////////////////////////////////////////////////////////////////
 
-TemplateInstantiator::TemplateInstantiator(Declaration* main) {
+TemplateInstantiator::TemplateInstantiator(Declaration* main,
+                                           qbe::IrCache* cache)
+    : cache_{cache} {
   StartUp(main->as<FunDeclStatement>());
 
-  fmt::print(stderr, "Finished processing main\n");
+  ETC_LOG(DEBUG, "Finished processing main");
 
   ProcessQueue();
 }
@@ -134,12 +212,13 @@ TemplateInstantiator::TemplateInstantiator(Declaration* main) {
 
 using Tests = std::vector<FunDeclStatement*>;
 
-TemplateInstantiator::TemplateInstantiator(Tests& tests) {
+TemplateInstantiator::TemplateInstantiator(Tests& tests, qbe::IrCache* cache)
+    : cache_{cache} {
   for (auto& test : tests) {
     StartUp(test->as<FunDeclStatement>());
   }
 
-  fmt::print(stderr, "Finished processing tests n");
+  ETC_LOG(DEBUG, "Finished processing tests");
 
   ProcessQueue();
 }
@@ -152,8 +231,8 @@ auto TemplateInstantiator::Flush() -> Result {
   std::vector<FunDeclStatement*> result;
 
   for (auto& mono : mono_items_) {
-    fmt::print(stderr, "name: {} type: {}\n",  //
-               mono.second->GetName(), FormatType(*mono.second->type_));
+    ETC_LOG(DEBUG, "Instantiated {} of type {}",  //
+            mono.second->GetName(), FormatType(*mono.second->type_));
 
     result.push_back(mono.second);
   }
@@ -180,6 +259,11 @@ bool TemplateInstantiator::BuildSubstitution(Type* poly, Type* mono,
       return BuildSubstitution(poly->as_ptr.underlying, mono->as_ptr.underlying,
                                poly_to_mono);
 
+    case TypeTag::TY_ARRAY:
+      return poly->as_array.length == mono->as_array.length &&
+             BuildSubstitution(poly->as_array.element,
+                               mono->as_array.element, poly_to_mono);
+
     case TypeTag::TY_STRUCT: {
       auto& a_mem = poly->as_struct.first;
       auto& b_mem = mono->as_struct.first;
@@ -266,7 +350,8 @@ bool TemplateInstantiator::BuildSubstitution(Type* poly, Type* mono,
 void TemplateInstantiator::MaybeSaveForIL(Type* ty) {
   CheckTypes();
 
-  if (ty->tag != TypeTag::TY_APP && ty->tag != TypeTag::TY_STRUCT) {
+  if (ty->tag != TypeTag::TY_APP && ty->tag != TypeTag::TY_STRUCT &&
+      ty->tag != TypeTag::TY_ARRAY) {
     return;
   }
 
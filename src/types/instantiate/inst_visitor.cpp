@@ -2,9 +2,12 @@
 #include <types/constraints/solver.hpp>
 
 #include <ast/patterns.hpp>
+#include <ast/error_at_location.hpp>
 
 #include <lex/token.hpp>
 
+#include <log/log.hpp>
+
 namespace types::instantiate {
 
 //////////////////////////////////////////////////////////////////////
@@ -146,7 +149,8 @@ void TemplateInstantiator::VisitBinary(BinaryExpression* node) {
   n->left_ = Eval(n->left_)->as<Expression>();
   n->right_ = Eval(n->right_)->as<Expression>();
 
-  n->type_ = n->left_->GetType();
+  n->type_ = n->indexing_ ? Instantinate(n->type_, current_substitution_)
+                          : n->left_->GetType();
 
   return_value = n;
 }
@@ -200,6 +204,17 @@ void TemplateInstantiator::VisitIf(IfExpression* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void TemplateInstantiator::VisitFor(ForExpression* node) {
+  auto n = new ForExpression{*node};
+
+  n->condition_ = Eval(n->condition_)->as<Expression>();
+  n->body_ = Eval(n->body_)->as<Expression>();
+
+  return_value = n;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void TemplateInstantiator::VisitMatch(MatchExpression* node) {
   auto n = new MatchExpression{*node};
 
@@ -264,8 +279,8 @@ void TemplateInstantiator::VisitFnCall(FnCallExpression* node) {
 
   MaybeSaveForIL(n->GetType());
 
-  fmt::print(stderr, "{}\n", FormatType(*n->callable_type_));
-  fmt::print(stderr, "Adding a node to the queue\n");
+  ETC_LOG(TRACE, "Queued {} of type {}", n->GetFunctionName(),
+          FormatType(*n->callable_type_));
 
   instantiation_quque_.push_back(n);
 
@@ -307,9 +322,35 @@ void TemplateInstantiator::VisitFieldAccess(FieldAccessExpression* node) {
 
   n->type_ = Instantinate(node->type_, current_substitution_);
 
+  CheckArrayField(n);
+
   return_value = n;
 }
 
+// `s->items[i]` in a function generic over `s` takes `items` for
+//   a pointer (see ConstraintSolver::DefaultTraits)
+void TemplateInstantiator::CheckArrayField(FieldAccessExpression* node) {
+  auto storage = TypeStorage(node->struct_expression_->GetType());
+
+  if (storage->tag != TypeTag::TY_STRUCT) {
+    return;
+  }
+
+  for (auto& member : storage->as_struct.first) {
+    if (member.field != node->field_name_.GetName()) {
+      continue;
+    }
+
+    if (TypeStorage(member.ty)->tag == TypeTag::TY_ARRAY &&
+        TypeStorage(node->GetType())->tag != TypeTag::TY_ARRAY) {
+      throw ErrorAtLocation(
+          node->GetLocation(),
+          fmt::format("Field {} is an array, annotate the function",
+                      member.field));
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////
 
 void TemplateInstantiator::VisitVarAccess(VarAccessExpression* node) {
@@ -335,6 +376,7 @@ void TemplateInstantiator::VisitLiteral(LiteralExpression* node) {
 void TemplateInstantiator::VisitTypecast(TypecastExpression* node) {
   auto n = new TypecastExpression{*node};
 
+  n->expr_ = Eval(n->expr_)->as<Expression>();
   n->type_ = Instantinate(node->type_, current_substitution_);
 
   return_value = n;
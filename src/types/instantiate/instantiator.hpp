@@ -9,16 +9,24 @@
 
 #include <queue>
 
+namespace qbe {
+class IrCache;
+}
+
 namespace types::instantiate {
 
 class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
  public:
-  TemplateInstantiator(Declaration* main);
+  TemplateInstantiator(Declaration* main, qbe::IrCache* cache = nullptr);
 
-  TemplateInstantiator(std::vector<FunDeclStatement*>& tests);
+  TemplateInstantiator(std::vector<FunDeclStatement*>& tests,
+                       qbe::IrCache* cache = nullptr);
 
   auto Flush() -> std::pair<std::vector<FunDeclStatement*>, std::vector<Type*>>;
 
+  // Clones the body of a function left polymorphic for the IR cache
+  void InstantiateBody(FunDeclStatement* mono_fun);
+
   // Visitor methods
 
   void VisitYield(YieldStatement* node) override;
@@ -43,6 +51,7 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitFor(ForExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -69,7 +78,12 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
 
   void StartUp(FunDeclStatement* main);
 
+  FunDeclStatement* Instantiate(FunDeclStatement* definition);
+
+  FnCallExpression* EnqueueCachedCall(FnCallExpression* node);
+
   void MaybeSaveForIL(Type* ty);
+  void CheckArrayField(FieldAccessExpression* node);
 
   void ProcessQueue();
 
@@ -87,6 +101,11 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
   // A: place instantiated in map: name: string_view -> [](type, fun)
 
   std::unordered_multimap<std::string_view, FunDeclStatement*> mono_items_;
+
+  // IR of the previous builds, the bodies of likely hits are not cloned
+  qbe::IrCache* cache_ = nullptr;
+
+  std::unordered_map<FunDeclStatement*, Substitiution> deferred_;
 };
 
 }  // namespace types::instantiate
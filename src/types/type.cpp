@@ -15,8 +15,17 @@ namespace types {
 //   doing job.
 static Type::Arena type_store{};
 
+// Types before this one were checked by an earlier compilation
+//   (see MarkTypesChecked), their contexts may be gone since
+static size_t first_unchecked = 0;
+
 void ClearTypeStorage() {
   type_store.clear();
+  first_unchecked = 0;
+}
+
+size_t TypeStorageSize() {
+  return type_store.size();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -110,6 +119,11 @@ bool TypesEquivalent(Type* lhs, Type* rhs,
       return TypesEquivalent(lhs->as_ptr.underlying, rhs->as_ptr.underlying,
                              map);
 
+    case TypeTag::TY_ARRAY:
+      return lhs->as_array.length == rhs->as_array.length &&
+             TypesEquivalent(lhs->as_array.element, rhs->as_array.element,
+                             map);
+
     case TypeTag::TY_STRUCT:
       return EqStr(&lhs->as_struct, &rhs->as_struct);
 
@@ -132,6 +146,12 @@ bool TypesEquivalent(Type* lhs, Type* rhs,
       return true;
 
     case TypeTag::TY_INT:
+    case TypeTag::TY_I64:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -147,9 +167,14 @@ bool TypesEquivalent(Type* lhs, Type* rhs,
 
 //////////////////////////////////////////////////////////////////////
 
+void MarkTypesChecked() {
+  first_unchecked = type_store.size();
+}
+
 void CheckTypes() {
   auto& store = type_store;
-  for (auto& t : store) {
+  for (size_t i = first_unchecked; i < store.size(); i++) {
+    auto& t = store[i];
     if (t.tag == TypeTag::TY_APP) {
       if (!t.typing_context_) {
         fmt::print(stderr, "id:{} \t context:{:<20} \t\t\t type:{} \n", t.id,
@@ -227,6 +252,16 @@ Type* MakeTypePtr(Type* underlying) {
 
 //////////////////////////////////////////////////////////////////////
 
+Type* MakeArrayType(Type* element, size_t length) {
+  type_store.push_back(
+      Type{.id = type_store.size(),
+           .tag = TypeTag::TY_ARRAY,
+           .as_array = {.element = element, .length = length}});
+  return &type_store.back();
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Type* MakeFunType(std::vector<Type*> param_pack, Type* result_type) {
   type_store.push_back(
       Type{.id = type_store.size(),
@@ -278,6 +313,10 @@ void SetTyContext(types::Type* ty, ast::scope::Context* typing_context) {
       SetTyContext(ty->as_ptr.underlying, typing_context);
       break;
 
+    case TypeTag::TY_ARRAY:
+      SetTyContext(ty->as_array.element, typing_context);
+      break;
+
     case TypeTag::TY_STRUCT:
       for (auto& member : ty->as_struct.first) {
         SetTyContext(member.ty, typing_context);
@@ -343,6 +382,15 @@ Type* SubstituteParameters(Type* subs, const Map& map) {
       return ptr;
     }
 
+    case TypeTag::TY_ARRAY: {
+      auto element = SubstituteParameters(subs->as_array.element, map);
+
+      auto array = MakeArrayType(element, subs->as_array.length);
+      array->typing_context_ = subs->typing_context_;
+
+      return array;
+    }
+
     case TypeTag::TY_STRUCT: {
       std::vector<Member> result;
       auto& pack = subs->as_struct.first;
@@ -353,6 +401,7 @@ Type* SubstituteParameters(Type* subs, const Map& map) {
       }
 
       auto ty = MakeStructType(std::move(result));
+      ty->as_struct.repr_c = subs->as_struct.repr_c;
       ty->typing_context_ = subs->typing_context_;
 
       return ty;
@@ -419,6 +468,12 @@ Type* SubstituteParameters(Type* subs, const Map& map) {
       std::abort();
 
     case TypeTag::TY_INT:
+    case TypeTag::TY_I64:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -470,6 +525,21 @@ Type* TypeStorage(Type* t) {
   return t;
 }
 
+bool IsInteger(Type* ty) {
+  auto tag = FindLeader(ty)->tag;
+  return tag >= TypeTag::TY_INT && tag <= TypeTag::TY_U64;
+}
+
+bool IsUnsigned(Type* ty) {
+  auto tag = FindLeader(ty)->tag;
+  return tag >= TypeTag::TY_U8 && tag <= TypeTag::TY_U64;
+}
+
+bool IsFloat(Type* ty) {
+  auto tag = FindLeader(ty)->tag;
+  return tag == TypeTag::TY_F32 || tag == TypeTag::TY_F64;
+}
+
 //////////////////////////////////////////////////////////////////////
 
 // Ty here is a type schema
@@ -487,6 +557,13 @@ Type* Instantinate(Type* ty, KnownParams& map) {
       return ptr;
     }
 
+    case TypeTag::TY_ARRAY: {
+      auto i = Instantinate(l->as_array.element, map);
+      auto array = MakeArrayType(i, l->as_array.length);
+      array->typing_context_ = l->typing_context_;
+      return array;
+    }
+
     case TypeTag::TY_PARAMETER:
       if (map.contains(l)) {
         return map.at(l);
@@ -537,6 +614,7 @@ Type* Instantinate(Type* ty, KnownParams& map) {
       }
 
       auto ty = MakeStructType(std::move(args));
+      ty->as_struct.repr_c = l->as_struct.repr_c;
       ty->typing_context_ = l->typing_context_;
       return ty;
     }
@@ -16,6 +16,7 @@
 namespace types {
 
 void ClearTypeStorage();
+size_t TypeStorageSize();
 
 
 struct Type;
@@ -24,6 +25,12 @@ struct Type;
 
 enum class TypeTag {
   TY_INT,
+  TY_I64,
+  TY_U8,
+  TY_U32,
+  TY_U64,
+  TY_F32,
+  TY_F64,
   TY_BOOL,
   TY_CHAR,
   TY_UNIT,
@@ -32,6 +39,7 @@ enum class TypeTag {
   TY_BUILTIN,
 
   TY_PTR,
+  TY_ARRAY,  // [N]T, stored inline
   TY_SUM,
   TY_UNION,
   TY_STRUCT,
@@ -63,6 +71,9 @@ struct Member {
 // This is also plain union type
 struct StructTy {
   std::vector<Member> first;
+
+  // `@repr(C)`: fields stay in the declaration order
+  bool repr_c = false;
 };
 
 struct SumType {
@@ -73,6 +84,11 @@ struct PtrType {
   Type* underlying;
 };
 
+struct ArrayType {
+  Type* element;
+  size_t length;
+};
+
 struct FunType {
   std::vector<Type*> param_pack;
   Type* result_type;
@@ -102,6 +118,12 @@ struct QualifiedGeneric {
 //////////////////////////////////////////////////////////////////////
 
 extern Type builtin_int;
+extern Type builtin_i64;
+extern Type builtin_u8;
+extern Type builtin_u32;
+extern Type builtin_u64;
+extern Type builtin_f32;
+extern Type builtin_f64;
 extern Type builtin_bool;
 extern Type builtin_char;
 extern Type builtin_unit;
@@ -128,6 +150,7 @@ struct Type {
   ast::scope::Context* typing_context_ = nullptr;
 
   PtrType as_ptr{};
+  ArrayType as_array{};
   FunType as_fun{};
   SumType as_sum{};
   StructTy as_struct{};
@@ -143,12 +166,14 @@ struct Type {
 //////////////////////////////////////////////////////////////////////
 
 void CheckTypes();
+void MarkTypesChecked();
 
 Type* HintedOrNew(Type*);
 Type* MakeTypeVar();
 Type* MakeTypeVar(ast::scope::Context* ty_cons);
 
 Type* MakeTypePtr(Type* underlying);
+Type* MakeArrayType(Type* element, size_t length);
 Type* MakeFunType(std::vector<Type*> param_pack, Type* result_type);
 Type* MakeTyApp(lex::Token name, std::vector<Type*> param_pack);
 Type* MakeTyCons(lex::Token name, std::vector<lex::Token> params, Type* body,
@@ -171,6 +196,13 @@ std::string FormatFun(Type& type);
 
 Type* FindLeader(Type* ty);
 Type* TypeStorage(Type* ty);
+
+// Int, I64, U8, U32 or U64
+bool IsInteger(Type* ty);
+bool IsUnsigned(Type* ty);
+
+// F32 or F64
+bool IsFloat(Type* ty);
 Type* ApplyTyconsLazy(Type* ty);
 
 using KnownParams = std::unordered_map<Type*, Type*>;
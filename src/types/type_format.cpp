@@ -79,6 +79,13 @@ std::string FormatPtr(Type& type) {
 
 //////////////////////////////////////////////////////////////////////
 
+std::string FormatArray(Type& type) {
+  return fmt::format("[{}]{}", type.as_array.length,
+                     FormatType(*type.as_array.element));
+}
+
+//////////////////////////////////////////////////////////////////////
+
 std::string FormatUnion(Type&) {
   return fmt::format("union {{ <unimplemented> }}");
 }
@@ -100,6 +107,18 @@ std::string FormatTypeInner(Type& type) {
       return fmt::format("*");
     case TypeTag::TY_INT:
       return fmt::format("Int");
+    case TypeTag::TY_I64:
+      return fmt::format("I64");
+    case TypeTag::TY_U8:
+      return fmt::format("U8");
+    case TypeTag::TY_U32:
+      return fmt::format("U32");
+    case TypeTag::TY_U64:
+      return fmt::format("U64");
+    case TypeTag::TY_F32:
+      return fmt::format("F32");
+    case TypeTag::TY_F64:
+      return fmt::format("F64");
     case TypeTag::TY_BOOL:
       return fmt::format("Bool");
     case TypeTag::TY_CHAR:
@@ -111,6 +130,8 @@ std::string FormatTypeInner(Type& type) {
 
     case TypeTag::TY_PTR:
       return FormatPtr(type);
+    case TypeTag::TY_ARRAY:
+      return FormatArray(type);
     case TypeTag::TY_UNION:
       return FormatUnion(type);
     case TypeTag::TY_SUM:
@@ -172,6 +193,18 @@ std::string Mangle(Type& type) {
   switch (type.tag) {
     case TypeTag::TY_INT:
       return fmt::format("i");
+    case TypeTag::TY_I64:
+      return fmt::format("x");
+    case TypeTag::TY_U8:
+      return fmt::format("h");
+    case TypeTag::TY_U32:
+      return fmt::format("j");
+    case TypeTag::TY_U64:
+      return fmt::format("y");
+    case TypeTag::TY_F32:
+      return fmt::format("f");
+    case TypeTag::TY_F64:
+      return fmt::format("d");
     case TypeTag::TY_BOOL:
       return fmt::format("b");
     case TypeTag::TY_CHAR:
@@ -181,6 +214,9 @@ std::string Mangle(Type& type) {
 
     case TypeTag::TY_PTR:
       return "P" + Mangle(*type.as_ptr.underlying);
+    case TypeTag::TY_ARRAY:
+      return fmt::format("A{}", type.as_array.length) +
+             Mangle(*type.as_array.element);
     case TypeTag::TY_FUN:
       return MangleFun(type);
     case TypeTag::TY_APP:
@@ -0,0 +1,737 @@
+#include <vm/assembler.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+namespace vm {
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Splits a line of QBE into words, punctuation and string literals,
+//   dropping the comments
+std::vector<std::string_view> Tokenize(std::string_view line) {
+  std::vector<std::string_view> tokens;
+  constexpr std::string_view kPunct = "=,(){}+";
+
+  size_t i = 0;
+
+  while (i < line.size()) {
+    auto ch = line[i];
+
+    if (ch == ' ' || ch == '\t' || ch == '\r') {
+      i += 1;
+      continue;
+    }
+
+    if (ch == '#') {
+      break;
+    }
+
+    if (ch == '"') {
+      auto end = i + 1;
+      while (end < line.size() && line[end] != '"') {
+        end += line[end] == '\\' ? 2 : 1;
+      }
+      tokens.push_back(line.substr(i, end + 1 - i));
+      i = end + 1;
+      continue;
+    }
+
+    if (kPunct.find(ch) != kPunct.npos) {
+      tokens.push_back(line.substr(i, 1));
+      i += 1;
+      continue;
+    }
+
+    auto end = i;
+    while (end < line.size() && line[end] != ' ' && line[end] != '\t' &&
+           line[end] != '"' && kPunct.find(line[end]) == kPunct.npos) {
+      end += 1;
+    }
+    tokens.push_back(line.substr(i, end - i));
+    i = end;
+  }
+
+  return tokens;
+}
+
+size_t AlignUp(size_t offset, size_t align) {
+  return (offset + align - 1) / align * align;
+}
+
+struct Layout {
+  size_t size = 0;
+  size_t align = 1;
+};
+
+// `w` and `wl`-style binary instructions
+struct Pair {
+  Op w;
+  Op l;
+};
+
+const std::unordered_map<std::string_view, Pair> kBinary{
+    {"add", {Op::ADDW, Op::ADDL}}, {"sub", {Op::SUBW, Op::SUBL}},
+    {"mul", {Op::MULW, Op::MULL}}, {"div", {Op::DIVW, Op::DIVL}},
+    {"rem", {Op::REMW, Op::REML}}, {"and", {Op::ANDW, Op::ANDL}},
+    {"or", {Op::ORW, Op::ORL}},    {"xor", {Op::XORW, Op::XORL}},
+    {"udiv", {Op::UDIVW, Op::UDIVL}},
+};
+
+// The same for the `s` and `d` results
+struct FloatPair {
+  Op s;
+  Op d;
+};
+
+const std::unordered_map<std::string_view, FloatPair> kFloat{
+    {"add", {Op::ADDS, Op::ADDD}},       {"sub", {Op::SUBS, Op::SUBD}},
+    {"mul", {Op::MULS, Op::MULD}},       {"div", {Op::DIVS, Op::DIVD}},
+    {"neg", {Op::NEGS, Op::NEGD}},       {"swtof", {Op::SWTOFS, Op::SWTOFD}},
+    {"uwtof", {Op::UWTOFS, Op::UWTOFD}}, {"sltof", {Op::SLTOFS, Op::SLTOFD}},
+    {"ultof", {Op::ULTOFS, Op::ULTOFD}},
+};
+
+const std::unordered_map<std::string_view, Op> kFixed{
+    {"ceqw", Op::CEQW},     {"ceql", Op::CEQL},     {"cnew", Op::CNEW},
+    {"cnel", Op::CNEL},     {"csltw", Op::CSLTW},   {"csltl", Op::CSLTL},
+    {"cslew", Op::CSLEW},   {"cslel", Op::CSLEL},   {"csgtw", Op::CSGTW},
+    {"csgtl", Op::CSGTL},   {"csgew", Op::CSGEW},   {"csgel", Op::CSGEL},
+    {"cultw", Op::CULTW},   {"cultl", Op::CULTL},   {"culew", Op::CULEW},
+    {"culel", Op::CULEL},   {"cugtw", Op::CUGTW},   {"cugtl", Op::CUGTL},
+    {"cugew", Op::CUGEW},   {"cugel", Op::CUGEL},   {"extsw", Op::EXTSW},
+    {"extuw", Op::EXTUW},   {"extsh", Op::EXTSH},   {"extuh", Op::EXTUH},
+    {"extsb", Op::EXTSB},   {"extub", Op::EXTUB},   {"loadl", Op::LOADL},
+    {"loadw", Op::LOADSW},  {"loadsw", Op::LOADSW}, {"loaduw", Op::LOADUW},
+    {"loadh", Op::LOADSH},  {"loadsh", Op::LOADSH}, {"loaduh", Op::LOADUH},
+    {"loadb", Op::LOADSB},  {"loadsb", Op::LOADSB}, {"loadub", Op::LOADUB},
+    {"storel", Op::STOREL}, {"storew", Op::STOREW}, {"storeh", Op::STOREH},
+    {"storeb", Op::STOREB}, {"copy", Op::COPY},     {"ceqs", Op::CEQS},
+    {"ceqd", Op::CEQD},     {"cnes", Op::CNES},     {"cned", Op::CNED},
+    {"clts", Op::CLTS},     {"cltd", Op::CLTD},     {"cles", Op::CLES},
+    {"cled", Op::CLED},     {"cgts", Op::CGTS},     {"cgtd", Op::CGTD},
+    {"cges", Op::CGES},     {"cged", Op::CGED},     {"exts", Op::EXTS},
+    {"truncd", Op::TRUNCD}, {"stosi", Op::STOSI},   {"stoui", Op::STOUI},
+    {"dtosi", Op::DTOSI},   {"dtoui", Op::DTOUI},   {"loads", Op::LOADUW},
+    {"loadd", Op::LOADL},   {"stores", Op::STOREW}, {"stored", Op::STOREL},
+};
+
+//////////////////////////////////////////////////////////////////////
+
+struct DataDef {
+  std::string name;
+  size_t align = 8;
+  std::string bytes;
+
+  struct Reloc {
+    size_t offset;
+    std::string symbol;
+    int64_t addend;
+  };
+  std::vector<Reloc> relocs;
+};
+
+class Assembler {
+ public:
+  Program Run(std::string_view ir) {
+    std::vector<std::string_view> lines;
+
+    for (size_t start = 0; start < ir.size();) {
+      auto end = std::min(ir.find('\n', start), ir.size());
+      lines.push_back(ir.substr(start, end - start));
+      start = end + 1;
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+      auto tokens = Tokenize(lines[i]);
+
+      if (tokens.empty()) {
+        continue;
+      }
+
+      if (tokens[0] == "export") {
+        tokens.erase(tokens.begin());
+      }
+
+      if (tokens[0] == "type") {
+        ParseType(tokens);
+      } else if (tokens[0] == "data") {
+        ParseData(tokens);
+      } else if (tokens[0] == "function") {
+        i = ParseFunction(tokens, lines, i);
+      } else {
+        Fail(tokens[0]);
+      }
+    }
+
+    Link();
+    return std::move(program_);
+  }
+
+ private:
+  [[noreturn]] static void Fail(std::string_view what) {
+    throw VmError{fmt::format("Unsupported QBE: '{}'", what)};
+  }
+
+  static int64_t Number(std::string_view token) {
+    auto text = std::string{token};
+    char* end = nullptr;
+    auto value = std::strtoll(text.c_str(), &end, 10);
+
+    if (text.empty() || *end != '\0') {
+      Fail(token);
+    }
+
+    return value;
+  }
+
+  // `s_1.5` and `d_1.5` as the bits of a float or a double
+  static uint64_t FloatBits(std::string_view token) {
+    auto text = std::string{token.substr(2)};
+    char* end = nullptr;
+    auto value = std::strtod(text.c_str(), &end);
+
+    if (text.empty() || *end != '\0') {
+      Fail(token);
+    }
+
+    if (token[0] == 's') {
+      return std::bit_cast<uint32_t>(static_cast<float>(value));
+    }
+    return std::bit_cast<uint64_t>(value);
+  }
+
+  static bool IsFloat(std::string_view type) {
+    return type == "s" || type == "d";
+  }
+
+  static bool IsNumber(std::string_view token) {
+    return !token.empty() &&
+           (std::isdigit(token[0]) || (token[0] == '-' && token.size() > 1));
+  }
+
+  // Types
+
+  Layout Base(std::string_view ty) {
+    switch (ty[0]) {
+      case 'b':
+        return {1, 1};
+      case 'h':
+        return {2, 2};
+      case 'w':
+      case 's':
+        return {4, 4};
+      case 'l':
+      case 'd':
+        return {8, 8};
+      case ':': {
+        auto it = types_.find(std::string{ty.substr(1)});
+        if (it == types_.end()) {
+          Fail(ty);
+        }
+        return it->second;
+      }
+      default:
+        Fail(ty);
+    }
+  }
+
+  // type :T = align 4 { w 1, b 2, :U 1 }
+  void ParseType(const std::vector<std::string_view>& t) {
+    Layout layout;
+    size_t i = 3;
+
+    if (t.at(i) == "align") {
+      layout.align = Number(t.at(i + 1));
+      i += 2;
+    }
+
+    i += 1;  // {
+
+    // Opaque, `align 4 { 0 }`
+    if (IsNumber(t.at(i))) {
+      layout.size = Number(t[i]);
+      types_[std::string{t[1].substr(1)}] = layout;
+      return;
+    }
+
+    size_t offset = 0;
+
+    for (; t.at(i) != "}"; i++) {
+      if (t[i] == ",") {
+        continue;
+      }
+
+      auto member = Base(t[i]);
+      size_t count = 1;
+
+      if (IsNumber(t.at(i + 1))) {
+        count = Number(t[i + 1]);
+        i += 1;
+      }
+
+      offset = AlignUp(offset, member.align) + member.size * count;
+      layout.align = std::max(layout.align, member.align);
+    }
+
+    layout.size = AlignUp(offset, layout.align);
+    types_[std::string{t[1].substr(1)}] = layout;
+  }
+
+  // Data
+
+  static std::string Unescape(std::string_view raw) {
+    std::string bytes;
+
+    for (size_t i = 1; i + 1 < raw.size(); i++) {
+      if (raw[i] != '\\') {
+        bytes.push_back(raw[i]);
+        continue;
+      }
+
+      switch (raw[i += 1]) {
+        case 'n':
+          bytes.push_back('\n');
+          break;
+        case 't':
+          bytes.push_back('\t');
+          break;
+        case 'r':
+          bytes.push_back('\r');
+          break;
+        case '0':
+          bytes.push_back('\0');
+          break;
+        default:
+          bytes.push_back(raw[i]);
+      }
+    }
+
+    return bytes;
+  }
+
+  // data $x = align 8 { l $f, b "str", b 0 1 2, z 8 }
+  void ParseData(const std::vector<std::string_view>& t) {
+    DataDef data;
+    data.name = std::string{t.at(1).substr(1)};
+    size_t i = 3;
+
+    if (t.at(i) == "align") {
+      data.align = Number(t.at(i + 1));
+      i += 2;
+    }
+
+    i += 1;  // {
+
+    size_t width = 0;
+
+    for (; t.at(i) != "}"; i++) {
+      auto item = t[i];
+
+      if (item == ",") {
+        continue;
+      }
+
+      if (item == "z") {
+        data.bytes.append(Number(t.at(i += 1)), '\0');
+        continue;
+      }
+
+      if (item == "b" || item == "h" || item == "w" || item == "l") {
+        width = Base(item).size;
+        continue;
+      }
+
+      if (item[0] == '"') {
+        data.bytes += Unescape(item);
+        continue;
+      }
+
+      if (item[0] == '$') {
+        int64_t addend = 0;
+        if (t.at(i + 1) == "+") {
+          addend = Number(t.at(i + 2));
+          i += 2;
+        }
+
+        data.relocs.push_back(
+            {data.bytes.size(), std::string{item.substr(1)}, addend});
+        data.bytes.append(width, '\0');
+        continue;
+      }
+
+      auto value = static_cast<uint64_t>(Number(item));
+      for (size_t k = 0; k < width; k++) {
+        data.bytes.push_back(static_cast<char>(value >> (8 * k)));
+      }
+    }
+
+    data_.push_back(std::move(data));
+  }
+
+  // Functions
+
+  uint32_t Register(std::string_view token) {
+    if (token.empty()) {
+      Fail(token);
+    }
+
+    if (token[0] == '%') {
+      auto [it, _] = registers_.try_emplace(token, registers_.size());
+      return it->second;
+    }
+
+    // Constants are numbered apart, moved past the temporaries later
+    auto [it, inserted] = constants_.try_emplace(token, constants_.size());
+
+    if (inserted) {
+      if (token[0] == '$') {
+        function_->relocations.push_back(
+            {it->second, std::string{token.substr(1)}});
+        function_->constants.push_back(0);
+      } else if (token.starts_with("s_") || token.starts_with("d_")) {
+        function_->constants.push_back(FloatBits(token));
+      } else {
+        function_->constants.push_back(Number(token));
+      }
+    }
+
+    return it->second | kConstant;
+  }
+
+  void Emit(Op op, uint32_t dst = kNoRegister, uint32_t a = kNoRegister,
+            uint32_t b = kNoRegister, uint32_t c = kNoRegister) {
+    function_->code.push_back({.op = op, .dst = dst, .a = a, .b = b, .c = c});
+  }
+
+  void Jump(uint32_t Instr::*field, std::string_view label) {
+    jumps_.push_back({function_->code.size() - 1, field, label});
+  }
+
+  // export function w $main (w %.1, l %.2, ) {
+  size_t ParseFunction(const std::vector<std::string_view>& header,
+                       const std::vector<std::string_view>& lines,
+                       size_t line) {
+    auto& function = program_.functions.emplace_back();
+    function_ = &function;
+    registers_.clear();
+    constants_.clear();
+    labels_.clear();
+    jumps_.clear();
+
+    size_t i = 1;
+    if (header.at(i)[0] != '$') {
+      i += 1;  // Result type
+    }
+
+    function.name = std::string{header.at(i).substr(1)};
+    i += 2;  // $name (
+
+    for (; header.at(i) != ")"; i++) {
+      if (header[i] == ",") {
+        continue;
+      }
+
+      auto type = header[i];
+      Register(header.at(i += 1));
+
+      if (type[0] == ':') {
+        auto layout = Base(type);
+        function.param_copies.push_back(
+            {.reg = function.params,
+             .size = static_cast<uint32_t>(layout.size),
+             .align = static_cast<uint32_t>(layout.align)});
+      }
+
+      function.params += 1;
+    }
+
+    for (line += 1; line < lines.size(); line++) {
+      auto tokens = Tokenize(lines[line]);
+
+      if (tokens.empty()) {
+        continue;
+      }
+
+      if (tokens[0] == "}") {
+        break;
+      }
+
+      ParseInstruction(tokens);
+    }
+
+    Finish();
+    return line;
+  }
+
+  void ParseInstruction(std::vector<std::string_view>& t) {
+    if (t[0][0] == '@') {
+      labels_[t[0].substr(1)] = function_->code.size();
+      return;
+    }
+
+    auto dst = kNoRegister;
+    auto cls = std::string_view{};
+
+    if (t.size() > 2 && t[1] == "=") {
+      dst = Register(t[0]);
+      cls = t[2];
+      t.erase(t.begin(), t.begin() + 3);
+    }
+
+    auto op = t.at(0);
+
+    // Operands without the commas
+    std::vector<std::string_view> args;
+    for (size_t i = 1; i < t.size(); i++) {
+      if (t[i] != ",") {
+        args.push_back(t[i]);
+      }
+    }
+
+    if (op == "call") {
+      ParseCall(dst, cls, t);
+    } else if (op == "jmp") {
+      Emit(Op::JMP);
+      Jump(&Instr::a, args.at(0).substr(1));
+    } else if (op == "jnz") {
+      Emit(Op::JNZ, kNoRegister, Register(args.at(0)));
+      Jump(&Instr::b, args.at(1).substr(1));
+      Jump(&Instr::c, args.at(2).substr(1));
+    } else if (op == "ret") {
+      Emit(Op::RET, kNoRegister,
+           args.empty() ? kNoRegister : Register(args[0]));
+    } else if (op.starts_with("alloc")) {
+      auto align = static_cast<uint32_t>(Number(op.substr(5)));
+      Emit(Op::ALLOC, dst, Register(args.at(0)), align);
+    } else if (auto it = kFloat.find(op);
+               it != kFloat.end() && IsFloat(cls)) {
+      Emit(cls == "d" ? it->second.d : it->second.s, dst,
+           Register(args.at(0)),
+           args.size() > 1 ? Register(args[1]) : kNoRegister);
+    } else if (op == "neg") {
+      Emit(cls == "l" ? Op::NEGL : Op::NEGW, dst, Register(args.at(0)));
+    } else if (auto it = kBinary.find(op); it != kBinary.end()) {
+      Emit(cls == "l" ? it->second.l : it->second.w, dst,
+           Register(args.at(0)), Register(args.at(1)));
+    } else if (auto it = kFixed.find(op); it != kFixed.end()) {
+      Emit(it->second, dst, Register(args.at(0)),
+           args.size() > 1 ? Register(args[1]) : kNoRegister);
+    } else {
+      Fail(op);
+    }
+  }
+
+  // call $f (l %.1, w 2, ..., l %.3, )
+  void ParseCall(uint32_t dst, std::string_view cls,
+                 const std::vector<std::string_view>& t) {
+    if (!cls.empty() && cls[0] == ':') {
+      Fail("aggregate result of a call");
+    }
+
+    CallSite site;
+    site.floats = IsFloat(cls);
+
+    if (t.at(1)[0] == '$') {
+      site.symbol = std::string{t[1].substr(1)};
+    } else {
+      site.through = Register(t[1]);
+    }
+
+    for (size_t i = 3; t.at(i) != ")"; i++) {
+      if (t[i] == "," || t[i] == "...") {
+        continue;
+      }
+
+      auto type = t[i];
+      CallArg arg{.reg = Register(t.at(i += 1))};
+
+      if (type[0] == ':') {
+        arg.size = Base(type).size;
+      }
+
+      site.floats |= IsFloat(type);
+
+      site.args.push_back(arg);
+    }
+
+    Emit(Op::CALL, dst, function_->calls.size());
+    function_->calls.push_back(std::move(site));
+  }
+
+  void Finish() {
+    auto& function = *function_;
+    function.temporaries = registers_.size();
+
+    auto fix = [&](uint32_t& reg) {
+      if (reg != kNoRegister && (reg & kConstant)) {
+        reg = function.temporaries + (reg & ~kConstant);
+      }
+    };
+
+    // Jump targets, call sites and alignments are not registers
+    for (auto& instr : function.code) {
+      switch (instr.op) {
+        case Op::JMP:
+          break;
+        case Op::JNZ:
+          fix(instr.a);
+          break;
+        case Op::CALL:
+          fix(instr.dst);
+          break;
+        case Op::ALLOC:
+          fix(instr.dst);
+          fix(instr.a);
+          break;
+        default:
+          fix(instr.dst);
+          fix(instr.a);
+          fix(instr.b);
+      }
+    }
+
+    for (auto& site : function.calls) {
+      fix(site.through);
+      for (auto& arg : site.args) {
+        fix(arg.reg);
+      }
+    }
+
+    for (auto& [instr, field, label] : jumps_) {
+      auto it = labels_.find(label);
+      if (it == labels_.end()) {
+        Fail(label);
+      }
+      function.code[instr].*field = it->second;
+    }
+
+    // Falling off the end returns nothing, like `@ret` without `ret`
+    function.code.push_back({.op = Op::RET});
+  }
+
+  // Linking
+
+  void Link() {
+    for (auto& function : program_.functions) {
+      program_.by_name[function.name] = &function;
+      program_.addresses.insert(&function);
+    }
+
+    size_t total = 0;
+    std::vector<size_t> offsets;
+
+    for (auto& data : data_) {
+      total = AlignUp(total, data.align);
+      offsets.push_back(total);
+      total += data.bytes.size();
+    }
+
+    program_.data.reset(new char[std::max<size_t>(total, 1)]());
+
+    for (size_t i = 0; i < data_.size(); i++) {
+      auto at = program_.data.get() + offsets[i];
+      std::memcpy(at, data_[i].bytes.data(), data_[i].bytes.size());
+      program_.symbols[data_[i].name] = at;
+    }
+
+    for (size_t i = 0; i < data_.size(); i++) {
+      for (auto& reloc : data_[i].relocs) {
+        auto value = Address(reloc.symbol) + reloc.addend;
+        std::memcpy(program_.data.get() + offsets[i] + reloc.offset, &value,
+                    sizeof(value));
+      }
+    }
+
+    for (auto& function : program_.functions) {
+      for (auto& [index, symbol] : function.relocations) {
+        function.constants[index] = Address(symbol);
+      }
+
+      for (auto& site : function.calls) {
+        if (site.symbol.empty()) {
+          continue;
+        }
+
+        if (auto it = program_.by_name.find(site.symbol);
+            it != program_.by_name.end()) {
+          site.function = it->second;
+          continue;
+        }
+
+        site.native = FindNative(site.symbol);
+
+        if (!site.native) {
+          throw VmError{fmt::format("Undefined function '{}'", site.symbol)};
+        }
+
+        for (auto& arg : site.args) {
+          if (arg.size) {
+            Fail(fmt::format("aggregate argument of '{}'", site.symbol));
+          }
+        }
+
+        if (site.floats) {
+          Fail(fmt::format("floating-point call of '{}'", site.symbol));
+        }
+      }
+    }
+  }
+
+  uint64_t Address(const std::string& symbol) {
+    if (auto it = program_.by_name.find(symbol);
+        it != program_.by_name.end()) {
+      return reinterpret_cast<uint64_t>(it->second);
+    }
+
+    if (auto it = program_.symbols.find(symbol);
+        it != program_.symbols.end()) {
+      return reinterpret_cast<uint64_t>(it->second);
+    }
+
+    if (auto native = FindNative(symbol)) {
+      return reinterpret_cast<uint64_t>(native);
+    }
+
+    throw VmError{fmt::format("Undefined symbol '{}'", symbol)};
+  }
+
+ private:
+  static constexpr uint32_t kConstant = 1u << 31;
+
+  Program program_;
+
+  std::unordered_map<std::string, Layout> types_;
+  std::vector<DataDef> data_;
+
+  // Of the function being assembled
+  Function* function_ = nullptr;
+  std::unordered_map<std::string_view, uint32_t> registers_;
+  std::unordered_map<std::string_view, uint32_t> constants_;
+  std::unordered_map<std::string_view, uint32_t> labels_;
+
+  struct PendingJump {
+    size_t instr;
+    uint32_t Instr::*field;
+    std::string_view label;
+  };
+  std::vector<PendingJump> jumps_;
+};
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+Program Assemble(std::string_view ir) {
+  return Assembler{}.Run(ir);
+}
+
+}  // namespace vm
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vm/bytecode.hpp>
+
+#include <string_view>
+
+namespace vm {
+
+// Assembles and links the QBE text printed by qbe::IrEmitter. Only
+//   the part of QBE the emitter uses is understood: no floats, no
+//   aggregates passed to or returned from C functions.
+//
+// Symbols not defined in the text are looked up among the C
+//   functions the process can reach (see natives.cpp).
+//
+// Throws VmError.
+Program Assemble(std::string_view ir);
+
+// Address of a C function, null if there is no such
+void* FindNative(const std::string& name);
+
+}  // namespace vm
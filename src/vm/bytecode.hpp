@@ -0,0 +1,170 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+
+namespace vm {
+
+// Register bytecode assembled from the QBE text of the emitter (see
+//   assembler.hpp): every temporary of a function is a 64-bit
+//   register, and so is every constant or symbol it mentions, so
+//   that operands are always register numbers.
+//
+// `w` operands are only ever read through their lower 32 bits,
+//   like in QBE, so nothing is kept sign- or zero-extended. An `s`
+//   is the bits of a float in the lower 32, a `d` those of a double.
+
+#define VM_OPCODE_LIST(code) \
+  code(COPY)                 \
+                             \
+  code(ADDW) code(ADDL)      \
+  code(SUBW) code(SUBL)      \
+  code(MULW) code(MULL)      \
+  code(DIVW) code(DIVL)      \
+  code(UDIVW) code(UDIVL)    \
+  code(REMW) code(REML)      \
+  code(ANDW) code(ANDL)      \
+  code(ORW) code(ORL)        \
+  code(XORW) code(XORL)      \
+  code(NEGW) code(NEGL)      \
+                             \
+  code(CEQW) code(CEQL)      \
+  code(CNEW) code(CNEL)      \
+  code(CSLTW) code(CSLTL)    \
+  code(CSLEW) code(CSLEL)    \
+  code(CSGTW) code(CSGTL)    \
+  code(CSGEW) code(CSGEL)    \
+  code(CULTW) code(CULTL)    \
+  code(CULEW) code(CULEL)    \
+  code(CUGTW) code(CUGTL)    \
+  code(CUGEW) code(CUGEL)    \
+                             \
+  code(EXTSW) code(EXTUW)    \
+  code(EXTSH) code(EXTUH)    \
+  code(EXTSB) code(EXTUB)    \
+                             \
+  code(ADDS) code(ADDD)      \
+  code(SUBS) code(SUBD)      \
+  code(MULS) code(MULD)      \
+  code(DIVS) code(DIVD)      \
+  code(NEGS) code(NEGD)      \
+                             \
+  code(CEQS) code(CEQD)      \
+  code(CNES) code(CNED)      \
+  code(CLTS) code(CLTD)      \
+  code(CLES) code(CLED)      \
+  code(CGTS) code(CGTD)      \
+  code(CGES) code(CGED)      \
+                             \
+  code(EXTS) code(TRUNCD)    \
+  code(STOSI) code(STOUI)    \
+  code(DTOSI) code(DTOUI)    \
+  code(SWTOFS) code(SWTOFD)  \
+  code(UWTOFS) code(UWTOFD)  \
+  code(SLTOFS) code(SLTOFD)  \
+  code(ULTOFS) code(ULTOFD)  \
+                             \
+  code(LOADL)                \
+  code(LOADSW) code(LOADUW)  \
+  code(LOADSH) code(LOADUH)  \
+  code(LOADSB) code(LOADUB)  \
+                             \
+  code(STOREL) code(STOREW)  \
+  code(STOREH) code(STOREB)  \
+                             \
+  code(ALLOC)                \
+  code(JMP)                  \
+  code(JNZ)                  \
+  code(CALL)                 \
+  code(RET)
+
+enum class Op : uint8_t {
+#define DEFINE_OPCODE(op) op,
+  VM_OPCODE_LIST(DEFINE_OPCODE)
+#undef DEFINE_OPCODE
+};
+
+//////////////////////////////////////////////////////////////////////
+
+inline constexpr uint32_t kNoRegister = UINT32_MAX;
+
+// `dst = a op b`, `store a, b`, `jnz a, @b, @c`, `dst = alloc a`
+//   aligned to b, `dst = call calls[a]`, `ret a`
+struct Instr {
+  // Address of the handler, filled in by the machine (direct threading)
+  const void* handler = nullptr;
+
+  Op op;
+  uint32_t dst = kNoRegister;
+  uint32_t a = kNoRegister;
+  uint32_t b = kNoRegister;
+  uint32_t c = kNoRegister;
+};
+
+struct Function;
+
+struct CallArg {
+  uint32_t reg;
+
+  // Aggregates (`:T` arguments) are copied into the callee's frame
+  uint32_t size = 0;
+  uint32_t align = 0;
+};
+
+struct CallSite {
+  std::string symbol;  // Empty when calling through `a`
+  uint32_t through = kNoRegister;
+
+  // Resolved by the linker, one of them
+  const Function* function = nullptr;
+  void* native = nullptr;
+
+  std::vector<CallArg> args;
+
+  // `s` or `d` arguments or result, the natives take neither
+  bool floats = false;
+};
+
+struct Function {
+  std::string name;
+
+  std::vector<Instr> code;
+  std::vector<CallSite> calls;
+
+  uint32_t params = 0;
+  std::vector<CallArg> param_copies;  // `:T` params, sizes only
+
+  // Registers past `temporaries` hold the constants, copied in
+  //   on every call
+  uint32_t temporaries = 0;
+  std::vector<uint64_t> constants;
+
+  // Symbols of the constants, patched in by the linker
+  std::vector<std::pair<uint32_t, std::string>> relocations;
+};
+
+struct Program {
+  std::deque<Function> functions;
+  std::unordered_map<std::string, const Function*> by_name;
+
+  // The value of `$f` is the address of the Function itself
+  std::unordered_set<const void*> addresses;
+
+  // All the data definitions, laid out one after another
+  std::unique_ptr<char[]> data;
+  std::unordered_map<std::string, char*> symbols;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+struct VmError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+}  // namespace vm
@@ -0,0 +1,423 @@
+#include <vm/machine.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <bit>
+
+// Labels as values, where the compiler has them
+#if defined(__GNUC__)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+namespace vm {
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t kMaxArgs = 16;
+constexpr size_t kMaxNativeArgs = 8;
+
+template <typename T>
+T Load(uint64_t address) {
+  T value;
+  std::memcpy(&value, reinterpret_cast<const void*>(address), sizeof(T));
+  return value;
+}
+
+template <typename T>
+void Store(uint64_t address, uint64_t value) {
+  auto narrow = static_cast<T>(value);
+  std::memcpy(reinterpret_cast<void*>(address), &narrow, sizeof(T));
+}
+
+float AsFloat(uint64_t reg) {
+  return std::bit_cast<float>(static_cast<uint32_t>(reg));
+}
+
+double AsDouble(uint64_t reg) {
+  return std::bit_cast<double>(reg);
+}
+
+uint64_t FromFloat(float value) {
+  return std::bit_cast<uint32_t>(value);
+}
+
+uint64_t FromDouble(double value) {
+  return std::bit_cast<uint64_t>(value);
+}
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+Machine::Machine(Program& program)
+    : program_{program},
+      registers_(size_t{1} << 16),
+      memory_{new char[kMemorySize]} {
+}
+
+int Machine::RunMain(int argc, char** argv) {
+  auto it = program_.by_name.find("main");
+
+  if (it == program_.by_name.end()) {
+    throw VmError{"There is no `main` in the program"};
+  }
+
+  uint64_t args[] = {static_cast<uint64_t>(argc),
+                     reinterpret_cast<uint64_t>(argv)};
+
+  return static_cast<int>(Execute(it->second, args));
+}
+
+uint64_t Machine::Call(const Function* function,
+                       std::span<const uint64_t> args) {
+  return Execute(function, args);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Machine::Enter(const Function* function, std::span<const uint64_t> args) {
+  auto base = top_;
+  auto size = function->temporaries + function->constants.size();
+
+  if (base + size > registers_.size()) {
+    if (base + size > kMaxRegisters) {
+      throw VmError{"Stack overflow"};
+    }
+    registers_.resize(std::max(registers_.size() * 2, base + size));
+  }
+
+  top_ = base + size;
+
+  auto r = registers_.data() + base;
+  std::copy(function->constants.begin(), function->constants.end(),
+            r + function->temporaries);
+  std::copy_n(args.begin(), std::min<size_t>(args.size(), function->params),
+              r);
+
+  // `:T` parameters point to a copy of their own
+  for (auto& copy : function->param_copies) {
+    auto at = Allocate(copy.size, copy.align);
+    std::memcpy(at, reinterpret_cast<const void*>(r[copy.reg]), copy.size);
+    r[copy.reg] = reinterpret_cast<uint64_t>(at);
+  }
+}
+
+char* Machine::Allocate(uint64_t size, uint64_t align) {
+  auto start = (memory_top_ + align - 1) / align * align;
+
+  if (start + size > kMemorySize) {
+    throw VmError{"Stack overflow"};
+  }
+
+  memory_top_ = start + size;
+  return memory_.get() + start;
+}
+
+// Integer and pointer arguments go the same way to the variadic and
+//   to the ordinary functions (at least with the SysV ABI)
+uint64_t Machine::CallNative(void* function, std::span<const uint64_t> a) {
+  using Native = uint64_t (*)(...);
+  auto f = reinterpret_cast<Native>(function);
+
+  switch (a.size()) {
+    case 0:
+      return f();
+    case 1:
+      return f(a[0]);
+    case 2:
+      return f(a[0], a[1]);
+    case 3:
+      return f(a[0], a[1], a[2]);
+    case 4:
+      return f(a[0], a[1], a[2], a[3]);
+    case 5:
+      return f(a[0], a[1], a[2], a[3], a[4]);
+    case 6:
+      return f(a[0], a[1], a[2], a[3], a[4], a[5]);
+    case 7:
+      return f(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+    case 8:
+      return f(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    default:
+      throw VmError{fmt::format("More than {} arguments to a C function",
+                                kMaxNativeArgs)};
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+#if VM_THREADED
+#define TARGET(op) op_##op:
+#define DISPATCH() goto* pc->handler
+#else
+#define TARGET(op) case Op::op:
+#define DISPATCH() goto dispatch
+#endif
+
+#define W(reg) static_cast<uint32_t>(r[reg])
+#define SW(reg) static_cast<int32_t>(r[reg])
+#define L(reg) r[reg]
+#define SL(reg) static_cast<int64_t>(r[reg])
+
+#define INSTR(op, expr)   \
+  TARGET(op) {            \
+    r[pc->dst] = (expr);  \
+    pc += 1;              \
+    DISPATCH();           \
+  }
+
+#define BINARY(op, expr) INSTR(op##W, static_cast<uint32_t>(expr(W, SW)))  \
+                         INSTR(op##L, static_cast<uint64_t>(expr(L, SL)))
+
+#define COMPARE(op, expr) INSTR(op##W, expr(W, SW)) INSTR(op##L, expr(L, SL))
+
+#define FS(reg) AsFloat(r[reg])
+#define FD(reg) AsDouble(r[reg])
+
+#define FLOAT(op, expr) INSTR(op##S, FromFloat(expr(FS, FS)))  \
+                        INSTR(op##D, FromDouble(expr(FD, FD)))
+
+#define FCOMPARE(op, expr) INSTR(op##S, expr(FS, FS)) \
+                           INSTR(op##D, expr(FD, FD))
+
+#define LOAD(op, T) INSTR(op, static_cast<uint64_t>(Load<T>(r[pc->a])))
+
+#define STORE(op, T)                \
+  TARGET(op) {                      \
+    Store<T>(r[pc->b], r[pc->a]);   \
+    pc += 1;                        \
+    DISPATCH();                     \
+  }
+
+// Operands as unsigned (U) and signed (S) of the width, floats
+//   are given as both
+#define ADD(U, S) U(pc->a) + U(pc->b)
+#define SUB(U, S) U(pc->a) - U(pc->b)
+#define MUL(U, S) U(pc->a) * U(pc->b)
+#define DIV(U, S) S(pc->a) / S(pc->b)
+#define UDIV(U, S) U(pc->a) / U(pc->b)
+#define FNEG(U, S) -U(pc->a)
+#define REM(U, S) S(pc->a) % S(pc->b)
+#define AND(U, S) U(pc->a) & U(pc->b)
+#define OR(U, S) U(pc->a) | U(pc->b)
+#define XOR(U, S) U(pc->a) ^ U(pc->b)
+#define NEG(U, S) 0 - U(pc->a)
+
+#define CEQ(U, S) U(pc->a) == U(pc->b)
+#define CNE(U, S) U(pc->a) != U(pc->b)
+#define CSLT(U, S) S(pc->a) < S(pc->b)
+#define CSLE(U, S) S(pc->a) <= S(pc->b)
+#define CSGT(U, S) S(pc->a) > S(pc->b)
+#define CSGE(U, S) S(pc->a) >= S(pc->b)
+#define CULT(U, S) U(pc->a) < U(pc->b)
+#define CULE(U, S) U(pc->a) <= U(pc->b)
+#define CUGT(U, S) U(pc->a) > U(pc->b)
+#define CUGE(U, S) U(pc->a) >= U(pc->b)
+
+// Integers to `s` or `d`
+#define SWTOF(U, S) SW(pc->a)
+#define UWTOF(U, S) W(pc->a)
+#define SLTOF(U, S) SL(pc->a)
+#define ULTOF(U, S) L(pc->a)
+
+uint64_t Machine::Execute(const Function* entry,
+                          std::span<const uint64_t> args) {
+#if VM_THREADED
+  static const void* const kHandlers[] = {
+#define HANDLER_ADDRESS(op) &&op_##op,
+      VM_OPCODE_LIST(HANDLER_ADDRESS)
+#undef HANDLER_ADDRESS
+  };
+
+  if (!threaded_) {
+    for (auto& function : program_.functions) {
+      for (auto& instr : function.code) {
+        instr.handler = kHandlers[static_cast<size_t>(instr.op)];
+      }
+    }
+    threaded_ = true;
+  }
+#endif
+
+  auto function = entry;
+  auto base = top_;
+  Enter(function, args);
+
+  auto r = registers_.data() + base;
+  auto pc = function->code.data();
+
+#if VM_THREADED
+  DISPATCH();
+#else
+dispatch:
+  switch (pc->op) {
+#endif
+
+  INSTR(COPY, r[pc->a])
+
+  BINARY(ADD, ADD)
+  BINARY(SUB, SUB)
+  BINARY(MUL, MUL)
+  BINARY(DIV, DIV)
+  BINARY(UDIV, UDIV)
+  BINARY(REM, REM)
+  BINARY(AND, AND)
+  BINARY(OR, OR)
+  BINARY(XOR, XOR)
+  BINARY(NEG, NEG)
+
+  COMPARE(CEQ, CEQ)
+  COMPARE(CNE, CNE)
+  COMPARE(CSLT, CSLT)
+  COMPARE(CSLE, CSLE)
+  COMPARE(CSGT, CSGT)
+  COMPARE(CSGE, CSGE)
+  COMPARE(CULT, CULT)
+  COMPARE(CULE, CULE)
+  COMPARE(CUGT, CUGT)
+  COMPARE(CUGE, CUGE)
+
+  INSTR(EXTSW, static_cast<uint64_t>(int64_t{SW(pc->a)}))
+  INSTR(EXTUW, W(pc->a))
+  INSTR(EXTSH, static_cast<uint64_t>(int64_t{static_cast<int16_t>(r[pc->a])}))
+  INSTR(EXTUH, static_cast<uint16_t>(r[pc->a]))
+  INSTR(EXTSB, static_cast<uint64_t>(int64_t{static_cast<int8_t>(r[pc->a])}))
+  INSTR(EXTUB, static_cast<uint8_t>(r[pc->a]))
+
+  FLOAT(ADD, ADD)
+  FLOAT(SUB, SUB)
+  FLOAT(MUL, MUL)
+  FLOAT(DIV, UDIV)
+  FLOAT(NEG, FNEG)
+
+  FCOMPARE(CEQ, CEQ)
+  FCOMPARE(CNE, CNE)
+  FCOMPARE(CLT, CULT)
+  FCOMPARE(CLE, CULE)
+  FCOMPARE(CGT, CUGT)
+  FCOMPARE(CGE, CUGE)
+
+  INSTR(EXTS, FromDouble(FS(pc->a)))
+  INSTR(TRUNCD, FromFloat(static_cast<float>(FD(pc->a))))
+  INSTR(STOSI, static_cast<uint64_t>(static_cast<int64_t>(FS(pc->a))))
+  INSTR(STOUI, static_cast<uint64_t>(FS(pc->a)))
+  INSTR(DTOSI, static_cast<uint64_t>(static_cast<int64_t>(FD(pc->a))))
+  INSTR(DTOUI, static_cast<uint64_t>(FD(pc->a)))
+
+  FLOAT(SWTOF, SWTOF)
+  FLOAT(UWTOF, UWTOF)
+  FLOAT(SLTOF, SLTOF)
+  FLOAT(ULTOF, ULTOF)
+
+  LOAD(LOADL, uint64_t)
+  LOAD(LOADSW, int32_t)
+  LOAD(LOADUW, uint32_t)
+  LOAD(LOADSH, int16_t)
+  LOAD(LOADUH, uint16_t)
+  LOAD(LOADSB, int8_t)
+  LOAD(LOADUB, uint8_t)
+
+  STORE(STOREL, uint64_t)
+  STORE(STOREW, uint32_t)
+  STORE(STOREH, uint16_t)
+  STORE(STOREB, uint8_t)
+
+  INSTR(ALLOC, reinterpret_cast<uint64_t>(Allocate(r[pc->a], pc->b)))
+
+  TARGET(JMP) {
+    pc = function->code.data() + pc->a;
+    DISPATCH();
+  }
+
+  TARGET(JNZ) {
+    pc = function->code.data() + (W(pc->a) ? pc->b : pc->c);
+    DISPATCH();
+  }
+
+  TARGET(CALL) {
+    auto& site = function->calls[pc->a];
+
+    if (site.args.size() > kMaxArgs) {
+      throw VmError{fmt::format("More than {} arguments", kMaxArgs)};
+    }
+
+    uint64_t values[kMaxArgs];
+    for (size_t i = 0; i < site.args.size(); i++) {
+      values[i] = r[site.args[i].reg];
+    }
+    auto call_args = std::span<const uint64_t>(values, site.args.size());
+
+    auto callee = site.function;
+    auto native = site.native;
+
+    if (site.through != kNoRegister) {
+      auto target = reinterpret_cast<void*>(r[site.through]);
+
+      if (program_.addresses.contains(target)) {
+        callee = static_cast<const Function*>(target);
+      } else {
+        native = target;
+      }
+    }
+
+    if (callee) {
+      frames_.push_back({function, pc + 1, base, memory_top_, pc->dst});
+
+      function = callee;
+      base = top_;
+      Enter(function, call_args);
+
+      r = registers_.data() + base;
+      pc = function->code.data();
+      DISPATCH();
+    }
+
+    auto result = CallNative(native, call_args);
+
+    if (pc->dst != kNoRegister) {
+      r[pc->dst] = result;
+    }
+
+    pc += 1;
+    DISPATCH();
+  }
+
+  TARGET(RET) {
+    auto value = pc->a != kNoRegister ? r[pc->a] : 0;
+    top_ = base;
+
+    if (frames_.empty()) {
+      memory_top_ = 0;
+      return value;
+    }
+
+    auto frame = frames_.back();
+    frames_.pop_back();
+
+    function = frame.function;
+    pc = frame.pc;
+    base = frame.base;
+    memory_top_ = frame.memory;
+
+    r = registers_.data() + base;
+
+    if (frame.dst != kNoRegister) {
+      r[frame.dst] = value;
+    }
+
+    DISPATCH();
+  }
+
+#if !VM_THREADED
+  }
+  std::abort();
+#endif
+}
+
+}  // namespace vm
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vm/bytecode.hpp>
+
+#include <memory>
+#include <vector>
+#include <span>
+
+namespace vm {
+
+// Runs the assembled program with a direct-threaded interpreter
+//   (a `switch` where the compiler has no computed goto).
+//
+// Calls between the functions of the program do not recurse on the
+//   C++ stack. `alloc` takes memory from a stack of the machine's own,
+//   so that the addresses stay valid for C functions.
+
+class Machine {
+ public:
+  static constexpr size_t kMemorySize = size_t{64} << 20;
+  static constexpr size_t kMaxRegisters = size_t{16} << 20;
+
+  explicit Machine(Program& program);
+
+  // Calls `main(argc, argv)` and returns its result.
+  //   Throws VmError.
+  int RunMain(int argc, char** argv);
+
+  // Calls a function of the program, say, one from `et_test_array`.
+  //   Throws VmError.
+  uint64_t Call(const Function* function,
+                std::span<const uint64_t> args = {});
+
+ private:
+  uint64_t Execute(const Function* entry, std::span<const uint64_t> args);
+
+  // Sets up the frame of `function` at the top of the registers
+  void Enter(const Function* function, std::span<const uint64_t> args);
+
+  char* Allocate(uint64_t size, uint64_t align);
+
+  static uint64_t CallNative(void* function, std::span<const uint64_t> args);
+
+ private:
+  struct Frame {
+    const Function* function;
+    const Instr* pc;  // Where to continue in the caller
+    size_t base;
+    size_t memory;
+    uint32_t dst;
+  };
+
+  Program& program_;
+  bool threaded_ = false;
+
+  std::vector<uint64_t> registers_;
+  size_t top_ = 0;
+
+  std::unique_ptr<char[]> memory_;
+  size_t memory_top_ = 0;
+
+  std::vector<Frame> frames_;
+};
+
+}  // namespace vm
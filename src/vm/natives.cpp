@@ -0,0 +1,75 @@
+#include <vm/assembler.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace vm {
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// stdlib/runtime/alloc_malloc.c, which is not linked into the compiler
+
+void* EtAlloc(uint64_t size) {
+  return std::malloc(size);
+}
+
+void EtAllocReset() {
+}
+
+const std::unordered_map<std::string, void*> kBuiltins{
+    {"et_alloc", reinterpret_cast<void*>(&EtAlloc)},
+    {"et_alloc_reset", reinterpret_cast<void*>(&EtAllocReset)},
+
+    // What the emitter calls by itself, for the hosts without dlsym
+    {"printf", reinterpret_cast<void*>(&std::printf)},
+    {"abort", reinterpret_cast<void*>(&std::abort)},
+    {"memcpy", reinterpret_cast<void*>(&std::memcpy)},
+    {"memset", reinterpret_cast<void*>(&std::memset)},
+
+    // stdlib/sys.et, since dlsym finds nothing in a static etc
+    {"getenv", reinterpret_cast<void*>(&std::getenv)},
+    {"fprintf", reinterpret_cast<void*>(&std::fprintf)},
+    {"sprintf", reinterpret_cast<void*>(&std::sprintf)},
+    {"fflush", reinterpret_cast<void*>(&std::fflush)},
+    {"fgets", reinterpret_cast<void*>(&std::fgets)},
+    {"setbuf", reinterpret_cast<void*>(&std::setbuf)},
+#if !defined(_WIN32)
+    {"write", reinterpret_cast<void*>(&::write)},
+    {"read", reinterpret_cast<void*>(&::read)},
+    {"fork", reinterpret_cast<void*>(&::fork)},
+    {"sleep", reinterpret_cast<void*>(&::sleep)},
+    {"waitpid", reinterpret_cast<void*>(&::waitpid)},
+    {"fdopen", reinterpret_cast<void*>(&::fdopen)},
+    {"fileno", reinterpret_cast<void*>(&::fileno)},
+    {"select", reinterpret_cast<void*>(&::select)},
+#endif
+};
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+void* FindNative(const std::string& name) {
+  if (auto it = kBuiltins.find(name); it != kBuiltins.end()) {
+    return it->second;
+  }
+
+#if !defined(_WIN32)
+  return dlsym(RTLD_DEFAULT, name.c_str());
+#else
+  return nullptr;
+#endif
+}
+
+}  // namespace vm
@@ -0,0 +1,58 @@
+// Allocator of the generated code: every `new` calls `et_alloc`.
+//   Link exactly one of the stdlib/runtime/alloc_*.c with the program.
+//
+// This one is a bump arena: an allocation is a pointer increment,
+//   memory is given back all at once by `et_alloc_reset` (say, at
+//   the end of a request) or at exit. Not thread safe.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+enum { kAlign = 16, kChunkSize = 1 << 20 };
+
+struct Chunk {
+  struct Chunk* prev;
+  char* top;
+  char* end;
+};
+
+static struct Chunk* current = NULL;
+
+static struct Chunk* NewChunk(uint64_t size) {
+  size += sizeof(struct Chunk) + kAlign;
+  size = size < kChunkSize ? kChunkSize : size;
+
+  struct Chunk* chunk = malloc(size);
+  if (!chunk) {
+    abort();
+  }
+
+  chunk->prev = current;
+  chunk->top = (char*)(chunk + 1);
+  chunk->end = (char*)chunk + size;
+  return chunk;
+}
+
+void* et_alloc(uint64_t size) {
+  size = (size + kAlign - 1) & ~(uint64_t)(kAlign - 1);
+
+  if (current) {
+    uintptr_t top = ((uintptr_t)current->top + kAlign - 1) & ~(kAlign - 1);
+
+    if (top + size <= (uintptr_t)current->end) {
+      current->top = (char*)(top + size);
+      return (void*)top;
+    }
+  }
+
+  current = NewChunk(size);
+  return et_alloc(size);
+}
+
+void et_alloc_reset(void) {
+  while (current) {
+    struct Chunk* prev = current->prev;
+    free(current);
+    current = prev;
+  }
+}
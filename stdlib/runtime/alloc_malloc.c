@@ -0,0 +1,17 @@
+// Allocator of the generated code: every `new` calls `et_alloc`.
+//   Link exactly one of the stdlib/runtime/alloc_*.c with the program:
+//
+//   etc -m main | qbe | as -o out && gcc out $ETUDE_STDLIB/runtime/alloc_malloc.c
+//
+// This one is plain malloc.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+void* et_alloc(uint64_t size) {
+  return malloc(size);
+}
+
+// Nothing is freed, the language has no `free` yet
+void et_alloc_reset(void) {
+}
@@ -0,0 +1,54 @@
+// Allocator of the generated code: every `new` calls `et_alloc`.
+//   Link exactly one of the stdlib/runtime/alloc_*.c with the program.
+//
+// This one keeps a thread-local pool per size class (16 to 2048
+//   bytes): small objects are carved out of 64 KiB slabs without
+//   locking and are packed by size. Bigger ones go to malloc.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+enum { kMinClass = 4, kClasses = 8, kSlabSize = 64 << 10 };
+
+struct Pool {
+  char* top;
+  char* end;
+};
+
+static _Thread_local struct Pool pools[kClasses];
+
+// 16 -> 0, 17..32 -> 1, ..., 1025..2048 -> 7
+static int SizeClass(uint64_t size) {
+  int k = 0;
+  while (((uint64_t)1 << (k + kMinClass)) < size) {
+    k += 1;
+  }
+  return k;
+}
+
+void* et_alloc(uint64_t size) {
+  int k = SizeClass(size);
+
+  if (k >= kClasses) {
+    return malloc(size);
+  }
+
+  struct Pool* pool = &pools[k];
+  uint64_t block = (uint64_t)1 << (k + kMinClass);
+
+  if (!pool->top || pool->top + block > pool->end) {
+    pool->top = malloc(kSlabSize);
+    if (!pool->top) {
+      abort();
+    }
+    pool->end = pool->top + kSlabSize;
+  }
+
+  void* result = pool->top;
+  pool->top += block;
+  return result;
+}
+
+// Slabs live until exit, the language has no `free` yet
+void et_alloc_reset(void) {
+}
@@ -0,0 +1,148 @@
+// The `main` of a test build: every @test function of every module
+//   is in `et_test_array` (see IrEmitter::EmitTestArray). Link it
+//   with one of the allocators:
+//
+//   etc -t -m main | qbe | as -o out && gcc out
+//     $ETUDE_STDLIB/runtime/test_main.c $ETUDE_STDLIB/runtime/alloc_malloc.c
+//
+//   ./a.out [-j jobs] [substring...]
+//
+// Each test runs in a forked worker, up to `jobs` at once (the number
+//   of CPUs by default), so that an `assert` only fails its own test.
+//   Only the tests whose `module.name` contains one of the substrings
+//   run, if any are given. Exits with 1 if some test failed.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern void (*et_test_array[])(void);
+extern const char* et_test_names[];
+
+struct Worker {
+  pid_t pid;
+  int test;
+  struct timespec start;
+};
+
+static double MillisSince(struct timespec start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) * 1e3 +
+         (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static int Selected(const char* name, int argc, char** argv) {
+  if (optind == argc) {
+    return 1;
+  }
+
+  for (int i = optind; i < argc; i++) {
+    if (strstr(name, argv[i])) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+// Returns whether the test passed
+static int Report(struct Worker* worker, int status) {
+  const char* name = et_test_names[worker->test];
+  double ms = MillisSince(worker->start);
+
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    printf("[PASS] %-50s %10.3f ms\n", name, ms);
+    return 1;
+  }
+
+  if (WIFSIGNALED(status)) {
+    printf("[FAIL] %-50s %10.3f ms  %s\n", name, ms,
+           strsignal(WTERMSIG(status)));
+  } else {
+    printf("[FAIL] %-50s %10.3f ms  exit code %d\n", name, ms,
+           WEXITSTATUS(status));
+  }
+
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    if (opt != 'j' || (jobs = atol(optarg)) <= 0) {
+      fprintf(stderr, "Usage: %s [-j jobs] [substring...]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (jobs <= 0) {
+    jobs = 1;
+  }
+
+  struct Worker* workers = calloc(jobs, sizeof(struct Worker));
+  long running = 0;
+
+  int total = 0;
+  int failed = 0;
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (int next = 0;; next++) {
+    // Skip what is not selected, stop at the end
+    while (et_test_array[next] &&
+           !Selected(et_test_names[next], argc, argv)) {
+      next++;
+    }
+
+    // Reap a worker if all are busy, or all of them at the end
+    while (running == jobs || (!et_test_array[next] && running > 0)) {
+      int status;
+      pid_t pid = wait(&status);
+
+      for (long i = 0; i < running; i++) {
+        if (workers[i].pid == pid) {
+          failed += !Report(&workers[i], status);
+          workers[i] = workers[--running];
+          break;
+        }
+      }
+    }
+
+    if (!et_test_array[next]) {
+      break;
+    }
+
+    fflush(stdout);
+    total += 1;
+
+    struct Worker* worker = &workers[running++];
+    worker->test = next;
+    clock_gettime(CLOCK_MONOTONIC, &worker->start);
+
+    if ((worker->pid = fork()) == 0) {
+      et_test_array[next]();
+      fflush(stdout);
+      _exit(0);
+    }
+
+    if (worker->pid < 0) {
+      perror("fork");
+      return 2;
+    }
+  }
+
+  printf("%d of %d tests passed in %.3f ms\n", total - failed, total,
+         MillisSince(start));
+
+  free(workers);
+  return failed ? 1 : 0;
+}
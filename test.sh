@@ -17,18 +17,29 @@ bold() {
 
 ######################################################################
 
+# The allocator to link with: malloc, arena or pool (see stdlib/runtime)
+runtime="$ETUDE_STDLIB/runtime/alloc_${ETUDE_ALLOC:-malloc}.c"
+
+######################################################################
+
 runtest_native() {
   local _testname=$1
   # https://stackoverflow.com/questions/34964332
-  $(timeout 0.5                          \
-      ./etc -m $_testname 2> /dev/null   \
-        | qbe             2> /dev/null   \
-        | as -o out       2> /dev/null   \
-        && gcc out        2> /dev/null)  \
+  $(timeout 0.5                            \
+      ./etc -m $_testname   2> /dev/null   \
+        | qbe               2> /dev/null   \
+        | as -o out         2> /dev/null   \
+        && gcc out $runtime 2> /dev/null)  \
 
   $(timeout 0.5 ./a.out &> /dev/null)
 }
 
+# No qbe and no linking: the bytecode interpreter (ETUDE_BACKEND=vm)
+runtest_vm() {
+  local _testname=$1
+  timeout 0.5 ./etc run -m $_testname &> /dev/null
+}
+
 collect_debug_artifacts() {
   local _testname=$(basename $1)
   local _dirname="artifacts/$_testname"
@@ -47,7 +58,7 @@ collect_debug_artifacts() {
         $_base/etc -m $_base/$1 2>> log   \
           | qbe                 2>> log   \
           | as -o out           2>> log   \
-          && gcc out            2>> log)  \
+          && gcc out $runtime   2>> log)  \
 
     $(timeout 0.5 ./a.out 1> output 2>> log)
 
@@ -59,7 +70,7 @@ report_test() {
   local name=$(cecho $white "[!] Running test $(basename $f)")
   printf '%-60s ... ' "$name"
 
-  if runtest_native $f; then
+  if runtest_${ETUDE_BACKEND:-native} $f; then
     printf $(bold $green "PASS!") && echo
   else
     printf $(bold $red "FAIL!") && echo
@@ -0,0 +1,134 @@
+#include <driver/compile_server.hpp>
+
+#include <vm/assembler.hpp>
+#include <vm/machine.hpp>
+
+// Finally,
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::string File(std::string_view name, std::string_view contents) {
+  return fmt::format("file {} {}\n{}", name, contents.size(), contents);
+}
+
+std::string Root(std::string_view body) {
+  return fmt::format(
+      "a;\n"
+      "export {{\n"
+      "    of Int -> *String -> Int\n"
+      "    @nomangle fun main argc argv;\n"
+      "}}\n"
+      "fun main argc argv = {};\n",
+      body);
+}
+
+struct Response {
+  std::string status;
+  std::string payload;
+};
+
+// The responses to `requests`, one per request
+std::vector<Response> Serve(CompileServer& server,
+                            const std::string& requests) {
+  auto in = std::tmpfile();
+  auto out = std::tmpfile();
+
+  std::fwrite(requests.data(), 1, requests.size(), in);
+  std::rewind(in);
+
+  server.Serve(in, out);
+  std::rewind(out);
+
+  std::vector<Response> responses;
+  char status[16];
+  size_t size = 0;
+
+  while (std::fscanf(out, "%15s %zu", status, &size) == 2) {
+    std::fgetc(out);  // \n
+
+    auto& response = responses.emplace_back();
+    response.status = status;
+    response.payload.resize(size);
+    std::fread(response.payload.data(), 1, size, out);
+  }
+
+  std::fclose(in);
+  std::fclose(out);
+  return responses;
+}
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Server: import rebuilt for another root", "[server]") {
+  CompileServer server;
+
+  // The types of m1 refer to `Pair` by its name in the source of `a`
+  auto a = [](std::string_view hi) {
+    return File("a", fmt::format(
+                         "export {{\n"
+                         "    type Pair = struct {{ lo: Int, hi: Int }};\n"
+                         "    of Int -> Pair\n"
+                         "    fun pair x;\n"
+                         "}}\n"
+                         "fun pair x = {{ .lo = x, .hi = {} }};\n",
+                         hi));
+  };
+
+  // m2 rebuilds `a`, m1 was checked against the old one
+  auto responses = Serve(server, a("x + 1") +  //
+                                     File("m1", Root("pair(argc).hi")) +
+                                     File("m2", Root("pair(argc).lo")) +
+                                     "compile m1\n" +  //
+                                     a("x + 2") +      //
+                                     "compile m2\n"
+                                     "compile m1\n");
+
+  REQUIRE(responses.size() == 7);
+
+  for (auto& response : responses) {
+    CHECK(response.status == "ok");
+  }
+
+  CHECK(responses[3].payload != responses[6].payload);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Server: test calling another test", "[server]") {
+  CompileServer server;
+
+  auto responses = Serve(server, File("t",
+                                      "@test fun helper = {\n"
+                                      "    assert(1 + 1 == 2);\n"
+                                      "};\n"
+                                      "@test fun caller = {\n"
+                                      "    helper();\n"
+                                      "};\n") +
+                                     "test t\n");
+
+  REQUIRE(responses.size() == 2);
+  REQUIRE(responses[1].status == "ok");
+
+  // The call goes to `test.t.helper` too (or it is inlined),
+  //   the assembler fails on an undefined function otherwise
+  auto program = vm::Assemble(responses[1].payload);
+
+  auto tests = reinterpret_cast<const vm::Function* const*>(
+      program.symbols.at("et_test_array"));
+
+  size_t total = 0;
+  for (; tests[total]; total++) {
+    vm::Machine{program}.Call(tests[total]);
+  }
+
+  CHECK(total == 2);
+}
+
+//////////////////////////////////////////////////////////////////////